@@ -0,0 +1,20 @@
+// Depth-only pass over the position stream, see RevModelData::m_positions.
+
+cbuffer CameraParams : register(b0)
+{
+    float4x4 view;
+    float4x4 projection;
+}
+
+float4 VSMain(float3 position : POSITION) : SV_POSITION
+{
+    float4 pos = float4(position, 1);
+    pos = mul(view, pos);
+    pos = mul(projection, pos);
+    return pos;
+}
+
+// Not bound by the depth-only pso, kept so the shader manager can compile the pair.
+void PSMain()
+{
+}
@@ -23,7 +23,7 @@ cbuffer CameraParams : register(b0)
     float4x4 projection;
 }
 
-PSInput VSMain(float3 position : POSITION, float2 tex : TEXCOORD, float3 normal : NORMAL, float3 biNormal : BINORMAL, float3 tangent : TANGENT )
+PSInput ShadeVertex(float3 position, float2 tex)
 {
     PSInput result;
     // #DXR Extra: Perspective Camera
@@ -35,6 +35,38 @@ PSInput VSMain(float3 position : POSITION, float2 tex : TEXCOORD, float3 normal
     return result;
 }
 
+#if REV_PACKED_VERTEX
+// Matches RevPositionQuantization, see RevVertexPosTexNormTanPacked for the vertex layout.
+cbuffer PositionQuantization : register(b1)
+{
+    float3 positionCenter;
+    float padding0;
+    float3 positionExtent;
+    float padding1;
+}
+
+float3 DecodeOctahedral(float2 encoded)
+{
+    float3 direction = float3(encoded.x, encoded.y, 1.0 - abs(encoded.x) - abs(encoded.y));
+    float t = saturate(-direction.z);
+    direction.xy += direction.xy >= 0.0 ? -t : t;
+    return normalize(direction);
+}
+
+PSInput VSMain(float4 position : POSITION, float2 tex : TEXCOORD, float2 packedNormal : NORMAL, float2 packedTangent : TANGENT)
+{
+    float3 normal = DecodeOctahedral(packedNormal);
+    float3 tangent = DecodeOctahedral(packedTangent);
+    float3 biNormal = cross(normal, tangent) * (position.w < 0.0 ? -1.0 : 1.0);
+    return ShadeVertex(positionCenter + position.xyz * positionExtent, tex);
+}
+#else
+PSInput VSMain(float3 position : POSITION, float2 tex : TEXCOORD, float3 normal : NORMAL, float3 biNormal : BINORMAL, float3 tangent : TANGENT )
+{
+    return ShadeVertex(position, tex);
+}
+#endif
+
 float4 PSMain(PSInput input) : SV_TARGET
 {
     return float4(1,1,0,1);
@@ -0,0 +1,3 @@
+// Packed vertex variant of StaticModel.hlsl (RevEVertexFormat::Packed).
+#define REV_PACKED_VERTEX 1
+#include "StaticModel.hlsl"
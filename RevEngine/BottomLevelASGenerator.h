@@ -79,8 +79,8 @@ namespace nv_helpers_dx12
     {
     public:
         /// Add a vertex buffer in GPU memory into the acceleration structure. The
-        /// vertices are supposed to be represented by 3 float32 value. Indices are
-        /// implicit.
+        /// vertices are represented by 3 float32 value unless another vertexFormat is
+        /// given. Indices are implicit.
         void AddVertexBuffer(ID3D12Resource* vertexBuffer, /// Buffer containing the vertex coordinates,
                                                            /// possibly interleaved with other vertex data
             UINT64 vertexOffsetInBytes,   /// Offset of the first vertex in the vertex
@@ -96,13 +96,15 @@ namespace nv_helpers_dx12
                                              /// be nullptr
             UINT64 transformOffsetInBytes,   /// Offset of the transform matrix in the
                                              /// transform buffer
-            bool isOpaque = true /// If true, the geometry is considered opaque,
-                                 /// optimizing the search for a closest hit
+            bool isOpaque = true, /// If true, the geometry is considered opaque,
+                                  /// optimizing the search for a closest hit
+            DXGI_FORMAT vertexFormat = DXGI_FORMAT_R32G32B32_FLOAT /// Format of the vertex
+                                                                   /// coordinates
         );
 
         /// Add a vertex buffer along with its index buffer in GPU memory into the acceleration structure.
         /// The vertices are supposed to be represented by 3 float32 value, and the indices are 32-bit
-        /// unsigned ints
+        /// unsigned ints unless other vertex and index formats are given
         void AddVertexBuffer(ID3D12Resource* vertexBuffer, /// Buffer containing the vertex coordinates,
                                                            /// possibly interleaved with other vertex data
             UINT64 vertexOffsetInBytes,   /// Offset of the first vertex in the vertex
@@ -123,8 +125,12 @@ namespace nv_helpers_dx12
                                              /// be nullptr
             UINT64 transformOffsetInBytes,   /// Offset of the transform matrix in the
                                              /// transform buffer
-            bool isOpaque = true /// If true, the geometry is considered opaque,
-                                 /// optimizing the search for a closest hit
+            bool isOpaque = true, /// If true, the geometry is considered opaque,
+                                  /// optimizing the search for a closest hit
+            DXGI_FORMAT vertexFormat = DXGI_FORMAT_R32G32B32_FLOAT, /// Format of the vertex
+                                                                    /// coordinates
+            DXGI_FORMAT indexFormat = DXGI_FORMAT_R32_UINT /// Format of the indices, R16_UINT
+                                                           /// or R32_UINT
         );
 
         /// Compute the size of the scratch space required to build the acceleration structure, as well as
@@ -0,0 +1,290 @@
+#include "stdafx.h"
+#include "RevAnimationCompression.h"
+#include <climits>
+#include <cmath>
+
+namespace
+{
+    const UINT g_quaternionComponentBits = 15;
+    const UINT g_quaternionComponentMax = (1u << g_quaternionComponentBits) - 1;
+    // The three smallest components of a unit quaternion lie within +-1 / sqrt(2).
+    const float g_quaternionComponentRange = 0.70710678f;
+    // Rotation angle 15 bit components can be off by, taken from the rotation tolerance before key reduction.
+    const float g_quaternionPackError = 1.5e-4f;
+    // Quantized components are read through a 64 bit window of two words.
+    const UINT g_maxComponentBits = 24;
+
+    /** Rotation angle between two unit quaternions. Goes through the chord length, acos of the dot product has no
+     *  precision left at the angles the tolerances are about. */
+    float GetAngle(FXMVECTOR a, FXMVECTOR b)
+    {
+        const XMVECTOR alignedB = XMVectorGetX(XMVector4Dot(a, b)) < 0.0f ? XMVectorNegate(b) : b;
+        const XMVECTOR chord = XMVectorSubtract(a, alignedB);
+        const float halfChord = 0.5f * sqrtf(XMVectorGetX(XMVector4Dot(chord, chord)));
+        return 4.0f * asinf(min(halfChord, 1.0f));
+    }
+
+    float GetDistance(FXMVECTOR a, FXMVECTOR b)
+    {
+        return XMVectorGetX(XMVector3Length(XMVectorSubtract(a, b)));
+    }
+
+    /** Greedy key reduction, isWithin(from, to, key) says whether key can be dropped between the kept keys from and to. */
+    template<typename Key, typename IsWithin>
+    void ReduceKeys(std::vector<Key>& inOutKeys, IsWithin isWithin)
+    {
+        if (inOutKeys.size() < 2)
+        {
+            return;
+        }
+        bool constant = true;
+        for (size_t key = 1; key < inOutKeys.size() && constant; key++)
+        {
+            constant = isWithin(inOutKeys[0], inOutKeys[0], inOutKeys[key]);
+        }
+        if (constant)
+        {
+            inOutKeys.resize(1);
+            return;
+        }
+
+        std::vector<Key> kept = { inOutKeys[0] };
+        size_t anchor = 0;
+        for (size_t next = 2; next < inOutKeys.size(); next++)
+        {
+            bool dropsAll = true;
+            for (size_t key = anchor + 1; key < next && dropsAll; key++)
+            {
+                dropsAll = isWithin(inOutKeys[anchor], inOutKeys[next], inOutKeys[key]);
+            }
+            if (!dropsAll)
+            {
+                anchor = next - 1;
+                kept.push_back(inOutKeys[anchor]);
+            }
+        }
+        kept.push_back(inOutKeys.back());
+        inOutKeys.swap(kept);
+    }
+
+    float GetBlend(float from, float to, float time)
+    {
+        return to > from ? (time - from) / (to - from) : 0.0f;
+    }
+
+    UINT16 QuantizeTime(float time, float duration)
+    {
+        const float normalized = duration > 0.0f ? min(max(time / duration, 0.0f), 1.0f) : 0.0f;
+        return static_cast<UINT16>(normalized * REV_ANIMATION_TIME_STEPS + 0.5f);
+    }
+
+    void WriteBits(std::vector<UINT32>& bits, UINT64 bitOffset, UINT value, UINT count)
+    {
+        for (UINT bit = 0; bit < count; bit++, bitOffset++)
+        {
+            if ((value >> bit) & 1)
+            {
+                bits[bitOffset >> 5] |= 1u << (bitOffset & 31);
+            }
+        }
+    }
+
+    UINT ReadBits(const std::vector<UINT32>& bits, UINT bitOffset, UINT count)
+    {
+        const UINT word = bitOffset >> 5;
+        const UINT64 window = bits[word] | (static_cast<UINT64>(bits[word + 1]) << 32);
+        return static_cast<UINT>((window >> (bitOffset & 31)) & ((1ull << count) - 1));
+    }
+
+    /** Appends the key times of a curve, returning their offset. */
+    template<typename Key>
+    UINT AppendTimes(const std::vector<Key>& keys, float duration, RevAnimationClip& outClip)
+    {
+        const UINT offset = static_cast<UINT>(outClip.m_keyTimes.size());
+        for (const Key& key : keys)
+        {
+            outClip.m_keyTimes.push_back(QuantizeTime(key.m_time, duration));
+        }
+        return offset;
+    }
+
+    /** Picks per component bit counts keeping the rounding error within tolerance and packs the keys. */
+    RevVectorCurve PackVectorCurve(const std::vector<RevVectorKey>& keys, float duration, float tolerance, RevAnimationClip& outClip, UINT64& inOutBitCount)
+    {
+        RevVectorCurve curve;
+        curve.m_timeOffset = AppendTimes(keys, duration, outClip);
+        curve.m_keyCount = static_cast<UINT>(keys.size());
+        curve.m_bitOffset = static_cast<UINT>(inOutBitCount);
+
+        float* minimum = &curve.m_min.x;
+        float* step = &curve.m_step.x;
+        for (UINT component = 0; component < 3; component++)
+        {
+            float low = (&keys[0].m_value.x)[component];
+            float high = low;
+            for (const RevVectorKey& key : keys)
+            {
+                low = min(low, (&key.m_value.x)[component]);
+                high = max(high, (&key.m_value.x)[component]);
+            }
+            // Rounding is off by half a step at most.
+            const float steps = ceilf((high - low) / (2.0f * tolerance));
+            UINT bits = 0;
+            while (bits < g_maxComponentBits && static_cast<float>((1u << bits) - 1) < steps)
+            {
+                bits++;
+            }
+            minimum[component] = low;
+            step[component] = bits > 0 ? (high - low) / static_cast<float>((1u << bits) - 1) : 0.0f;
+            curve.m_bits[component] = static_cast<UINT8>(bits);
+        }
+
+        const UINT keyBits = curve.GetKeyBits();
+        outClip.m_vectorBits.resize(static_cast<size_t>((inOutBitCount + keyBits * keys.size() + 31) / 32) + 1, 0);
+        for (const RevVectorKey& key : keys)
+        {
+            for (UINT component = 0; component < 3; component++)
+            {
+                const UINT bits = curve.m_bits[component];
+                if (bits > 0)
+                {
+                    const float value = ((&key.m_value.x)[component] - minimum[component]) / step[component];
+                    const UINT quantized = min(static_cast<UINT>(max(value, 0.0f) + 0.5f), (1u << bits) - 1);
+                    WriteBits(outClip.m_vectorBits, inOutBitCount, quantized, bits);
+                    inOutBitCount += bits;
+                }
+            }
+        }
+        return curve;
+    }
+}
+
+void RevAnimationCompression::CompressClip(const RevRawAnimationClip& rawClip, RevAnimationClip& outClip)
+{
+    outClip = {};
+    outClip.m_name = rawClip.m_name;
+    outClip.m_duration = rawClip.m_duration;
+    outClip.m_tracks.resize(rawClip.m_tracks.size());
+    UINT64 bitCount = 0;
+    for (size_t joint = 0; joint < rawClip.m_tracks.size(); joint++)
+    {
+        const RevRawJointTrack& rawTrack = rawClip.m_tracks[joint];
+        assert(!rawTrack.m_translations.empty() && !rawTrack.m_rotations.empty() && !rawTrack.m_scales.empty());
+        RevJointTrack& track = outClip.m_tracks[joint];
+
+        std::vector<RevVectorKey> translations = rawTrack.m_translations;
+        ReduceVectorKeys(translations, REV_ANIMATION_TRANSLATION_TOLERANCE * 0.5f);
+        track.m_translation = PackVectorCurve(translations, rawClip.m_duration, REV_ANIMATION_TRANSLATION_TOLERANCE * 0.5f, outClip, bitCount);
+
+        std::vector<RevRotationKey> rotations = rawTrack.m_rotations;
+        ReduceRotationKeys(rotations, REV_ANIMATION_ROTATION_TOLERANCE - g_quaternionPackError);
+        track.m_rotation.m_timeOffset = AppendTimes(rotations, rawClip.m_duration, outClip);
+        track.m_rotation.m_keyCount = static_cast<UINT>(rotations.size());
+        track.m_rotation.m_valueOffset = static_cast<UINT>(outClip.m_rotations.size());
+        for (const RevRotationKey& rotation : rotations)
+        {
+            outClip.m_rotations.push_back(PackQuaternion(XMLoadFloat4(&rotation.m_value)));
+        }
+
+        std::vector<RevVectorKey> scales = rawTrack.m_scales;
+        ReduceVectorKeys(scales, REV_ANIMATION_SCALE_TOLERANCE * 0.5f);
+        track.m_scale = PackVectorCurve(scales, rawClip.m_duration, REV_ANIMATION_SCALE_TOLERANCE * 0.5f, outClip, bitCount);
+    }
+    assert(bitCount <= UINT_MAX);
+    if (outClip.m_vectorBits.empty())
+    {
+        outClip.m_vectorBits.resize(2, 0);
+    }
+}
+
+void RevAnimationCompression::ReduceVectorKeys(std::vector<RevVectorKey>& inOutKeys, float tolerance)
+{
+    ReduceKeys(inOutKeys, [tolerance](const RevVectorKey& from, const RevVectorKey& to, const RevVectorKey& key)
+    {
+        const XMVECTOR blended = XMVectorLerp(XMLoadFloat3(&from.m_value), XMLoadFloat3(&to.m_value), GetBlend(from.m_time, to.m_time, key.m_time));
+        return GetDistance(blended, XMLoadFloat3(&key.m_value)) <= tolerance;
+    });
+}
+
+void RevAnimationCompression::ReduceRotationKeys(std::vector<RevRotationKey>& inOutKeys, float tolerance)
+{
+    ReduceKeys(inOutKeys, [tolerance](const RevRotationKey& from, const RevRotationKey& to, const RevRotationKey& key)
+    {
+        const XMVECTOR blended = XMQuaternionSlerp(XMLoadFloat4(&from.m_value), XMLoadFloat4(&to.m_value), GetBlend(from.m_time, to.m_time, key.m_time));
+        return GetAngle(blended, XMLoadFloat4(&key.m_value)) <= tolerance;
+    });
+}
+
+RevPackedQuaternion RevAnimationCompression::PackQuaternion(FXMVECTOR rotation)
+{
+    XMFLOAT4 value;
+    XMStoreFloat4(&value, rotation);
+    float* components = &value.x;
+    UINT largest = 0;
+    for (UINT component = 1; component < 4; component++)
+    {
+        largest = fabsf(components[component]) > fabsf(components[largest]) ? component : largest;
+    }
+    // q and -q are the same rotation, flipping to a positive largest component lets it be rebuilt from the others.
+    const float sign = components[largest] < 0.0f ? -1.0f : 1.0f;
+
+    UINT64 packed = largest;
+    for (UINT component = 0; component < 4; component++)
+    {
+        if (component == largest)
+        {
+            continue;
+        }
+        const float normalized = (components[component] * sign + g_quaternionComponentRange) / (2.0f * g_quaternionComponentRange);
+        const UINT quantized = static_cast<UINT>(min(max(normalized, 0.0f), 1.0f) * g_quaternionComponentMax + 0.5f);
+        packed = (packed << g_quaternionComponentBits) | quantized;
+    }
+
+    RevPackedQuaternion result;
+    result.m_bits[0] = static_cast<UINT16>(packed);
+    result.m_bits[1] = static_cast<UINT16>(packed >> 16);
+    result.m_bits[2] = static_cast<UINT16>(packed >> 32);
+    return result;
+}
+
+XMFLOAT4 RevAnimationCompression::UnpackQuaternion(const RevPackedQuaternion& packed)
+{
+    const UINT64 bits = packed.m_bits[0] | (static_cast<UINT64>(packed.m_bits[1]) << 16) | (static_cast<UINT64>(packed.m_bits[2]) << 32);
+    const UINT largest = static_cast<UINT>(bits >> (3 * g_quaternionComponentBits)) & 3;
+
+    XMFLOAT4 result;
+    float* components = &result.x;
+    float sumOfSquares = 0.0f;
+    UINT shift = 3 * g_quaternionComponentBits;
+    for (UINT component = 0; component < 4; component++)
+    {
+        if (component == largest)
+        {
+            continue;
+        }
+        shift -= g_quaternionComponentBits;
+        const UINT quantized = static_cast<UINT>(bits >> shift) & g_quaternionComponentMax;
+        components[component] = (static_cast<float>(quantized) / g_quaternionComponentMax * 2.0f - 1.0f) * g_quaternionComponentRange;
+        sumOfSquares += components[component] * components[component];
+    }
+    components[largest] = sqrtf(max(1.0f - sumOfSquares, 0.0f));
+    return result;
+}
+
+XMFLOAT3 RevAnimationCompression::DecodeVector(const RevAnimationClip& clip, const RevVectorCurve& curve, UINT key)
+{
+    XMFLOAT3 result = curve.m_min;
+    float* components = &result.x;
+    const float* step = &curve.m_step.x;
+    UINT bitOffset = curve.m_bitOffset + key * curve.GetKeyBits();
+    for (UINT component = 0; component < 3; component++)
+    {
+        const UINT bits = curve.m_bits[component];
+        if (bits > 0)
+        {
+            components[component] += static_cast<float>(ReadBits(clip.m_vectorBits, bitOffset, bits)) * step[component];
+            bitOffset += bits;
+        }
+    }
+    return result;
+}
@@ -0,0 +1,23 @@
+﻿#pragma once
+#include <vector>
+#include "RevAnimationTypes.h"
+
+class RevAnimationCompression
+{
+public:
+
+    /** Drops the keys their neighbours interpolate within the REV_ANIMATION_*_TOLERANCE of the curve, then quantizes
+     *  and packs the rest. Half of every tolerance goes to key reduction, the other half to quantization. */
+    static void CompressClip(const RevRawAnimationClip& rawClip, RevAnimationClip& outClip);
+
+    /** Keeps the first and last key plus every key the kept keys around it do not lerp within tolerance,
+     *  a curve that never leaves tolerance of its first key collapses to that key. */
+    static void ReduceVectorKeys(std::vector<RevVectorKey>& inOutKeys, float tolerance);
+    /** As ReduceVectorKeys with slerp, tolerance is the rotation angle in radians. */
+    static void ReduceRotationKeys(std::vector<RevRotationKey>& inOutKeys, float tolerance);
+
+    static RevPackedQuaternion PackQuaternion(DirectX::FXMVECTOR rotation);
+    static DirectX::XMFLOAT4 UnpackQuaternion(const RevPackedQuaternion& packed);
+    /** Value of key of curve. */
+    static DirectX::XMFLOAT3 DecodeVector(const RevAnimationClip& clip, const RevVectorCurve& curve, UINT key);
+};
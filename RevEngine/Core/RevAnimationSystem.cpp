@@ -0,0 +1,556 @@
+#include "stdafx.h"
+#include "RevAnimationSystem.h"
+#include <algorithm>
+#include <cmath>
+#include "RevAnimationCompression.h"
+#include "RevFrameArena.h"
+#include "RevJobSystem.h"
+
+namespace
+{
+    // Every instance is a full sample and hierarchy pass, enough work for a batch of its own.
+    const UINT g_instancesPerBatch = 1;
+    // Blending skinning matrices is a few loads per joint, instances are handed out in groups.
+    const UINT g_blendsPerBatch = 16;
+    // Root sizes in pixels from which an instance is evaluated every frame, every second and every fourth frame.
+    // Smaller instances are evaluated every g_maxUpdateInterval frames, like off-screen ones.
+    const float g_updateIntervalPixels[] = { 256.0f, 128.0f, 64.0f };
+    const UINT g_maxUpdateInterval = 8;
+    // Evaluation cost per sampled joint before the first measurement, and the weight of each new frame in it.
+    const float g_initialMicrosecondsPerJoint = 0.1f;
+    const float g_costSmoothing = 0.1f;
+    // Only levels wider than this are split over threads when a single instance is evaluated.
+    const UINT g_jointsPerBatch = 256;
+    // Above this cosine the quaternions are close enough for a normalized lerp.
+    const float g_slerpThreshold = 0.9995f;
+
+    enum RevSoaComponent
+    {
+        TranslationX, TranslationY, TranslationZ,
+        RotationX, RotationY, RotationZ, RotationW,
+        ScaleX, ScaleY, ScaleZ,
+        ComponentCount
+    };
+
+    struct RevScheduledEvaluation
+    {
+        RevAnimationInstance* m_instance = nullptr;
+        UINT m_interval = 1;
+        UINT m_activeJoints = 0;
+        // Frames overdue relative to the interval, the most overdue evaluations run first.
+        float m_priority = 0.0f;
+        float m_microseconds = 0.0f;
+    };
+
+    // Cost estimate of the scheduler, Update only runs on the main thread.
+    float g_microsecondsPerJoint = g_initialMicrosecondsPerJoint;
+
+    float GetMicroseconds(const LARGE_INTEGER& begin, const LARGE_INTEGER& end)
+    {
+        static LARGE_INTEGER s_frequency = {};
+        if (s_frequency.QuadPart == 0)
+        {
+            QueryPerformanceFrequency(&s_frequency);
+        }
+        return static_cast<float>(static_cast<double>(end.QuadPart - begin.QuadPart) * 1.0e6 / static_cast<double>(s_frequency.QuadPart));
+    }
+
+    /** Keys around the sample time of four joints, gathered lane by lane before the SoA blend. */
+    struct RevSoaKeys
+    {
+        XMFLOAT4A m_from[ComponentCount];
+        XMFLOAT4A m_to[ComponentCount];
+        // Blend factors of the translation, rotation and scale keys.
+        XMFLOAT4A m_alpha[3];
+    };
+
+    float& Lane(XMFLOAT4A& value, UINT lane)
+    {
+        return (&value.x)[lane];
+    }
+
+    /** Moves cursor to the last key at or before keyTime, walking from where the previous sample left it so playback
+     *  costs O(1) amortised per curve in either direction. Returns the blend factor towards the next key,
+     *  times outside the keys clamp. */
+    float SeekKey(const UINT16* times, UINT count, float keyTime, UINT& inOutCursor)
+    {
+        UINT key = min(inOutCursor, count - 1);
+        while (key > 0 && times[key] > keyTime)
+        {
+            key--;
+        }
+        while (key + 1 < count && times[key + 1] <= keyTime)
+        {
+            key++;
+        }
+        inOutCursor = key;
+        if (key + 1 >= count || keyTime <= times[key])
+        {
+            return 0.0f;
+        }
+        return (keyTime - times[key]) / static_cast<float>(times[key + 1] - times[key]);
+    }
+
+    float SampleCurve(const RevAnimationClip& clip, const RevVectorCurve& curve, float keyTime, UINT& inOutCursor, XMFLOAT3& outFrom, XMFLOAT3& outTo)
+    {
+        const float alpha = SeekKey(clip.m_keyTimes.data() + curve.m_timeOffset, curve.m_keyCount, keyTime, inOutCursor);
+        outFrom = RevAnimationCompression::DecodeVector(clip, curve, inOutCursor);
+        outTo = alpha > 0.0f ? RevAnimationCompression::DecodeVector(clip, curve, inOutCursor + 1) : outFrom;
+        return alpha;
+    }
+
+    float SampleCurve(const RevAnimationClip& clip, const RevRotationCurve& curve, float keyTime, UINT& inOutCursor, XMFLOAT4& outFrom, XMFLOAT4& outTo)
+    {
+        const float alpha = SeekKey(clip.m_keyTimes.data() + curve.m_timeOffset, curve.m_keyCount, keyTime, inOutCursor);
+        const RevPackedQuaternion* rotations = clip.m_rotations.data() + curve.m_valueOffset;
+        outFrom = RevAnimationCompression::UnpackQuaternion(rotations[inOutCursor]);
+        outTo = alpha > 0.0f ? RevAnimationCompression::UnpackQuaternion(rotations[inOutCursor + 1]) : outFrom;
+        return alpha;
+    }
+
+    void SetLanes(RevSoaKeys& keys, UINT component, UINT lane, const XMFLOAT3& from, const XMFLOAT3& to)
+    {
+        Lane(keys.m_from[component], lane) = from.x;
+        Lane(keys.m_from[component + 1], lane) = from.y;
+        Lane(keys.m_from[component + 2], lane) = from.z;
+        Lane(keys.m_to[component], lane) = to.x;
+        Lane(keys.m_to[component + 1], lane) = to.y;
+        Lane(keys.m_to[component + 2], lane) = to.z;
+    }
+
+    void SetLanes(RevSoaKeys& keys, UINT component, UINT lane, const XMFLOAT4& from, const XMFLOAT4& to)
+    {
+        SetLanes(keys, component, lane, XMFLOAT3(from.x, from.y, from.z), XMFLOAT3(to.x, to.y, to.z));
+        Lane(keys.m_from[component + 3], lane) = from.w;
+        Lane(keys.m_to[component + 3], lane) = to.w;
+    }
+
+    /** Padding lanes of the last group hold the identity. */
+    void SetIdentityLane(RevSoaKeys& keys, UINT lane)
+    {
+        SetLanes(keys, TranslationX, lane, XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(0.0f, 0.0f, 0.0f));
+        SetLanes(keys, RotationX, lane, XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f), XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f));
+        SetLanes(keys, ScaleX, lane, XMFLOAT3(1.0f, 1.0f, 1.0f), XMFLOAT3(1.0f, 1.0f, 1.0f));
+        for (XMFLOAT4A& alpha : keys.m_alpha)
+        {
+            Lane(alpha, lane) = 0.0f;
+        }
+    }
+
+    XMVECTOR LerpComponent(const RevSoaKeys& keys, UINT component, FXMVECTOR alpha)
+    {
+        return XMVectorLerpV(XMLoadFloat4A(&keys.m_from[component]), XMLoadFloat4A(&keys.m_to[component]), alpha);
+    }
+
+    void BlendKeys(const RevSoaKeys& keys, RevSoaTransform& outTransform)
+    {
+        const XMVECTOR translationAlpha = XMLoadFloat4A(&keys.m_alpha[0]);
+        outTransform.m_translationX = LerpComponent(keys, TranslationX, translationAlpha);
+        outTransform.m_translationY = LerpComponent(keys, TranslationY, translationAlpha);
+        outTransform.m_translationZ = LerpComponent(keys, TranslationZ, translationAlpha);
+
+        XMVECTOR from[4];
+        XMVECTOR to[4];
+        XMVECTOR rotation[4];
+        for (UINT component = 0; component < 4; component++)
+        {
+            from[component] = XMLoadFloat4A(&keys.m_from[RotationX + component]);
+            to[component] = XMLoadFloat4A(&keys.m_to[RotationX + component]);
+        }
+        RevAnimationSystem::SoaSlerp(from, to, XMLoadFloat4A(&keys.m_alpha[1]), rotation);
+        outTransform.m_rotationX = rotation[0];
+        outTransform.m_rotationY = rotation[1];
+        outTransform.m_rotationZ = rotation[2];
+        outTransform.m_rotationW = rotation[3];
+
+        const XMVECTOR scaleAlpha = XMLoadFloat4A(&keys.m_alpha[2]);
+        outTransform.m_scaleX = LerpComponent(keys, ScaleX, scaleAlpha);
+        outTransform.m_scaleY = LerpComponent(keys, ScaleY, scaleAlpha);
+        outTransform.m_scaleZ = LerpComponent(keys, ScaleZ, scaleAlpha);
+    }
+}
+
+void RevAnimationInstance::Initialize(const RevAnimationData* data)
+{
+    m_data = data;
+    m_clip = 0;
+    m_time = 0.0f;
+    m_updateInterval = 1;
+    m_framesSinceEvaluation = 0;
+    const UINT numJoints = data ? data->m_skeleton.GetNumJoints() : 0;
+    m_localPose.resize((numJoints + 3) / 4);
+    m_modelPose.resize(numJoints);
+    m_cursors.assign(numJoints * 3, 0);
+    m_activeJoints.assign(numJoints, 1);
+    // Culled joints keep the local transform of an earlier evaluation, so the first one samples everything.
+    RevAnimationSystem::Evaluate(*this, 0.0f);
+    m_toSkinningMatrices.resize(numJoints);
+    m_skinningMatrices = m_toSkinningMatrices;
+    m_fromSkinningMatrices = m_toSkinningMatrices;
+}
+
+void RevAnimationSystem::Update(RevAnimationView* views, UINT count, float delta)
+{
+    RevFrameVector<RevScheduledEvaluation> dueEvaluations;
+    dueEvaluations.reserve(count);
+    for (UINT index = 0; index < count; index++)
+    {
+        const RevAnimationView& view = views[index];
+        assert(view.m_instance);
+        RevAnimationInstance& instance = *view.m_instance;
+        if (!instance.m_data || instance.m_clip >= instance.m_data->m_clips.size())
+        {
+            continue;
+        }
+        Advance(instance, delta);
+        instance.m_framesSinceEvaluation++;
+        instance.m_visible = view.m_visible;
+
+        const RevSkeleton& skeleton = instance.m_data->m_skeleton;
+        const float rootPixels = skeleton.m_jointRadii.empty() ? 0.0f : skeleton.m_jointRadii[0] * view.m_pixelsPerUnit;
+        const UINT interval = view.m_pixelsPerUnit > 0.0f ? SelectUpdateInterval(rootPixels, view.m_visible) : 1;
+        if (instance.m_framesSinceEvaluation < interval)
+        {
+            continue;
+        }
+        RevScheduledEvaluation evaluation;
+        evaluation.m_instance = &instance;
+        evaluation.m_interval = interval;
+        evaluation.m_activeJoints = SelectActiveJoints(skeleton, view.m_pixelsPerUnit, instance.m_activeJoints);
+        evaluation.m_priority = static_cast<float>(instance.m_framesSinceEvaluation) / static_cast<float>(interval);
+        dueEvaluations.push_back(evaluation);
+    }
+
+    // Deferred evaluations stay due and gain priority every frame, so nothing starves while over budget.
+    std::sort(dueEvaluations.begin(), dueEvaluations.end(), [](const RevScheduledEvaluation& a, const RevScheduledEvaluation& b)
+    {
+        return a.m_priority > b.m_priority;
+    });
+    UINT numScheduled = 0;
+    float estimate = 0.0f;
+    for (; numScheduled < dueEvaluations.size(); numScheduled++)
+    {
+        const float cost = dueEvaluations[numScheduled].m_activeJoints * g_microsecondsPerJoint;
+        // The most overdue one always runs so even a tiny budget makes progress.
+        if (numScheduled > 0 && estimate + cost > REV_ANIMATION_BUDGET_US)
+        {
+            break;
+        }
+        estimate += cost;
+    }
+
+    RevJobSystem::ParallelFor(numScheduled, g_instancesPerBatch, [delta, &dueEvaluations](UINT begin, UINT end)
+    {
+        for (UINT index = begin; index < end; index++)
+        {
+            LARGE_INTEGER start;
+            QueryPerformanceCounter(&start);
+            RevScheduledEvaluation& evaluation = dueEvaluations[index];
+            RevAnimationInstance& instance = *evaluation.m_instance;
+            // The pose is sampled where playback will be when the next evaluation is due and blended towards.
+            instance.m_fromSkinningMatrices = instance.m_skinningMatrices;
+            Evaluate(instance, WrapTime(instance, instance.m_time + (evaluation.m_interval - 1) * delta * instance.m_speed));
+            instance.m_updateInterval = evaluation.m_interval;
+            instance.m_framesSinceEvaluation = 0;
+            LARGE_INTEGER stop;
+            QueryPerformanceCounter(&stop);
+            evaluation.m_microseconds = GetMicroseconds(start, stop);
+        }
+    });
+
+    float measured = 0.0f;
+    UINT measuredJoints = 0;
+    for (UINT index = 0; index < numScheduled; index++)
+    {
+        measured += dueEvaluations[index].m_microseconds;
+        measuredJoints += dueEvaluations[index].m_activeJoints;
+    }
+    if (measuredJoints > 0)
+    {
+        g_microsecondsPerJoint += (measured / measuredJoints - g_microsecondsPerJoint) * g_costSmoothing;
+    }
+
+    RevJobSystem::ParallelFor(count, g_blendsPerBatch, [views](UINT begin, UINT end)
+    {
+        for (UINT index = begin; index < end; index++)
+        {
+            BlendSkinning(*views[index].m_instance);
+        }
+    });
+}
+
+void RevAnimationSystem::Advance(RevAnimationInstance& instance, float delta)
+{
+    if (!instance.m_data || instance.m_clip >= instance.m_data->m_clips.size())
+    {
+        return;
+    }
+    instance.m_time = WrapTime(instance, instance.m_time + delta * instance.m_speed);
+}
+
+float RevAnimationSystem::WrapTime(const RevAnimationInstance& instance, float time)
+{
+    const float duration = instance.m_data->m_clips[instance.m_clip].m_duration;
+    if (duration <= 0.0f)
+    {
+        return 0.0f;
+    }
+    if (instance.m_loop)
+    {
+        time = fmodf(time, duration);
+        return time < 0.0f ? time + duration : time;
+    }
+    return min(max(time, 0.0f), duration);
+}
+
+void RevAnimationSystem::Evaluate(RevAnimationInstance& instance, float time)
+{
+    if (!instance.m_data || instance.m_clip >= instance.m_data->m_clips.size())
+    {
+        return;
+    }
+    const RevSkeleton& skeleton = instance.m_data->m_skeleton;
+    const RevAnimationClip& clip = instance.m_data->m_clips[instance.m_clip];
+    assert(clip.m_tracks.size() == skeleton.GetNumJoints());
+
+    const UINT8* activeJoints = instance.m_activeJoints.size() == skeleton.GetNumJoints() ? instance.m_activeJoints.data() : nullptr;
+    SampleClip(clip, time, instance.m_cursors, activeJoints, instance.m_localPose);
+    LocalToModel(skeleton, instance.m_localPose, instance.m_modelPose);
+
+    instance.m_toSkinningMatrices.resize(skeleton.GetNumJoints());
+    for (UINT joint = 0; joint < skeleton.GetNumJoints(); joint++)
+    {
+        const XMMATRIX skinning = XMMatrixMultiply(
+            XMLoadFloat4x4(&skeleton.m_inverseBindPose[joint]),
+            XMLoadFloat4x4(&instance.m_modelPose[joint]));
+        XMStoreFloat4x4(&instance.m_toSkinningMatrices[joint], skinning);
+    }
+}
+
+void RevAnimationSystem::BlendSkinning(RevAnimationInstance& instance)
+{
+    const float alpha = min(static_cast<float>(instance.m_framesSinceEvaluation + 1) / static_cast<float>(instance.m_updateInterval), 1.0f);
+    if (alpha >= 1.0f || instance.m_fromSkinningMatrices.size() != instance.m_toSkinningMatrices.size())
+    {
+        instance.m_skinningMatrices = instance.m_toSkinningMatrices;
+        return;
+    }
+    // Per element lerp, the matrices are close enough between evaluations for the shear it adds to stay invisible.
+    instance.m_skinningMatrices.resize(instance.m_toSkinningMatrices.size());
+    for (size_t joint = 0; joint < instance.m_toSkinningMatrices.size(); joint++)
+    {
+        const XMMATRIX from = XMLoadFloat4x4(&instance.m_fromSkinningMatrices[joint]);
+        const XMMATRIX to = XMLoadFloat4x4(&instance.m_toSkinningMatrices[joint]);
+        XMMATRIX blended;
+        for (UINT row = 0; row < 4; row++)
+        {
+            blended.r[row] = XMVectorLerp(from.r[row], to.r[row], alpha);
+        }
+        XMStoreFloat4x4(&instance.m_skinningMatrices[joint], blended);
+    }
+}
+
+UINT RevAnimationSystem::SelectUpdateInterval(float rootPixels, bool visible)
+{
+    if (!visible)
+    {
+        return g_maxUpdateInterval;
+    }
+    UINT interval = 1;
+    for (float pixels : g_updateIntervalPixels)
+    {
+        if (rootPixels >= pixels)
+        {
+            return interval;
+        }
+        interval *= 2;
+    }
+    return g_maxUpdateInterval;
+}
+
+UINT RevAnimationSystem::SelectActiveJoints(const RevSkeleton& skeleton, float pixelsPerUnit, std::vector<UINT8>& outActiveJoints)
+{
+    const UINT numJoints = skeleton.GetNumJoints();
+    if (pixelsPerUnit <= 0.0f || skeleton.m_jointRadii.size() != numJoints)
+    {
+        outActiveJoints.assign(numJoints, 1);
+        return numJoints;
+    }
+    // Radii shrink down the hierarchy, so the culled joints are always whole subtrees.
+    outActiveJoints.resize(numJoints);
+    UINT numActive = 0;
+    for (UINT joint = 0; joint < numJoints; joint++)
+    {
+        outActiveJoints[joint] = joint == 0 || skeleton.m_jointRadii[joint] * pixelsPerUnit >= REV_ANIMATION_MIN_JOINT_PIXELS;
+        numActive += outActiveJoints[joint];
+    }
+    return numActive;
+}
+
+void RevAnimationSystem::SampleClip(const RevAnimationClip& clip, float time, std::vector<UINT>& inOutCursors, const UINT8* activeJoints, std::vector<RevSoaTransform>& inOutPose)
+{
+    const UINT numJoints = static_cast<UINT>(clip.m_tracks.size());
+    // Cursors of another clip are just a poor starting point, the seek corrects them.
+    inOutCursors.resize(numJoints * 3, 0);
+    const float keyTime = clip.m_duration > 0.0f ? time / clip.m_duration * REV_ANIMATION_TIME_STEPS : 0.0f;
+    const UINT numGroups = (numJoints + 3) / 4;
+    inOutPose.resize(numGroups);
+    for (UINT group = 0; group < numGroups; group++)
+    {
+        RevSoaKeys keys;
+        UINT laneMask[4] = {};
+        bool allActive = true;
+        bool anyActive = false;
+        for (UINT lane = 0; lane < 4; lane++)
+        {
+            const UINT joint = group * 4 + lane;
+            const bool active = joint < numJoints && (!activeJoints || activeJoints[joint]);
+            laneMask[lane] = active ? 0xFFFFFFFF : 0;
+            // Padding lanes count as active, their identity is as good as any.
+            allActive &= active || joint >= numJoints;
+            anyActive |= active;
+            if (!active)
+            {
+                SetIdentityLane(keys, lane);
+                continue;
+            }
+            const RevJointTrack& track = clip.m_tracks[joint];
+            UINT* cursors = inOutCursors.data() + joint * 3;
+
+            XMFLOAT3 vectorFrom;
+            XMFLOAT3 vectorTo;
+            Lane(keys.m_alpha[0], lane) = SampleCurve(clip, track.m_translation, keyTime, cursors[0], vectorFrom, vectorTo);
+            SetLanes(keys, TranslationX, lane, vectorFrom, vectorTo);
+
+            XMFLOAT4 rotationFrom;
+            XMFLOAT4 rotationTo;
+            Lane(keys.m_alpha[1], lane) = SampleCurve(clip, track.m_rotation, keyTime, cursors[1], rotationFrom, rotationTo);
+            SetLanes(keys, RotationX, lane, rotationFrom, rotationTo);
+
+            Lane(keys.m_alpha[2], lane) = SampleCurve(clip, track.m_scale, keyTime, cursors[2], vectorFrom, vectorTo);
+            SetLanes(keys, ScaleX, lane, vectorFrom, vectorTo);
+        }
+        if (allActive)
+        {
+            BlendKeys(keys, inOutPose[group]);
+            continue;
+        }
+        if (!anyActive)
+        {
+            continue;
+        }
+        RevSoaTransform sampled;
+        BlendKeys(keys, sampled);
+        const XMVECTOR control = XMVectorSetInt(laneMask[0], laneMask[1], laneMask[2], laneMask[3]);
+        XMVECTOR* target = &inOutPose[group].m_translationX;
+        const XMVECTOR* source = &sampled.m_translationX;
+        for (UINT component = 0; component < ComponentCount; component++)
+        {
+            target[component] = XMVectorSelect(target[component], source[component], control);
+        }
+    }
+}
+
+void RevAnimationSystem::LocalToModel(const RevSkeleton& skeleton, const std::vector<RevSoaTransform>& localPose, std::vector<XMFLOAT4X4>& outModelPose)
+{
+    const UINT numJoints = skeleton.GetNumJoints();
+    outModelPose.resize(numJoints);
+    RevJobSystem::ParallelFor(static_cast<UINT>(localPose.size()), g_jointsPerBatch / 4, [&](UINT begin, UINT end)
+    {
+        for (UINT group = begin; group < end; group++)
+        {
+            XMMATRIX matrices[4];
+            SoaToMatrices(localPose[group], matrices);
+            for (UINT lane = 0; lane < 4 && group * 4 + lane < numJoints; lane++)
+            {
+                XMStoreFloat4x4(&outModelPose[group * 4 + lane], matrices[lane]);
+            }
+        }
+    });
+
+    // Roots are in model space already, every later level only reads parents of finished levels.
+    for (UINT level = 1; level < skeleton.GetNumLevels(); level++)
+    {
+        const UINT first = skeleton.m_levelOffsets[level];
+        const UINT count = skeleton.m_levelOffsets[level + 1] - first;
+        RevJobSystem::ParallelFor(count, g_jointsPerBatch, [&](UINT begin, UINT end)
+        {
+            for (UINT joint = first + begin; joint < first + end; joint++)
+            {
+                const XMMATRIX parent = XMLoadFloat4x4(&outModelPose[skeleton.m_parents[joint]]);
+                XMStoreFloat4x4(&outModelPose[joint], XMMatrixMultiply(XMLoadFloat4x4(&outModelPose[joint]), parent));
+            }
+        });
+    }
+}
+
+void RevAnimationSystem::SoaSlerp(const XMVECTOR from[4], const XMVECTOR to[4], FXMVECTOR alpha, XMVECTOR outRotation[4])
+{
+    XMVECTOR cosine = XMVectorZero();
+    for (UINT component = 0; component < 4; component++)
+    {
+        cosine = XMVectorMultiplyAdd(from[component], to[component], cosine);
+    }
+    // q and -q are the same rotation, flipping the target keeps the blend on the shortest arc.
+    const XMVECTOR flip = XMVectorLess(cosine, XMVectorZero());
+    cosine = XMVectorAbs(cosine);
+
+    const XMVECTOR angle = XMVectorACos(XMVectorMin(cosine, g_XMOne));
+    const XMVECTOR inverseSine = XMVectorReciprocal(XMVectorSin(angle));
+    XMVECTOR fromWeight = XMVectorSin((g_XMOne - alpha) * angle) * inverseSine;
+    XMVECTOR toWeight = XMVectorSin(alpha * angle) * inverseSine;
+    // The sine goes to zero for nearly equal rotations, a normalized lerp is exact enough there.
+    const XMVECTOR nearlyEqual = XMVectorGreater(cosine, XMVectorReplicate(g_slerpThreshold));
+    fromWeight = XMVectorSelect(fromWeight, g_XMOne - alpha, nearlyEqual);
+    toWeight = XMVectorSelect(toWeight, alpha, nearlyEqual);
+    toWeight = XMVectorSelect(toWeight, XMVectorNegate(toWeight), flip);
+
+    XMVECTOR lengthSquared = XMVectorZero();
+    for (UINT component = 0; component < 4; component++)
+    {
+        outRotation[component] = XMVectorMultiplyAdd(to[component], toWeight, from[component] * fromWeight);
+        lengthSquared = XMVectorMultiplyAdd(outRotation[component], outRotation[component], lengthSquared);
+    }
+    const XMVECTOR inverseLength = XMVectorReciprocalSqrt(lengthSquared);
+    for (UINT component = 0; component < 4; component++)
+    {
+        outRotation[component] *= inverseLength;
+    }
+}
+
+void RevAnimationSystem::SoaToMatrices(const RevSoaTransform& transform, XMMATRIX outMatrices[4])
+{
+    const XMVECTOR x = transform.m_rotationX;
+    const XMVECTOR y = transform.m_rotationY;
+    const XMVECTOR z = transform.m_rotationZ;
+    const XMVECTOR w = transform.m_rotationW;
+    const XMVECTOR x2 = x + x;
+    const XMVECTOR y2 = y + y;
+    const XMVECTOR z2 = z + z;
+    const XMVECTOR xx = x * x2;
+    const XMVECTOR yy = y * y2;
+    const XMVECTOR zz = z * z2;
+    const XMVECTOR xy = x * y2;
+    const XMVECTOR xz = x * z2;
+    const XMVECTOR yz = y * z2;
+    const XMVECTOR wx = w * x2;
+    const XMVECTOR wy = w * y2;
+    const XMVECTOR wz = w * z2;
+    const XMVECTOR one = g_XMOne;
+    const XMVECTOR zero = XMVectorZero();
+
+    // Rows of scale * rotation * translation for all four joints, same layout as XMMatrixAffineTransformation.
+    // Transposing turns the component vectors into one row per joint.
+    const XMMATRIX row0 = XMMatrixTranspose(XMMATRIX(
+        (one - (yy + zz)) * transform.m_scaleX, (xy + wz) * transform.m_scaleX, (xz - wy) * transform.m_scaleX, zero));
+    const XMMATRIX row1 = XMMatrixTranspose(XMMATRIX(
+        (xy - wz) * transform.m_scaleY, (one - (xx + zz)) * transform.m_scaleY, (yz + wx) * transform.m_scaleY, zero));
+    const XMMATRIX row2 = XMMatrixTranspose(XMMATRIX(
+        (xz + wy) * transform.m_scaleZ, (yz - wx) * transform.m_scaleZ, (one - (xx + yy)) * transform.m_scaleZ, zero));
+    const XMMATRIX row3 = XMMatrixTranspose(XMMATRIX(
+        transform.m_translationX, transform.m_translationY, transform.m_translationZ, one));
+    for (UINT lane = 0; lane < 4; lane++)
+    {
+        outMatrices[lane] = XMMATRIX(row0.r[lane], row1.r[lane], row2.r[lane], row3.r[lane]);
+    }
+}
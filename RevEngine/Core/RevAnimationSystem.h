@@ -0,0 +1,102 @@
+﻿#pragma once
+#include <vector>
+#include "RevAnimationTypes.h"
+
+/** Local transforms of four joints in structure of arrays form, lane i of every member belongs to joint 4 * n + i.
+ *  Rotations are unit quaternions. */
+struct RevSoaTransform
+{
+    DirectX::XMVECTOR m_translationX;
+    DirectX::XMVECTOR m_translationY;
+    DirectX::XMVECTOR m_translationZ;
+    DirectX::XMVECTOR m_rotationX;
+    DirectX::XMVECTOR m_rotationY;
+    DirectX::XMVECTOR m_rotationZ;
+    DirectX::XMVECTOR m_rotationW;
+    DirectX::XMVECTOR m_scaleX;
+    DirectX::XMVECTOR m_scaleY;
+    DirectX::XMVECTOR m_scaleZ;
+};
+
+/** Playback state and evaluated pose of one animated instance. */
+struct RevAnimationInstance
+{
+    /** Sizes the pose buffers for data, which has to outlive the instance. */
+    void Initialize(const RevAnimationData* data);
+
+    const RevAnimationData* m_data = nullptr;
+    UINT m_clip = 0;
+    float m_time = 0.0f;
+    float m_speed = 1.0f;
+    bool m_loop = true;
+
+    // Animation LOD state, see RevAnimationSystem::Update. The last evaluation sampled the pose m_updateInterval
+    // frames ahead and the skinning matrices blend towards it over those frames.
+    UINT m_updateInterval = 1;
+    UINT m_framesSinceEvaluation = 0;
+    bool m_visible = true;
+    // Per joint, whether the next evaluation samples it. Culled joints keep their last local transform.
+    std::vector<UINT8> m_activeJoints;
+
+    // One entry per four joints.
+    std::vector<RevSoaTransform> m_localPose;
+    // Joint to model space per joint.
+    std::vector<DirectX::XMFLOAT4X4> m_modelPose;
+    // Bind pose model space to animated model space per joint, what skinning multiplies vertexes with.
+    std::vector<DirectX::XMFLOAT4X4> m_skinningMatrices;
+    // Skinning matrices shown when the last evaluation ran and the ones it produced.
+    std::vector<DirectX::XMFLOAT4X4> m_fromSkinningMatrices;
+    std::vector<DirectX::XMFLOAT4X4> m_toSkinningMatrices;
+    // Key reached per curve of the current clip, translation, rotation and scale per joint.
+    std::vector<UINT> m_cursors;
+};
+
+/** How an instance is seen this frame, filled by the owner of the instances for the animation scheduler. */
+struct RevAnimationView
+{
+    RevAnimationInstance* m_instance = nullptr;
+    // Pixels one model space unit of the instance covers, 0 evaluates every joint every frame.
+    float m_pixelsPerUnit = 0.0f;
+    bool m_visible = true;
+};
+
+class RevAnimationSystem
+{
+public:
+
+    /** Advances every instance and evaluates the ones that are due. Small and off-screen instances are due every
+     *  few frames and only sample joints above REV_ANIMATION_MIN_JOINT_PIXELS, the due ones run most overdue first
+     *  until REV_ANIMATION_BUDGET_US is spent and the rest wait for a later frame. Evaluations are spread over
+     *  the job system, every instance blends its skinning matrices towards its latest evaluation. */
+    static void Update(RevAnimationView* views, UINT count, float delta);
+
+    /** Moves the playback time delta seconds forward, wrapping or clamping at the clip end. */
+    static void Advance(RevAnimationInstance& instance, float delta);
+    /** Playback time of instance wrapped or clamped into its clip. */
+    static float WrapTime(const RevAnimationInstance& instance, float time);
+    /** Samples the current clip at time and fills the model pose and m_toSkinningMatrices. */
+    static void Evaluate(RevAnimationInstance& instance, float time);
+    /** Blends m_skinningMatrices between the last two evaluations, matching the frames since the last one. */
+    static void BlendSkinning(RevAnimationInstance& instance);
+
+    /** Frames between evaluations for an instance whose whole skeleton covers rootPixels. */
+    static UINT SelectUpdateInterval(float rootPixels, bool visible);
+    /** Marks the joints of skeleton above REV_ANIMATION_MIN_JOINT_PIXELS active, returns how many are. */
+    static UINT SelectActiveJoints(const RevSkeleton& skeleton, float pixelsPerUnit, std::vector<UINT8>& outActiveJoints);
+
+    /** Local pose of every joint at time, blended between the surrounding keys four joints at a time.
+     *  The key search resumes at inOutCursors, so sampling close to the previous time skips it.
+     *  Joints activeJoints marks inactive keep their transform in inOutPose, nullptr samples every joint. */
+    static void SampleClip(const RevAnimationClip& clip, float time, std::vector<UINT>& inOutCursors, const UINT8* activeJoints, std::vector<RevSoaTransform>& inOutPose);
+    /** Concatenates the local pose down the hierarchy, level by level so every level runs in parallel. */
+    static void LocalToModel(const RevSkeleton& skeleton, const std::vector<RevSoaTransform>& localPose, std::vector<DirectX::XMFLOAT4X4>& outModelPose);
+
+    /** Per lane slerp of four quaternion pairs along the shortest arc, alpha holds the four blend factors. */
+    static void SoaSlerp(
+        const DirectX::XMVECTOR from[4],
+        const DirectX::XMVECTOR to[4],
+        DirectX::FXMVECTOR alpha,
+        DirectX::XMVECTOR outRotation[4]);
+    /** Affine matrices of the four joints of transform, built for all four lanes at once. */
+    static void SoaToMatrices(const RevSoaTransform& transform, DirectX::XMMATRIX outMatrices[4]);
+};
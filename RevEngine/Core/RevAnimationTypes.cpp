@@ -0,0 +1,53 @@
+#include "stdafx.h"
+#include "RevAnimationTypes.h"
+#include "RevArchive.h"
+
+void RevSkeleton::Serialize(RevArchive& archive)
+{
+    archive << m_parents;
+    archive << m_inverseBindPose;
+    archive << m_levelOffsets;
+    archive << m_jointRadii;
+    if (archive.IsLoading() && (m_inverseBindPose.size() != m_parents.size() || m_jointRadii.size() != m_parents.size()))
+    {
+        m_parents.clear();
+        m_inverseBindPose.clear();
+        m_levelOffsets.clear();
+        m_jointRadii.clear();
+    }
+}
+
+size_t RevAnimationClip::GetMemorySize() const
+{
+    return m_tracks.size() * sizeof(RevJointTrack)
+        + m_keyTimes.size() * sizeof(UINT16)
+        + m_rotations.size() * sizeof(RevPackedQuaternion)
+        + m_vectorBits.size() * sizeof(UINT32);
+}
+
+void RevAnimationClip::Serialize(RevArchive& archive)
+{
+    archive << m_name;
+    archive << m_duration;
+    archive << m_tracks;
+    archive << m_keyTimes;
+    archive << m_rotations;
+    archive << m_vectorBits;
+}
+
+void RevAnimationData::Serialize(RevArchive& archive)
+{
+    m_skeleton.Serialize(archive);
+    UINT numClips = static_cast<UINT>(m_clips.size());
+    archive << numClips;
+    if (archive.IsLoading())
+    {
+        // Every clip stores at least its name length, anything larger is a corrupt count.
+        m_clips.resize(archive.HasBytes(static_cast<size_t>(numClips) * sizeof(UINT)) ? numClips : 0);
+    }
+    for (RevAnimationClip& clip : m_clips)
+    {
+        clip.Serialize(archive);
+    }
+    archive << m_skinWeights;
+}
@@ -0,0 +1,124 @@
+﻿#pragma once
+#include <string>
+#include <vector>
+#include "RevCoreDefines.h"
+#include "RevLoadStatistics.h"
+
+/** Joints influencing one vertex, the weights sum to one. Unused slots have a weight of zero. */
+struct RevSkinWeights
+{
+    UINT16 m_joints[REV_MAX_JOINT_INFLUENCES] = {};
+    float m_weights[REV_MAX_JOINT_INFLUENCES] = {};
+};
+
+/** Translation or scale key as imported, m_time in seconds. */
+struct RevVectorKey
+{
+    float m_time = 0.0f;
+    DirectX::XMFLOAT3 m_value = { 0.0f, 0.0f, 0.0f };
+};
+
+/** Rotation key as imported, m_value is a unit quaternion stored x, y, z, w. */
+struct RevRotationKey
+{
+    float m_time = 0.0f;
+    DirectX::XMFLOAT4 m_value = { 0.0f, 0.0f, 0.0f, 1.0f };
+};
+
+/** Uncompressed keys of one joint, only used while importing. Every curve has at least one key. */
+struct RevRawJointTrack
+{
+    std::vector<RevVectorKey> m_translations;
+    std::vector<RevRotationKey> m_rotations;
+    std::vector<RevVectorKey> m_scales;
+};
+
+/** Clip as imported, RevAnimationCompression turns it into a RevAnimationClip. */
+struct RevRawAnimationClip
+{
+    std::wstring m_name;
+    float m_duration = 0.0f;
+    std::vector<RevRawJointTrack> m_tracks;
+};
+
+/** Unit quaternion stored as its three smallest components at 15 bits each plus the index of the dropped largest one. */
+struct RevPackedQuaternion
+{
+    UINT16 m_bits[3] = {};
+};
+
+/** Translation or scale keys. Component c of key k is m_bits[c] bits at m_bitOffset + k * GetKeyBits() of the clip
+ *  bit stream and decodes to m_min + value * m_step, a component with zero bits is constant. */
+struct RevVectorCurve
+{
+    UINT m_timeOffset = 0;
+    UINT m_keyCount = 0;
+    UINT m_bitOffset = 0;
+    UINT8 m_bits[3] = {};
+    DirectX::XMFLOAT3 m_min = { 0.0f, 0.0f, 0.0f };
+    DirectX::XMFLOAT3 m_step = { 0.0f, 0.0f, 0.0f };
+
+    UINT GetKeyBits() const { return m_bits[0] + m_bits[1] + m_bits[2]; }
+};
+
+/** Rotation keys, key k is m_rotations[m_valueOffset + k] of the clip. */
+struct RevRotationCurve
+{
+    UINT m_timeOffset = 0;
+    UINT m_keyCount = 0;
+    UINT m_valueOffset = 0;
+};
+
+/** Curves of one joint, every curve has at least one key and its times start at m_timeOffset of the clip key times. */
+struct RevJointTrack
+{
+    RevVectorCurve m_translation;
+    RevRotationCurve m_rotation;
+    RevVectorCurve m_scale;
+};
+
+/** Joint hierarchy of an animated model. Joints are ordered by depth so a parent always comes before its children,
+ *  level l of the hierarchy is [m_levelOffsets[l], m_levelOffsets[l + 1]) and only depends on earlier levels. */
+struct RevSkeleton
+{
+    // Parent joint, REV_INDEX_NONE for roots.
+    std::vector<INT> m_parents;
+    // Bind pose model space to joint space, identity for joints no vertex is bound to.
+    std::vector<DirectX::XMFLOAT4X4> m_inverseBindPose;
+    std::vector<UINT> m_levelOffsets;
+    // Bind pose radius around each joint of the vertexes it and its descendants move, never larger than the radius
+    // of its parent. Animation LOD projects it to decide whether a joint is worth sampling.
+    std::vector<float> m_jointRadii;
+
+    UINT GetNumJoints() const { return static_cast<UINT>(m_parents.size()); }
+    UINT GetNumLevels() const { return m_levelOffsets.size() > 0 ? static_cast<UINT>(m_levelOffsets.size()) - 1 : 0; }
+    void Serialize(class RevArchive& archive);
+};
+
+/** Compressed local joint transforms over time, one track per skeleton joint. Joints the source did not animate hold
+ *  their bind pose as a single key, so sampling never needs the skeleton. */
+struct RevAnimationClip
+{
+    std::wstring m_name;
+    float m_duration = 0.0f;
+    std::vector<RevJointTrack> m_tracks;
+    // Key times of every curve in 1/REV_ANIMATION_TIME_STEPS of the duration, increasing within a curve.
+    std::vector<UINT16> m_keyTimes;
+    std::vector<RevPackedQuaternion> m_rotations;
+    // Bit packed translation and scale keys, padded by a word so decoding may always read two.
+    std::vector<UINT32> m_vectorBits;
+
+    size_t GetMemorySize() const;
+    void Serialize(class RevArchive& archive);
+};
+
+/** Everything an animated model adds to its geometry, m_skinWeights has one entry per vertex. */
+struct RevAnimationData
+{
+    RevSkeleton m_skeleton;
+    std::vector<RevAnimationClip> m_clips;
+    RevGeometryVector<RevSkinWeights> m_skinWeights;
+
+    bool IsAnimated() const { return m_skeleton.GetNumJoints() > 0 && m_clips.size() > 0; }
+    void Serialize(class RevArchive& archive);
+};
@@ -0,0 +1,63 @@
+#include "stdafx.h"
+#include "RevArchive.h"
+#include <istream>
+#include <ostream>
+#include "RevLoadStatistics.h"
+
+RevArchive& RevArchive::operator<<(std::wstring& value)
+{
+    UINT length = static_cast<UINT>(value.size());
+    *this << length;
+    if (m_loading)
+    {
+        if (!HasBytes(static_cast<size_t>(length) * sizeof(wchar_t)))
+        {
+            m_valid = false;
+            length = 0;
+        }
+        value.resize(length);
+    }
+    if (length > 0)
+    {
+        SerializeBytes(&value[0], static_cast<size_t>(length) * sizeof(wchar_t));
+    }
+    return *this;
+}
+
+void RevArchive::SerializeBytes(void* data, size_t size)
+{
+    if (m_loading)
+    {
+        if (!m_valid || !HasBytes(size))
+        {
+            m_valid = false;
+            memset(data, 0, size);
+            return;
+        }
+        if (m_inStream)
+        {
+            if (!m_inStream->read(static_cast<char*>(data), size))
+            {
+                m_valid = false;
+                memset(data, 0, size);
+                return;
+            }
+        }
+        else
+        {
+            memcpy(data, m_byteArray.data() + m_offset, size);
+            RevLoadStatistics::RecordCopy(size);
+        }
+    }
+    else if (m_outStream)
+    {
+        m_outStream->write(static_cast<const char*>(data), size);
+    }
+    else
+    {
+        m_byteArray.resize(static_cast<size_t>(m_offset + size));
+        memcpy(m_byteArray.data() + m_offset, data, size);
+        RevLoadStatistics::RecordCopy(size);
+    }
+    m_offset += size;
+}
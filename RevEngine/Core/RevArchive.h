@@ -0,0 +1,83 @@
+﻿#pragma once
+#include <iosfwd>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+/** Byte buffer serialized through operator<< in both directions, so one Serialize(RevArchive&)
+ *  function describes the layout for saving and loading. Archives made on a stream read and write it directly,
+ *  vectors then load straight into their own storage without a byte buffer in between. */
+class RevArchive
+{
+public:
+    bool IsLoading() const { return m_loading; }
+    /** False once a loader read past the end of its bytes, everything read after that is zeroed. */
+    bool IsValid() const { return m_valid; }
+    UINT64 Tell() const { return m_offset; }
+    /** Whether a loader has at least size bytes left to read. */
+    bool HasBytes(size_t size) const { return m_offset + size <= m_size; }
+
+    template<typename T>
+    RevArchive& operator<<(T& value)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "Only plain data can be serialized as raw bytes");
+        SerializeBytes(&value, sizeof(T));
+        return *this;
+    }
+
+    template<typename T, typename Allocator>
+    RevArchive& operator<<(std::vector<T, Allocator>& values)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "Only plain data can be serialized as raw bytes");
+        // 64-bit, raw byte streams of big meshes pass 4 GB.
+        UINT64 count = values.size();
+        *this << count;
+        if (m_loading)
+        {
+            // Compared as a count, a corrupt one would overflow as a byte size.
+            if (count > (m_size - m_offset) / sizeof(T))
+            {
+                m_valid = false;
+                count = 0;
+            }
+            values.resize(static_cast<size_t>(count));
+        }
+        if (count > 0)
+        {
+            SerializeBytes(values.data(), static_cast<size_t>(count) * sizeof(T));
+        }
+        return *this;
+    }
+
+    RevArchive& operator<<(std::wstring& value);
+
+    std::vector<UINT8> m_byteArray;
+
+protected:
+    RevArchive(bool loading) : m_loading(loading) {}
+
+    void SerializeBytes(void* data, size_t size);
+
+    std::istream* m_inStream = nullptr;
+    std::ostream* m_outStream = nullptr;
+    UINT64 m_offset = 0;
+    // Bytes a loader can read.
+    UINT64 m_size = 0;
+    bool m_loading = false;
+    bool m_valid = true;
+};
+
+class RevArchiveSaver : public RevArchive
+{
+public:
+    RevArchiveSaver() : RevArchive(false) {}
+    RevArchiveSaver(std::ostream& stream) : RevArchive(false) { m_outStream = &stream; }
+};
+
+class RevArchiveLoader : public RevArchive
+{
+public:
+    RevArchiveLoader(UINT64 size) : RevArchive(true) { m_byteArray.resize(static_cast<size_t>(size)); m_size = size; }
+    /** Reads size bytes from the current position of stream. */
+    RevArchiveLoader(std::istream& stream, UINT64 size) : RevArchive(true) { m_inStream = &stream; m_size = size; }
+};
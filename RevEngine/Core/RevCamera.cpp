@@ -122,3 +122,37 @@ void RevCamera::Update(float deltaTime, const RevInputState& input)
     m_matrices[2] = XMMatrixInverse(&det2, m_matrices[0]);
     m_matrices[3] = XMMatrixInverse(&det2, m_matrices[1]);
 }
+
+float RevCamera::GetLodScale(UINT viewportHeight) const
+{
+    if (m_matrices.size() < 2)
+    {
+        return 0.0f;
+    }
+    // The y scale of the projection is 1 / tan(fov / 2), which maps to half the viewport.
+    return XMVectorGetY(m_matrices[1].r[1]) * static_cast<float>(viewportHeight) * 0.5f;
+}
+
+bool RevCamera::GetFrustumPlanes(XMFLOAT4 outPlanes[6]) const
+{
+    if (m_matrices.size() < 2)
+    {
+        return false;
+    }
+    // Rows of the transposed view projection are its columns, clip space z runs from 0 to w.
+    const XMMATRIX columns = XMMatrixTranspose(XMMatrixMultiply(m_matrices[0], m_matrices[1]));
+    const XMVECTOR planes[6] =
+    {
+        columns.r[3] + columns.r[0],
+        columns.r[3] - columns.r[0],
+        columns.r[3] + columns.r[1],
+        columns.r[3] - columns.r[1],
+        columns.r[2],
+        columns.r[3] - columns.r[2],
+    };
+    for (UINT index = 0; index < 6; index++)
+    {
+        XMStoreFloat4(&outPlanes[index], XMPlaneNormalize(planes[index]));
+    }
+    return true;
+}
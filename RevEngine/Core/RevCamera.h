@@ -25,6 +25,11 @@ public:
     void OnMoveDelta(float deltaX, float deltaY);
     void Initialize(float aspectRatio);
     void Update(float deltaTime, const RevInputState& input);
+
+    /** Pixels covered by one world unit at distance one, see RevDrawData::m_lodScale. */
+    float GetLodScale(UINT viewportHeight) const;
+    /** Normalized world space frustum planes, left, right, bottom, top, near and far, normals pointing inwards. */
+    bool GetFrustumPlanes(XMFLOAT4 outPlanes[6]) const;
 };
 
 
@@ -0,0 +1,461 @@
+#include "stdafx.h"
+#include "RevClusterDagBuilder.h"
+#include <algorithm>
+#include <cfloat>
+#include "RevCoreDefines.h"
+#include "RevMeshSimplifier.h"
+#include "RevMeshletBuilder.h"
+#include "../D3D/RevD3DTypes.h"
+
+namespace
+{
+    const float g_groupReduction = 0.5f;
+    // Groups keeping more than this fraction of their triangles stop the DAG, their clusters become roots.
+    const float g_groupMinimumGain = 0.85f;
+
+    struct RevBuildCluster
+    {
+        std::vector<UINT> m_indices;
+        XMFLOAT4 m_bounds = { 0.0f, 0.0f, 0.0f, 0.0f };
+        XMFLOAT4 m_parentBounds = { 0.0f, 0.0f, 0.0f, 0.0f };
+        float m_error = 0.0f;
+        float m_parentError = FLT_MAX;
+        UINT m_level = 0;
+        UINT m_subMesh = 0;
+        // Group the cluster was merged into, 0 for roots.
+        UINT m_group = 0;
+        UINT m_childGroup = UINT_MAX;
+        XMFLOAT3 m_coneApex = { 0.0f, 0.0f, 0.0f };
+        XMFLOAT3 m_coneAxis = { 0.0f, 0.0f, 1.0f };
+        float m_coneCutoff = 1.0f;
+    };
+
+    XMFLOAT4 ComputeSphere(const std::vector<XMFLOAT3>& positions, const std::vector<UINT>& indices)
+    {
+        XMVECTOR boundsMin = g_XMFltMax;
+        XMVECTOR boundsMax = -g_XMFltMax;
+        for (UINT index : indices)
+        {
+            boundsMin = XMVectorMin(boundsMin, XMLoadFloat3(&positions[index]));
+            boundsMax = XMVectorMax(boundsMax, XMLoadFloat3(&positions[index]));
+        }
+        XMVECTOR center = (boundsMin + boundsMax) * 0.5f;
+        XMVECTOR radiusSquared = XMVectorZero();
+        for (UINT index : indices)
+        {
+            radiusSquared = XMVectorMax(radiusSquared, XMVector3LengthSq(XMLoadFloat3(&positions[index]) - center));
+        }
+        XMFLOAT4 sphere;
+        XMStoreFloat4(&sphere, XMVectorSetW(center, XMVectorGetX(XMVectorSqrt(radiusSquared))));
+        return sphere;
+    }
+
+    /** Cone around the cluster's own triangles, parent bounds are too loose for backface tests. */
+    void ComputeClusterCone(const std::vector<XMFLOAT3>& positions, RevBuildCluster& cluster)
+    {
+        const XMFLOAT4 sphere = ComputeSphere(positions, cluster.m_indices);
+        RevMeshletBuilder::ComputeNormalCone(
+            positions, cluster.m_indices, XMLoadFloat4(&sphere), cluster.m_coneApex, cluster.m_coneAxis, cluster.m_coneCutoff);
+    }
+
+    XMFLOAT4 MergeSpheres(const XMFLOAT4& first, const XMFLOAT4& second)
+    {
+        XMVECTOR firstCenter = XMLoadFloat4(&first);
+        XMVECTOR offset = XMVectorSetW(XMLoadFloat4(&second) - firstCenter, 0.0f);
+        const float distance = XMVectorGetX(XMVector3Length(offset));
+        if (distance + second.w <= first.w)
+        {
+            return first;
+        }
+        if (distance + first.w <= second.w)
+        {
+            return second;
+        }
+        const float radius = (distance + first.w + second.w) * 0.5f;
+        XMFLOAT4 merged;
+        XMStoreFloat4(&merged, XMVectorSetW(firstCenter + offset * ((radius - first.w) / distance), radius));
+        return merged;
+    }
+
+    /** Splits a triangle list into clusters within the meshlet limits. Triangles are taken breadth first over
+     *  shared vertexes so every cluster stays a compact patch. */
+    void SplitIntoClusters(const std::vector<UINT>& indices, UINT vertexCount, std::vector<std::vector<UINT>>& outClusters)
+    {
+        const UINT triangleCount = static_cast<UINT>(indices.size() / 3);
+        std::vector<UINT> adjacencyOffsets(vertexCount + 1, 0);
+        for (UINT index : indices)
+        {
+            adjacencyOffsets[index + 1]++;
+        }
+        for (UINT vertex = 0; vertex < vertexCount; vertex++)
+        {
+            adjacencyOffsets[vertex + 1] += adjacencyOffsets[vertex];
+        }
+        std::vector<UINT> adjacency(indices.size());
+        std::vector<UINT> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+        for (UINT triangle = 0; triangle < triangleCount; triangle++)
+        {
+            for (UINT corner = 0; corner < 3; corner++)
+            {
+                adjacency[fill[indices[triangle * 3 + corner]]++] = triangle;
+            }
+        }
+
+        std::vector<UINT> order;
+        order.reserve(triangleCount);
+        std::vector<bool> visited(triangleCount, false);
+        for (UINT seed = 0; seed < triangleCount; seed++)
+        {
+            if (visited[seed])
+            {
+                continue;
+            }
+            visited[seed] = true;
+            order.push_back(seed);
+            for (size_t head = order.size() - 1; head < order.size(); head++)
+            {
+                for (UINT corner = 0; corner < 3; corner++)
+                {
+                    const UINT vertex = indices[order[head] * 3 + corner];
+                    for (UINT entry = adjacencyOffsets[vertex]; entry < adjacencyOffsets[vertex + 1]; entry++)
+                    {
+                        if (!visited[adjacency[entry]])
+                        {
+                            visited[adjacency[entry]] = true;
+                            order.push_back(adjacency[entry]);
+                        }
+                    }
+                }
+            }
+        }
+
+        // Stamp of the last cluster a vertex was added to, counts unique vertexes without clearing between clusters.
+        std::vector<UINT> stamp(vertexCount, UINT_MAX);
+        UINT clusterVertexes = 0;
+        outClusters.clear();
+        for (UINT triangle : order)
+        {
+            const UINT* corners = &indices[triangle * 3];
+            UINT clusterStamp = static_cast<UINT>(outClusters.size()) - 1;
+            UINT newVertexes = 0;
+            for (UINT corner = 0; corner < 3; corner++)
+            {
+                const bool repeated = (corner > 0 && corners[corner] == corners[0]) || (corner > 1 && corners[corner] == corners[1]);
+                if (!repeated && stamp[corners[corner]] != clusterStamp)
+                {
+                    newVertexes++;
+                }
+            }
+            if (outClusters.empty()
+                || clusterVertexes + newVertexes > REV_MESHLET_MAX_VERTEXES
+                || outClusters.back().size() / 3 == REV_MESHLET_MAX_TRIANGLES)
+            {
+                outClusters.push_back(std::vector<UINT>());
+                clusterStamp = static_cast<UINT>(outClusters.size()) - 1;
+                clusterVertexes = 0;
+            }
+            for (UINT corner = 0; corner < 3; corner++)
+            {
+                if (stamp[corners[corner]] != clusterStamp)
+                {
+                    stamp[corners[corner]] = clusterStamp;
+                    clusterVertexes++;
+                }
+                outClusters.back().push_back(corners[corner]);
+            }
+        }
+    }
+
+    /** Greedily groups clusters with the neighbours they share the most vertexes with. */
+    void GroupClusters(
+        const std::vector<RevBuildCluster>& clusters,
+        const std::vector<UINT>& levelClusters,
+        UINT vertexCount,
+        std::vector<std::vector<UINT>>& outGroups)
+    {
+        std::vector<std::vector<UINT>> vertexClusters(vertexCount);
+        for (UINT levelIndex = 0; levelIndex < levelClusters.size(); levelIndex++)
+        {
+            for (UINT index : clusters[levelClusters[levelIndex]].m_indices)
+            {
+                std::vector<UINT>& users = vertexClusters[index];
+                if (users.empty() || users.back() != levelIndex)
+                {
+                    users.push_back(levelIndex);
+                }
+            }
+        }
+
+        outGroups.clear();
+        std::vector<bool> grouped(levelClusters.size(), false);
+        std::vector<UINT> sharedVertexes(levelClusters.size(), 0);
+        std::vector<UINT> candidates;
+        for (UINT seed = 0; seed < levelClusters.size(); seed++)
+        {
+            if (grouped[seed])
+            {
+                continue;
+            }
+            std::vector<UINT> group;
+            UINT member = seed;
+            while (true)
+            {
+                grouped[member] = true;
+                group.push_back(member);
+                if (group.size() == REV_CLUSTER_GROUP_SIZE)
+                {
+                    break;
+                }
+                for (UINT index : clusters[levelClusters[member]].m_indices)
+                {
+                    for (UINT neighbour : vertexClusters[index])
+                    {
+                        if (!grouped[neighbour])
+                        {
+                            if (sharedVertexes[neighbour]++ == 0)
+                            {
+                                candidates.push_back(neighbour);
+                            }
+                        }
+                    }
+                }
+                UINT best = UINT_MAX;
+                for (UINT candidate : candidates)
+                {
+                    if (!grouped[candidate] && (best == UINT_MAX || sharedVertexes[candidate] > sharedVertexes[best]))
+                    {
+                        best = candidate;
+                    }
+                }
+                if (best == UINT_MAX)
+                {
+                    break;
+                }
+                member = best;
+            }
+            for (UINT candidate : candidates)
+            {
+                sharedVertexes[candidate] = 0;
+            }
+            candidates.clear();
+
+            for (UINT& entry : group)
+            {
+                entry = levelClusters[entry];
+            }
+            outGroups.push_back(group);
+        }
+    }
+
+    struct RevCutSelection
+    {
+        const std::vector<RevCluster>& m_clusters;
+        const std::vector<RevClusterGroup>& m_groups;
+        XMVECTOR m_viewPosition;
+        float m_lodScale;
+        float m_pixelError;
+        std::vector<UINT>& m_outClusters;
+    };
+
+    /** Appends the clusters of group whose error is small enough and descends into the groups of the others.
+     *  The group was only entered because its own error is too large, which is the parent error of its clusters. */
+    void SelectGroupCut(RevCutSelection& selection, UINT groupIndex)
+    {
+        const RevClusterGroup& group = selection.m_groups[groupIndex];
+        for (UINT index = group.m_clusterOffset; index < group.m_clusterOffset + group.m_clusterCount; index++)
+        {
+            const RevCluster& cluster = selection.m_clusters[index];
+            const float distance =
+                XMVectorGetX(XMVector3Length(XMLoadFloat4(&cluster.m_bounds) - selection.m_viewPosition)) - cluster.m_bounds.w;
+            if (RevMeshSimplifier::ProjectError(cluster.m_error, distance, selection.m_lodScale) > selection.m_pixelError)
+            {
+                // Every cluster split from a group shares its bounds and error, the first one descends for all.
+                if (cluster.m_childGroup != UINT_MAX)
+                {
+                    SelectGroupCut(selection, cluster.m_childGroup);
+                }
+                continue;
+            }
+            if (!RevMeshletBuilder::IsConeBackFacing(
+                cluster.m_coneApex, cluster.m_coneAxis, cluster.m_coneCutoff, selection.m_viewPosition))
+            {
+                selection.m_outClusters.push_back(index);
+            }
+        }
+    }
+}
+
+void RevClusterDagBuilder::BuildClusterDag(RevModelData& modelData)
+{
+    modelData.m_clusters.clear();
+    modelData.m_clusterPages.clear();
+    if (!modelData.m_vertexStream.Holds<RevVertexPosTexNormBiTan>() || modelData.m_indices.empty())
+    {
+        return;
+    }
+
+    std::vector<RevBuildCluster> clusters;
+    std::vector<XMFLOAT3> positions;
+    std::vector<bool> locked;
+    std::vector<UINT> indices;
+    std::vector<std::vector<UINT>> split;
+    std::vector<std::vector<UINT>> groups;
+    // Group 0 is the root group.
+    UINT groupCounter = 1;
+    for (UINT subMeshIndex = 0; subMeshIndex < modelData.m_subMeshes.size(); subMeshIndex++)
+    {
+        const RevSubMesh& subMesh = modelData.m_subMeshes[subMeshIndex];
+        RevMeshSimplifier::WeldSubMesh(modelData, subMesh, positions, locked, indices);
+        if (indices.empty())
+        {
+            continue;
+        }
+
+        std::vector<UINT> levelClusters;
+        SplitIntoClusters(indices, subMesh.m_vertexCount, split);
+        for (std::vector<UINT>& clusterIndices : split)
+        {
+            RevBuildCluster cluster;
+            cluster.m_bounds = ComputeSphere(positions, clusterIndices);
+            cluster.m_subMesh = subMeshIndex;
+            cluster.m_indices.swap(clusterIndices);
+            ComputeClusterCone(positions, cluster);
+            levelClusters.push_back(static_cast<UINT>(clusters.size()));
+            clusters.push_back(std::move(cluster));
+        }
+
+        for (UINT level = 1; levelClusters.size() > 1; level++)
+        {
+            GroupClusters(clusters, levelClusters, subMesh.m_vertexCount, groups);
+            std::vector<UINT> nextLevelClusters;
+            for (const std::vector<UINT>& group : groups)
+            {
+                std::vector<UINT> merged;
+                XMFLOAT4 groupBounds = clusters[group[0]].m_bounds;
+                float childError = 0.0f;
+                for (UINT child : group)
+                {
+                    merged.insert(merged.end(), clusters[child].m_indices.begin(), clusters[child].m_indices.end());
+                    groupBounds = MergeSpheres(groupBounds, clusters[child].m_bounds);
+                    childError = max(childError, clusters[child].m_error);
+                }
+
+                // The group outline is an open border of the merged triangles, so the simplifier keeps it in place
+                // and the group still matches its neighbours at every level.
+                const size_t mergedCount = merged.size();
+                const size_t target = static_cast<size_t>(mergedCount / 3 * g_groupReduction) * 3;
+                const float error = RevMeshSimplifier::SimplifyTriangles(positions, locked, merged, target, FLT_MAX);
+                if (merged.empty() || merged.size() > mergedCount * g_groupMinimumGain)
+                {
+                    continue;
+                }
+
+                const float groupError = childError + error;
+                const UINT groupIndex = groupCounter++;
+                for (UINT child : group)
+                {
+                    clusters[child].m_parentBounds = groupBounds;
+                    clusters[child].m_parentError = groupError;
+                    clusters[child].m_group = groupIndex;
+                }
+
+                SplitIntoClusters(merged, subMesh.m_vertexCount, split);
+                for (std::vector<UINT>& clusterIndices : split)
+                {
+                    RevBuildCluster cluster;
+                    cluster.m_bounds = groupBounds;
+                    cluster.m_error = groupError;
+                    cluster.m_level = level;
+                    cluster.m_subMesh = subMeshIndex;
+                    cluster.m_childGroup = &clusterIndices == &split.front() ? groupIndex : UINT_MAX;
+                    cluster.m_indices.swap(clusterIndices);
+                    ComputeClusterCone(positions, cluster);
+                    nextLevelClusters.push_back(static_cast<UINT>(clusters.size()));
+                    clusters.push_back(std::move(cluster));
+                }
+            }
+            levelClusters.swap(nextLevelClusters);
+        }
+    }
+
+    // Roots first, then coarse levels first and siblings next to each other, so pages stream in from the top of
+    // the DAG and every group is a contiguous range.
+    std::vector<UINT> order(clusters.size());
+    for (UINT index = 0; index < order.size(); index++)
+    {
+        order[index] = index;
+    }
+    std::stable_sort(order.begin(), order.end(), [&clusters](UINT left, UINT right)
+    {
+        if ((clusters[left].m_group == 0) != (clusters[right].m_group == 0))
+        {
+            return clusters[left].m_group == 0;
+        }
+        if (clusters[left].m_level != clusters[right].m_level)
+        {
+            return clusters[left].m_level > clusters[right].m_level;
+        }
+        if (clusters[left].m_subMesh != clusters[right].m_subMesh)
+        {
+            return clusters[left].m_subMesh < clusters[right].m_subMesh;
+        }
+        return clusters[left].m_group < clusters[right].m_group;
+    });
+
+    modelData.m_clusters.reserve(clusters.size());
+    modelData.m_clusterGroups.resize(groupCounter);
+    for (UINT index : order)
+    {
+        const RevBuildCluster& source = clusters[index];
+        RevClusterGroup& group = modelData.m_clusterGroups[source.m_group];
+        if (group.m_clusterCount == 0)
+        {
+            group.m_clusterOffset = static_cast<UINT>(modelData.m_clusters.size());
+        }
+        group.m_clusterCount++;
+        if (modelData.m_clusterPages.empty()
+            || modelData.m_clusterPages.back().m_indexCount + source.m_indices.size() > REV_CLUSTER_PAGE_INDICES)
+        {
+            RevClusterPage page = {};
+            page.m_clusterOffset = static_cast<UINT>(modelData.m_clusters.size());
+            page.m_indexOffset = static_cast<UINT>(modelData.m_indices.size());
+            modelData.m_clusterPages.push_back(page);
+        }
+        RevClusterPage& page = modelData.m_clusterPages.back();
+
+        RevCluster cluster = {};
+        cluster.m_indexOffset = static_cast<UINT>(modelData.m_indices.size());
+        cluster.m_indexCount = static_cast<UINT>(source.m_indices.size());
+        cluster.m_subMesh = source.m_subMesh;
+        cluster.m_level = source.m_level;
+        cluster.m_bounds = source.m_bounds;
+        cluster.m_parentBounds = source.m_parentBounds;
+        cluster.m_error = source.m_error;
+        cluster.m_parentError = source.m_parentError;
+        cluster.m_coneApex = source.m_coneApex;
+        cluster.m_coneAxis = source.m_coneAxis;
+        cluster.m_coneCutoff = source.m_coneCutoff;
+        cluster.m_childGroup = source.m_childGroup;
+        modelData.m_clusters.push_back(cluster);
+        modelData.m_indices.insert(modelData.m_indices.end(), source.m_indices.begin(), source.m_indices.end());
+
+        page.m_clusterCount++;
+        page.m_indexCount += cluster.m_indexCount;
+    }
+}
+
+void RevClusterDagBuilder::SelectCut(
+    const std::vector<RevCluster>& clusters,
+    const std::vector<RevClusterGroup>& groups,
+    FXMVECTOR viewPosition,
+    float lodScale,
+    float pixelError,
+    std::vector<UINT>& outClusters)
+{
+    if (groups.empty())
+    {
+        return;
+    }
+    RevCutSelection selection = { clusters, groups, viewPosition, lodScale, pixelError, outClusters };
+    SelectGroupCut(selection, 0);
+}
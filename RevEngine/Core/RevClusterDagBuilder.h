@@ -0,0 +1,29 @@
+﻿#pragma once
+#include <vector>
+
+struct RevModelData;
+struct RevCluster;
+struct RevClusterGroup;
+
+class RevClusterDagBuilder
+{
+public:
+
+    /** Builds the cluster LOD DAG of every submesh: clusters are grouped with their neighbours, every group is
+     *  simplified to half its triangles with the group outline locked and split into new clusters, level by level
+     *  until one cluster is left or nothing simplifies anymore. Cluster indices are appended to m_indices in page
+     *  order. Run at cook time, before the indices are compacted, for models asking for it, see
+     *  RevModelInitializationData::m_clusterDag. */
+    static void BuildClusterDag(RevModelData& modelData);
+
+    /** Appends the clusters drawn for a viewer at viewPosition (model space), lodScale as in RevDrawData::m_lodScale.
+     *  Walks down from the root group and only visits the groups above the cut. Clusters whose normal cone faces
+     *  away from the viewer are skipped. */
+    static void SelectCut(
+        const std::vector<RevCluster>& clusters,
+        const std::vector<RevClusterGroup>& groups,
+        DirectX::FXMVECTOR viewPosition,
+        float lodScale,
+        float pixelError,
+        std::vector<UINT>& outClusters);
+};
@@ -6,4 +6,49 @@
 
 #define REV_D3D_DRIVER_TYPE D3D_DRIVER_TYPE_HARDWARE
 #define REV_BACK_BUFFER_FORMAT DXGI_FORMAT_R8G8B8A8_UNORM
-#define REV_DEPTH_STENCIL_FORMAT DXGI_FORMAT_D32_FLOAT
\ No newline at end of file
+#define REV_DEPTH_STENCIL_FORMAT DXGI_FORMAT_D32_FLOAT
+
+#define REV_MESHLET_MAX_VERTEXES 64
+#define REV_MESHLET_MAX_TRIANGLES 124
+// Levels in a model LOD chain, including the full detail level.
+#define REV_MAX_LODS 5
+// Clusters simplified together per cluster DAG node and the index budget of a streaming page.
+#define REV_CLUSTER_GROUP_SIZE 4
+#define REV_CLUSTER_PAGE_INDICES 32768
+
+// Upload memory used to copy geometry into default heap buffers, whatever the mesh size.
+#define REV_STAGING_WINDOW_SIZE (64ull * 1024 * 1024)
+// Size of the ID3D12Heap blocks buffers are placed in, see RevGpuHeapAllocator.
+#define REV_GPU_HEAP_BLOCK_SIZE (64ull * 1024 * 1024)
+// Size of the shared buffers RevGpuHeapAllocator places constant buffers and other small buffers in.
+#define REV_GPU_SMALL_BUFFER_PAGE_SIZE (4ull * 1024 * 1024)
+// Size of the shared buffers RevGeometryPool sub-allocates model vertexes and indices from, one set per stride.
+#define REV_GEOMETRY_POOL_PAGE_SIZE (256ull * 1024 * 1024)
+// Descriptors of the shader visible heap, persistent ones for the lifetime of their owner and transient ones per frame in flight.
+#define REV_DESCRIPTOR_HEAP_PERSISTENT_COUNT 16384
+#define REV_DESCRIPTOR_HEAP_TRANSIENT_COUNT 4096
+// Triangles per bottom level AS, larger meshes are split over several to keep the build scratch memory bounded.
+#define REV_BLAS_MAX_TRIANGLES (1u << 20)
+
+// Joints skinning a single vertex.
+#define REV_MAX_JOINT_INFLUENCES 4
+// Scratch memory per frame in flight for containers that only live for the frame, see RevFrameArena.
+#define REV_FRAME_ARENA_SIZE (4ull * 1024 * 1024)
+// Upload memory per frame in flight for CPU skinned vertexes, instances past it draw in their bind pose.
+#define REV_SKINNING_RING_SIZE (32ull * 1024 * 1024)
+// Largest error animation compression may add to a curve, in model units for translation and scale and radians for rotation.
+#define REV_ANIMATION_TRANSLATION_TOLERANCE 0.0005f
+#define REV_ANIMATION_ROTATION_TOLERANCE 0.0005f
+#define REV_ANIMATION_SCALE_TOLERANCE 0.0001f
+// Resolution of compressed key times over the clip duration.
+#define REV_ANIMATION_TIME_STEPS 65535
+// CPU time per frame, summed over the workers, the animation scheduler spends on pose evaluation.
+#define REV_ANIMATION_BUDGET_US 2000.0f
+// Joints whose subtree projects smaller than this many pixels keep their last sampled local transform.
+#define REV_ANIMATION_MIN_JOINT_PIXELS 2.0f
+
+// CSV file RevMemoryTracker appends its snapshots to, once loaded and once at shutdown.
+#define REV_MEMORY_SNAPSHOT_PATH L"MemorySnapshot.csv"
+
+// Bump whenever RevModelData::Serialize changes so stale cooked models are rebuilt.
+#define REV_COOKED_MODEL_VERSION 15
\ No newline at end of file
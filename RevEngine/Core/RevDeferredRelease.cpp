@@ -0,0 +1,131 @@
+#include "stdafx.h"
+#include "RevDeferredRelease.h"
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include "RevEngineRetrievalFunctions.h"
+#include "../DXSampleHelper.h"
+
+namespace
+{
+    struct RevPendingRelease
+    {
+        UINT64 m_fenceValue = 0;
+        ComPtr<IUnknown> m_object;
+        std::function<void()> m_free;
+    };
+
+    std::mutex g_mutex;
+    // Ordered by fence value, releases only ever get the value of the next signal.
+    std::deque<RevPendingRelease> g_pending;
+    ComPtr<ID3D12Fence> g_fence;
+    UINT64 g_nextFenceValue = 1;
+    bool g_shutdown = false;
+
+    void Push(RevPendingRelease&& release)
+    {
+        {
+            std::lock_guard<std::mutex> lock(g_mutex);
+            if (!g_shutdown)
+            {
+                release.m_fenceValue = g_nextFenceValue;
+                g_pending.push_back(std::move(release));
+                return;
+            }
+        }
+        if (release.m_free)
+        {
+            release.m_free();
+        }
+    }
+
+    /** Frees everything the fence passed. Frees run outside the lock, they may release more. */
+    void Collect(UINT64 completedValue)
+    {
+        std::deque<RevPendingRelease> finished;
+        {
+            std::lock_guard<std::mutex> lock(g_mutex);
+            while (!g_pending.empty() && g_pending.front().m_fenceValue <= completedValue)
+            {
+                finished.push_back(std::move(g_pending.front()));
+                g_pending.pop_front();
+            }
+        }
+        for (RevPendingRelease& release : finished)
+        {
+            if (release.m_free)
+            {
+                release.m_free();
+            }
+        }
+    }
+
+    UINT64 Signal()
+    {
+        if (!g_fence)
+        {
+            ThrowIfFailed(RevEngineRetrievalFunctions::GetDevice()->CreateFence(
+                0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&g_fence)));
+        }
+        UINT64 fenceValue;
+        {
+            std::lock_guard<std::mutex> lock(g_mutex);
+            fenceValue = g_nextFenceValue++;
+        }
+        ThrowIfFailed(RevEngineRetrievalFunctions::GetCommandQueue()->Signal(g_fence.Get(), fenceValue));
+        return fenceValue;
+    }
+}
+
+void RevDeferredRelease::Release(ComPtr<IUnknown> object)
+{
+    if (!object)
+    {
+        return;
+    }
+    RevPendingRelease release;
+    release.m_object = std::move(object);
+    Push(std::move(release));
+}
+
+void RevDeferredRelease::Defer(std::function<void()> free)
+{
+    RevPendingRelease release;
+    release.m_free = std::move(free);
+    Push(std::move(release));
+}
+
+void RevDeferredRelease::Update()
+{
+    Signal();
+    Collect(g_fence->GetCompletedValue());
+}
+
+void RevDeferredRelease::Shutdown()
+{
+    const UINT64 fenceValue = Signal();
+    if (g_fence->GetCompletedValue() < fenceValue)
+    {
+        HANDLE fenceEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+        if (fenceEvent == nullptr)
+        {
+            ThrowIfFailed(HRESULT_FROM_WIN32(GetLastError()));
+        }
+        ThrowIfFailed(g_fence->SetEventOnCompletion(fenceValue, fenceEvent));
+        WaitForSingleObject(fenceEvent, INFINITE);
+        CloseHandle(fenceEvent);
+    }
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        g_shutdown = true;
+    }
+    // The queue is idle, whatever got in after the signal is safe to free as well.
+    Collect(UINT64_MAX);
+    g_fence.Reset();
+}
+
+size_t RevDeferredRelease::GetPendingCount()
+{
+    std::lock_guard<std::mutex> lock(g_mutex);
+    return g_pending.size();
+}
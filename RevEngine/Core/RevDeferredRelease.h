@@ -0,0 +1,22 @@
+#pragma once
+#include <functional>
+
+/** Holds on to GPU objects and sub-allocations the CPU is done with until the GPU is too. Everything released is
+ *  tagged with the fence value Update signals next on the engine queue, so it outlives every command list submitted
+ *  before that signal, and is freed by the first Update that finds the fence passed. Safe from any thread. */
+class RevDeferredRelease
+{
+public:
+    /** Drops the reference to object once the GPU passed the work submitted so far. */
+    static void Release(Microsoft::WRL::ComPtr<IUnknown> object);
+    /** Runs free, typically handing a range back to its allocator, once the GPU passed the work submitted so far. */
+    static void Defer(std::function<void()> free);
+
+    /** Signals the engine queue and frees what the GPU already passed. Called once per frame after submitting it. */
+    static void Update();
+    /** Waits for the GPU and frees everything, releases after it are freed right away. */
+    static void Shutdown();
+
+    /** Objects and callbacks still waiting on the GPU. */
+    static size_t GetPendingCount();
+};
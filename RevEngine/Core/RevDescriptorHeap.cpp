@@ -0,0 +1,162 @@
+#include "stdafx.h"
+#include "RevDescriptorHeap.h"
+#include <stdexcept>
+#include <vector>
+#include "RevDeferredRelease.h"
+#include "RevEngineRetrievalFunctions.h"
+#include "../DXSampleHelper.h"
+
+namespace
+{
+    ComPtr<ID3D12DescriptorHeap> g_heap;
+    D3D12_CPU_DESCRIPTOR_HANDLE g_cpuStart = {};
+    D3D12_GPU_DESCRIPTOR_HANDLE g_gpuStart = {};
+    UINT g_descriptorSize = 0;
+
+    // Free persistent ranges sorted by m_first, neighbours are merged on free.
+    std::vector<RevDescriptorRange> g_freeRanges;
+    UINT g_persistentCount = 0;
+
+    UINT g_transientCountPerFrame = 0;
+    UINT g_frameCount = 0;
+    UINT g_frameBegin = 0;
+    UINT g_transientOffset = 0;
+
+    void FreePersistent(const RevDescriptorRange& range)
+    {
+        auto next = g_freeRanges.begin();
+        while (next != g_freeRanges.end() && next->m_first < range.m_first)
+        {
+            ++next;
+        }
+        next = g_freeRanges.insert(next, range);
+        if (next + 1 != g_freeRanges.end() && next->m_first + next->m_count == (next + 1)->m_first)
+        {
+            next->m_count += (next + 1)->m_count;
+            g_freeRanges.erase(next + 1);
+        }
+        if (next != g_freeRanges.begin() && (next - 1)->m_first + (next - 1)->m_count == next->m_first)
+        {
+            (next - 1)->m_count += next->m_count;
+            g_freeRanges.erase(next);
+        }
+    }
+}
+
+D3D12_CPU_DESCRIPTOR_HANDLE RevDescriptorRange::GetCpuHandle(UINT index) const
+{
+    assert(index < m_count);
+    D3D12_CPU_DESCRIPTOR_HANDLE handle = g_cpuStart;
+    handle.ptr += static_cast<SIZE_T>(m_first + index) * g_descriptorSize;
+    return handle;
+}
+
+D3D12_GPU_DESCRIPTOR_HANDLE RevDescriptorRange::GetGpuHandle(UINT index) const
+{
+    assert(index < m_count);
+    D3D12_GPU_DESCRIPTOR_HANDLE handle = g_gpuStart;
+    handle.ptr += static_cast<UINT64>(m_first + index) * g_descriptorSize;
+    return handle;
+}
+
+void RevDescriptorHeap::Initialize(UINT persistentCount, UINT transientCountPerFrame, UINT frameCount)
+{
+    assert(!g_heap && persistentCount > 0 && frameCount > 0);
+    ID3D12Device5* device = RevEngineRetrievalFunctions::GetDevice();
+    D3D12_DESCRIPTOR_HEAP_DESC desc = {};
+    desc.NumDescriptors = persistentCount + transientCountPerFrame * frameCount;
+    desc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
+    desc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
+    ThrowIfFailed(device->CreateDescriptorHeap(&desc, IID_PPV_ARGS(&g_heap)));
+    g_cpuStart = g_heap->GetCPUDescriptorHandleForHeapStart();
+    g_gpuStart = g_heap->GetGPUDescriptorHandleForHeapStart();
+    g_descriptorSize = device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+
+    RevDescriptorRange all;
+    all.m_first = 0;
+    all.m_count = persistentCount;
+    g_freeRanges.assign(1, all);
+    g_persistentCount = persistentCount;
+    g_transientCountPerFrame = transientCountPerFrame;
+    g_frameCount = frameCount;
+    g_frameBegin = persistentCount;
+    g_transientOffset = 0;
+}
+
+void RevDescriptorHeap::BeginFrame(UINT frameIndex)
+{
+    assert(frameIndex < g_frameCount);
+    g_frameBegin = g_persistentCount + frameIndex * g_transientCountPerFrame;
+    g_transientOffset = 0;
+}
+
+void RevDescriptorHeap::Shutdown()
+{
+    g_heap.Reset();
+    g_freeRanges.clear();
+}
+
+std::shared_ptr<const RevDescriptorRange> RevDescriptorHeap::AllocatePersistent(UINT count)
+{
+    assert(g_heap && count > 0);
+    for (auto free = g_freeRanges.begin(); free != g_freeRanges.end(); ++free)
+    {
+        if (free->m_count < count)
+        {
+            continue;
+        }
+        RevDescriptorRange* range = new RevDescriptorRange();
+        range->m_first = free->m_first;
+        range->m_count = count;
+        free->m_first += count;
+        free->m_count -= count;
+        if (free->m_count == 0)
+        {
+            g_freeRanges.erase(free);
+        }
+        return std::shared_ptr<const RevDescriptorRange>(range, [](const RevDescriptorRange* released)
+        {
+            // Command lists in flight may still read the descriptors.
+            const RevDescriptorRange freed = *released;
+            RevDeferredRelease::Defer([freed]()
+            {
+                // Ranges released after Shutdown have no heap left to go back to.
+                if (g_heap)
+                {
+                    FreePersistent(freed);
+                }
+            });
+            delete released;
+        });
+    }
+    throw std::runtime_error("Out of persistent descriptors, raise REV_DESCRIPTOR_HEAP_PERSISTENT_COUNT");
+}
+
+RevDescriptorRange RevDescriptorHeap::AllocateTransient(UINT count)
+{
+    if (g_transientOffset + count > g_transientCountPerFrame)
+    {
+        throw std::runtime_error("Out of transient descriptors, raise REV_DESCRIPTOR_HEAP_TRANSIENT_COUNT");
+    }
+    RevDescriptorRange range;
+    range.m_first = g_frameBegin + g_transientOffset;
+    range.m_count = count;
+    g_transientOffset += count;
+    return range;
+}
+
+void RevDescriptorHeap::Bind(ID3D12GraphicsCommandList* commandList)
+{
+    ID3D12DescriptorHeap* heaps[] = { g_heap.Get() };
+    commandList->SetDescriptorHeaps(_countof(heaps), heaps);
+}
+
+ID3D12DescriptorHeap* RevDescriptorHeap::GetHeap()
+{
+    return g_heap.Get();
+}
+
+UINT RevDescriptorHeap::GetDescriptorSize()
+{
+    return g_descriptorSize;
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <memory>
+
+/** Consecutive descriptors of the RevDescriptorHeap, a single descriptor table can point at them. */
+struct RevDescriptorRange
+{
+    UINT m_first = 0;
+    UINT m_count = 0;
+
+    D3D12_CPU_DESCRIPTOR_HANDLE GetCpuHandle(UINT index = 0) const;
+    D3D12_GPU_DESCRIPTOR_HANDLE GetGpuHandle(UINT index = 0) const;
+};
+
+/** The one shader-visible CBV/SRV/UAV heap, bound once per command list so draws and dispatches never switch heaps.
+ *  The front holds persistent descriptors handed out by a first fit free list, the back is a ring of one region
+ *  per frame in flight for descriptors written every frame. A region is reused frameCount frames later. */
+class RevDescriptorHeap
+{
+public:
+    static void Initialize(UINT persistentCount, UINT transientCountPerFrame, UINT frameCount);
+    /** Starts handing out transient descriptors of frameIndex, the ones written there before are overwritten. */
+    static void BeginFrame(UINT frameIndex);
+    static void Shutdown();
+
+    /** count persistent descriptors, they go back to the heap once the last reference to the range is released
+     *  and the GPU passed the work submitted until then. */
+    static std::shared_ptr<const RevDescriptorRange> AllocatePersistent(UINT count);
+    /** count descriptors valid until the frame region is reused. */
+    static RevDescriptorRange AllocateTransient(UINT count);
+
+    static void Bind(ID3D12GraphicsCommandList* commandList);
+    static ID3D12DescriptorHeap* GetHeap();
+    static UINT GetDescriptorSize();
+};
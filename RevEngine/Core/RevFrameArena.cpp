@@ -0,0 +1,148 @@
+#include "stdafx.h"
+#include "RevFrameArena.h"
+#include "RevMemoryTracker.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+
+namespace
+{
+    // Largest alignment handed out, the region start is aligned to it.
+    const size_t g_maxAlignment = 64;
+    const UINT g_maxFrameCount = 4;
+    // Heap fallback of a full region, kept in a list per region until the region is used again.
+    struct RevHeapBlock
+    {
+        RevHeapBlock* m_next;
+        size_t m_size;
+    };
+    // Keeps the memory after the header aligned for any type.
+    const size_t g_heapHeaderSize = alignof(std::max_align_t) > sizeof(RevHeapBlock) ? alignof(std::max_align_t) : sizeof(RevHeapBlock);
+
+    UINT8* g_memory = nullptr;
+    UINT64 g_frameSize = 0;
+    UINT g_frameCount = 0;
+    UINT g_frameIndex = 0;
+    std::atomic<UINT64> g_offset{ 0 };
+    std::atomic<RevHeapBlock*> g_heapBlocks[g_maxFrameCount] = {};
+
+    std::atomic<UINT64> g_allocations{ 0 };
+    std::atomic<UINT64> g_allocatedBytes{ 0 };
+    std::atomic<UINT64> g_overflowAllocations{ 0 };
+    std::atomic<UINT64> g_overflowBytes{ 0 };
+    RevFrameArena::Statistics g_lastFrame;
+
+    void* AllocateFromHeap(size_t size)
+    {
+        RevHeapBlock* block = static_cast<RevHeapBlock*>(malloc(g_heapHeaderSize + size));
+        if (!block)
+        {
+            return nullptr;
+        }
+        block->m_size = size;
+        RevMemoryTracker::RecordAllocation(RevEMemoryTag::Frame, size);
+        block->m_next = g_heapBlocks[g_frameIndex].load();
+        while (!g_heapBlocks[g_frameIndex].compare_exchange_weak(block->m_next, block))
+        {
+        }
+        g_overflowAllocations++;
+        g_overflowBytes += size;
+        return reinterpret_cast<UINT8*>(block) + g_heapHeaderSize;
+    }
+
+    void FreeHeapBlocks(UINT frameIndex)
+    {
+        RevHeapBlock* block = g_heapBlocks[frameIndex].exchange(nullptr);
+        while (block)
+        {
+            RevHeapBlock* next = block->m_next;
+            RevMemoryTracker::RecordFree(RevEMemoryTag::Frame, block->m_size);
+            free(block);
+            block = next;
+        }
+    }
+}
+
+void RevFrameArena::Initialize(UINT64 frameSize, UINT frameCount)
+{
+    assert(!g_memory && frameCount > 0 && frameCount <= g_maxFrameCount);
+    g_memory = static_cast<UINT8*>(_aligned_malloc(static_cast<size_t>(frameSize * frameCount), g_maxAlignment));
+    g_frameSize = g_memory ? frameSize : 0;
+    RevMemoryTracker::RecordAllocation(RevEMemoryTag::Frame, static_cast<size_t>(g_frameSize * frameCount));
+    g_frameCount = frameCount;
+    g_frameIndex = 0;
+    g_offset = 0;
+}
+
+void RevFrameArena::BeginFrame(UINT frameIndex)
+{
+    assert(frameIndex < g_frameCount);
+    g_lastFrame = GetStatistics();
+    g_allocations = 0;
+    g_allocatedBytes = 0;
+    g_overflowAllocations = 0;
+    g_overflowBytes = 0;
+
+    g_frameIndex = frameIndex;
+    g_offset = 0;
+    FreeHeapBlocks(frameIndex);
+}
+
+void* RevFrameArena::Allocate(size_t size, size_t alignment)
+{
+    assert(alignment > 0 && (alignment & (alignment - 1)) == 0 && alignment <= g_maxAlignment);
+    g_allocations++;
+    g_allocatedBytes += size;
+
+    UINT64 offset = g_offset.load();
+    UINT64 begin;
+    do
+    {
+        begin = (offset + alignment - 1) & ~static_cast<UINT64>(alignment - 1);
+        if (begin + size > g_frameSize)
+        {
+            return AllocateFromHeap(size);
+        }
+    }
+    while (!g_offset.compare_exchange_weak(offset, begin + size));
+    return g_memory + g_frameIndex * g_frameSize + begin;
+}
+
+void RevFrameArena::Shutdown()
+{
+    for (UINT frameIndex = 0; frameIndex < g_frameCount; frameIndex++)
+    {
+        FreeHeapBlocks(frameIndex);
+    }
+    RevMemoryTracker::RecordFree(RevEMemoryTag::Frame, static_cast<size_t>(g_frameSize * g_frameCount));
+    _aligned_free(g_memory);
+    g_memory = nullptr;
+    g_frameSize = 0;
+    g_frameCount = 0;
+}
+
+RevFrameArena::Statistics RevFrameArena::GetStatistics()
+{
+    Statistics statistics;
+    statistics.m_allocations = g_allocations;
+    statistics.m_allocatedBytes = g_allocatedBytes;
+    statistics.m_overflowAllocations = g_overflowAllocations;
+    statistics.m_overflowBytes = g_overflowBytes;
+    return statistics;
+}
+
+RevFrameArena::Statistics RevFrameArena::GetLastFrameStatistics()
+{
+    return g_lastFrame;
+}
+
+UINT64 RevFrameArena::GetMarker()
+{
+    return g_offset;
+}
+
+void RevFrameArena::Rewind(UINT64 marker)
+{
+    assert(marker <= g_offset);
+    g_offset = marker;
+}
@@ -0,0 +1,76 @@
+﻿#pragma once
+#include <vector>
+
+/** Linear allocator for scratch memory that lives until the end of the frame, one region per frame in flight.
+ *  BeginFrame rewinds the region of the new frame, memory is never freed on its own. Allocate is safe from jobs,
+ *  scopes and BeginFrame only from the main thread while no job allocates. Requests past the region fall back to
+ *  the heap and are counted as overflows. The counters only see arena requests, heap allocations made around the
+ *  arena are not tracked here. */
+class RevFrameArena
+{
+public:
+    /** Arena requests of a frame, the overflow counters are the part the region had no room for. */
+    struct Statistics
+    {
+        UINT64 m_allocations = 0;
+        UINT64 m_allocatedBytes = 0;
+        UINT64 m_overflowAllocations = 0;
+        UINT64 m_overflowBytes = 0;
+    };
+
+    static void Initialize(UINT64 frameSize, UINT frameCount);
+    /** Starts handing out the region of frameIndex and frees the heap fallbacks made the last time it was used. */
+    static void BeginFrame(UINT frameIndex);
+    static void* Allocate(size_t size, size_t alignment);
+    static void Shutdown();
+
+    /** Counters of the frame in progress and of the last finished one. */
+    static Statistics GetStatistics();
+    static Statistics GetLastFrameStatistics();
+
+    /** Offset a scope rewinds to. */
+    static UINT64 GetMarker();
+    static void Rewind(UINT64 marker);
+};
+
+/** Hands the memory allocated while it lives back to the frame arena, for scratch that is done before the frame is. */
+class RevFrameArenaScope
+{
+public:
+    RevFrameArenaScope() : m_marker(RevFrameArena::GetMarker()) {}
+    ~RevFrameArenaScope() { RevFrameArena::Rewind(m_marker); }
+
+    RevFrameArenaScope(const RevFrameArenaScope&) = delete;
+    RevFrameArenaScope& operator=(const RevFrameArenaScope&) = delete;
+
+private:
+    UINT64 m_marker;
+};
+
+/** std::allocator over RevFrameArena, deallocation is a no-op. Containers using it must not outlive the frame. */
+template<typename T>
+struct RevFrameAllocator
+{
+    typedef T value_type;
+
+    RevFrameAllocator() = default;
+    template<typename U>
+    RevFrameAllocator(const RevFrameAllocator<U>&) {}
+
+    T* allocate(size_t count)
+    {
+        return static_cast<T*>(RevFrameArena::Allocate(count * sizeof(T), alignof(T)));
+    }
+    void deallocate(T*, size_t)
+    {
+    }
+
+    template<typename U>
+    bool operator==(const RevFrameAllocator<U>&) const { return true; }
+    template<typename U>
+    bool operator!=(const RevFrameAllocator<U>&) const { return false; }
+};
+
+/** Per frame scratch array, see RevFrameAllocator. */
+template<typename T>
+using RevFrameVector = std::vector<T, RevFrameAllocator<T>>;
@@ -0,0 +1,141 @@
+#include "stdafx.h"
+#include "RevGeometryPool.h"
+#include <stdexcept>
+#include <vector>
+#include "RevCoreDefines.h"
+#include "RevDeferredRelease.h"
+#include "RevGpuHeapAllocator.h"
+#include "RevMemoryTracker.h"
+#include "RevStagingUpload.h"
+#include "RevTlsfAllocator.h"
+#include "../DXSampleHelper.h"
+
+namespace
+{
+    struct RevGeometryPage
+    {
+        ComPtr<ID3D12Resource> m_buffer;
+        UINT m_stride = 0;
+        RevTlsfAllocator m_allocator;
+    };
+
+    std::vector<std::shared_ptr<RevGeometryPage>> g_pages;
+
+    std::shared_ptr<RevGeometryPage> CreatePage(UINT stride, UINT64 minimumSize)
+    {
+        std::shared_ptr<RevGeometryPage> page = std::make_shared<RevGeometryPage>();
+        // Meshes larger than a page get a page of their own.
+        const UINT64 granularity = RevTlsfAllocator::s_granularity;
+        const UINT64 size = (max(minimumSize, static_cast<UINT64>(REV_GEOMETRY_POOL_PAGE_SIZE)) + granularity - 1) & ~(granularity - 1);
+        // Allocate rejects anything that would not fit a view.
+        assert(size <= UINT_MAX);
+        page->m_buffer = RevGpuHeapAllocator::CreateBuffer(
+            size, D3D12_RESOURCE_FLAG_NONE, D3D12_RESOURCE_STATE_COMMON, D3D12_HEAP_TYPE_DEFAULT);
+        RevMemoryTracker::TrackResource(RevEMemoryTag::Models, page->m_buffer.Get());
+        page->m_stride = stride;
+        page->m_allocator.Initialize(size);
+        return page;
+    }
+}
+
+std::shared_ptr<const RevGeometryRange> RevGeometryPool::Allocate(const void* data, UINT count, UINT stride)
+{
+    assert(count > 0 && stride > 0);
+    // Offsets come in allocator granules, strides that do not divide them need room to round up to an element.
+    const UINT64 padding = RevTlsfAllocator::s_granularity % stride == 0 ? 0 : stride - 1;
+    const UINT64 size = static_cast<UINT64>(count) * stride + padding;
+    // Vertex and index buffer views hold 32-bit sizes, a page that large would wrap them.
+    const UINT64 granularity = RevTlsfAllocator::s_granularity;
+    if (((size + granularity - 1) & ~(granularity - 1)) > UINT_MAX)
+    {
+        throw std::runtime_error("Geometry stream exceeds the 4 GB a buffer view can address");
+    }
+
+    std::shared_ptr<RevGeometryPage> page;
+    RevTlsfAllocation allocation;
+    for (const std::shared_ptr<RevGeometryPage>& candidate : g_pages)
+    {
+        if (candidate->m_stride != stride)
+        {
+            continue;
+        }
+        allocation = candidate->m_allocator.Allocate(size, RevTlsfAllocator::s_granularity);
+        if (allocation.IsValid())
+        {
+            page = candidate;
+            break;
+        }
+    }
+    if (!page)
+    {
+        page = CreatePage(stride, size);
+        g_pages.push_back(page);
+        allocation = page->m_allocator.Allocate(size, RevTlsfAllocator::s_granularity);
+    }
+    // A stream larger than a page gets a page of exactly its size, which the allocator fits as a whole.
+    if (!allocation.IsValid())
+    {
+        throw std::runtime_error("Geometry stream does not fit its pool page");
+    }
+
+    RevGeometryRange* range = new RevGeometryRange();
+    range->m_buffer = page->m_buffer.Get();
+    range->m_stride = stride;
+    range->m_first = static_cast<UINT>((allocation.m_offset + stride - 1) / stride);
+    range->m_count = count;
+    RevStagingUpload::Upload(range->m_buffer, range->GetByteOffset(), data, range->GetByteSize());
+
+    // The deleter holds the page, so its buffer outlives every range placed in it. Draws already submitted may
+    // still read the range, it is reused only once the GPU passed them.
+    return std::shared_ptr<const RevGeometryRange>(range, [page, allocation](const RevGeometryRange* released)
+    {
+        RevDeferredRelease::Defer([page, allocation]()
+        {
+            page->m_allocator.Free(allocation);
+        });
+        delete released;
+    });
+}
+
+D3D12_VERTEX_BUFFER_VIEW RevGeometryPool::GetVertexBufferView(const RevGeometryRange& range)
+{
+    D3D12_VERTEX_BUFFER_VIEW view;
+    view.BufferLocation = range.m_buffer->GetGPUVirtualAddress();
+    view.StrideInBytes = range.m_stride;
+    view.SizeInBytes = static_cast<UINT>(range.m_buffer->GetDesc().Width);
+    return view;
+}
+
+D3D12_INDEX_BUFFER_VIEW RevGeometryPool::GetIndexBufferView(const RevGeometryRange& range, DXGI_FORMAT format)
+{
+    D3D12_INDEX_BUFFER_VIEW view;
+    view.BufferLocation = range.m_buffer->GetGPUVirtualAddress();
+    view.Format = format;
+    view.SizeInBytes = static_cast<UINT>(range.m_buffer->GetDesc().Width);
+    return view;
+}
+
+UINT64 RevGeometryPool::GetReservedSize()
+{
+    UINT64 reserved = 0;
+    for (const std::shared_ptr<RevGeometryPage>& page : g_pages)
+    {
+        reserved += page->m_allocator.GetSize();
+    }
+    return reserved;
+}
+
+UINT64 RevGeometryPool::GetUsedSize()
+{
+    UINT64 used = 0;
+    for (const std::shared_ptr<RevGeometryPage>& page : g_pages)
+    {
+        used += page->m_allocator.GetUsedSize();
+    }
+    return used;
+}
+
+void RevGeometryPool::Shutdown()
+{
+    g_pages.clear();
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <memory>
+
+/** Elements of a RevGeometryPool buffer. m_first counts elements of m_stride from the start of m_buffer, so it is
+ *  directly the base vertex or start index of a draw. */
+struct RevGeometryRange
+{
+    ID3D12Resource* m_buffer = nullptr;
+    UINT m_stride = 0;
+    UINT m_first = 0;
+    UINT m_count = 0;
+
+    UINT64 GetByteOffset() const { return static_cast<UINT64>(m_first) * m_stride; }
+    UINT64 GetByteSize() const { return static_cast<UINT64>(m_count) * m_stride; }
+};
+
+/** Static geometry sub-allocated from a few large default heap buffers instead of buffers of its own. Every buffer
+ *  holds elements of a single stride, so models with the same vertex layout or index format bind the same views
+ *  and only differ in their draw offsets. Buffers are REV_GEOMETRY_POOL_PAGE_SIZE, ranges are placed by a
+ *  RevTlsfAllocator and go back to it once the last reference to them is released and the GPU is done with them. */
+class RevGeometryPool
+{
+public:
+    /** Uploads count elements of stride bytes through RevStagingUpload into a shared buffer. Throws std::runtime_error
+     *  for streams over the 4 GB a buffer view addresses. */
+    static std::shared_ptr<const RevGeometryRange> Allocate(const void* data, UINT count, UINT stride);
+
+    /** Views of the whole buffer holding range, identical for every range of that buffer. */
+    static D3D12_VERTEX_BUFFER_VIEW GetVertexBufferView(const RevGeometryRange& range);
+    static D3D12_INDEX_BUFFER_VIEW GetIndexBufferView(const RevGeometryRange& range, DXGI_FORMAT format);
+
+    /** Bytes of the pool buffers and the part of them ranges use. */
+    static UINT64 GetReservedSize();
+    static UINT64 GetUsedSize();
+
+    /** Drops the pool references to its buffers, each is released once its last range is. */
+    static void Shutdown();
+};
@@ -0,0 +1,272 @@
+#include "stdafx.h"
+#include "RevGpuHeapAllocator.h"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+#include "RevCoreDefines.h"
+#include "RevDeferredRelease.h"
+#include "RevEngineRetrievalFunctions.h"
+#include "RevMemoryTracker.h"
+#include "RevTlsfAllocator.h"
+#include "../DXSampleHelper.h"
+
+namespace
+{
+    struct RevGpuHeapBlock
+    {
+        Microsoft::WRL::ComPtr<ID3D12Heap> m_heap;
+        D3D12_HEAP_TYPE m_heapType = D3D12_HEAP_TYPE_DEFAULT;
+        RevTlsfAllocator m_allocator;
+        // Buffers are destroyed wherever their last reference goes, frees lock the block on their own.
+        std::mutex m_mutex;
+    };
+
+    // Identifies the placement record a placed buffer holds on to.
+    const GUID g_placementGuid = { 0x2c9d4b17, 0x5e0a, 0x4f63, { 0xa1, 0x8e, 0x73, 0x0c, 0x5b, 0xd2, 0x46, 0x9f } };
+
+    std::mutex g_blocksMutex;
+    std::vector<std::shared_ptr<RevGpuHeapBlock>> g_blocks;
+
+    /** Attached to a placed buffer as private data, the buffer releases it when it is destroyed. Holding the
+     *  block keeps its heap and allocator alive until the last buffer in it is gone. */
+    class RevPlacementRecord : public IUnknown
+    {
+    public:
+        RevPlacementRecord(std::shared_ptr<RevGpuHeapBlock> block, const RevTlsfAllocation& allocation)
+            : m_block(std::move(block)), m_allocation(allocation) {}
+
+        HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** object) override
+        {
+            if (!object)
+            {
+                return E_POINTER;
+            }
+            if (riid == __uuidof(IUnknown))
+            {
+                *object = static_cast<IUnknown*>(this);
+                AddRef();
+                return S_OK;
+            }
+            *object = nullptr;
+            return E_NOINTERFACE;
+        }
+        ULONG STDMETHODCALLTYPE AddRef() override
+        {
+            return ++m_references;
+        }
+        ULONG STDMETHODCALLTYPE Release() override
+        {
+            const ULONG references = --m_references;
+            if (references == 0)
+            {
+                {
+                    std::lock_guard<std::mutex> lock(m_block->m_mutex);
+                    m_block->m_allocator.Free(m_allocation);
+                }
+                delete this;
+            }
+            return references;
+        }
+
+    private:
+        std::atomic<ULONG> m_references{ 1 };
+        std::shared_ptr<RevGpuHeapBlock> m_block;
+        RevTlsfAllocation m_allocation;
+    };
+
+    std::shared_ptr<RevGpuHeapBlock> CreateBlock(D3D12_HEAP_TYPE heapType)
+    {
+        std::shared_ptr<RevGpuHeapBlock> block = std::make_shared<RevGpuHeapBlock>();
+        D3D12_HEAP_DESC desc = {};
+        desc.SizeInBytes = REV_GPU_HEAP_BLOCK_SIZE;
+        desc.Properties = CD3DX12_HEAP_PROPERTIES(heapType);
+        desc.Alignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+        // Tier 1 hardware keeps buffers, textures and render targets in separate heaps.
+        desc.Flags = D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS;
+        ThrowIfFailed(RevEngineRetrievalFunctions::GetDevice()->CreateHeap(&desc, IID_PPV_ARGS(&block->m_heap)));
+        block->m_heapType = heapType;
+        block->m_allocator.Initialize(REV_GPU_HEAP_BLOCK_SIZE);
+        return block;
+    }
+
+    struct RevSmallBufferPage
+    {
+        Microsoft::WRL::ComPtr<ID3D12Resource> m_buffer;
+        UINT8* m_mapped = nullptr;
+        D3D12_HEAP_TYPE m_heapType = D3D12_HEAP_TYPE_DEFAULT;
+        RevEMemoryTag m_tag = RevEMemoryTag::Count;
+        RevTlsfAllocator m_allocator;
+    };
+
+    // Guards the pages and their allocators, ranges are freed from whichever thread collects them.
+    std::mutex g_smallPagesMutex;
+    std::vector<std::shared_ptr<RevSmallBufferPage>> g_smallPages;
+
+    std::shared_ptr<RevSmallBufferPage> CreateSmallBufferPage(D3D12_HEAP_TYPE heapType, RevEMemoryTag tag, UINT64 minimumSize)
+    {
+        std::shared_ptr<RevSmallBufferPage> page = std::make_shared<RevSmallBufferPage>();
+        const UINT64 granularity = RevTlsfAllocator::s_granularity;
+        const UINT64 size = (max(minimumSize, static_cast<UINT64>(REV_GPU_SMALL_BUFFER_PAGE_SIZE)) + granularity - 1) & ~(granularity - 1);
+        assert(heapType == D3D12_HEAP_TYPE_UPLOAD || heapType == D3D12_HEAP_TYPE_DEFAULT);
+        const D3D12_RESOURCE_STATES state = heapType == D3D12_HEAP_TYPE_UPLOAD ? D3D12_RESOURCE_STATE_GENERIC_READ : D3D12_RESOURCE_STATE_COMMON;
+        page->m_buffer = RevGpuHeapAllocator::CreateBuffer(size, D3D12_RESOURCE_FLAG_NONE, state, heapType);
+        RevMemoryTracker::TrackResource(tag, page->m_buffer.Get());
+        if (heapType == D3D12_HEAP_TYPE_UPLOAD)
+        {
+            CD3DX12_RANGE readRange(0, 0);
+            ThrowIfFailed(page->m_buffer->Map(0, &readRange, reinterpret_cast<void**>(&page->m_mapped)));
+        }
+        page->m_heapType = heapType;
+        page->m_tag = tag;
+        page->m_allocator.Initialize(size);
+        return page;
+    }
+
+    Microsoft::WRL::ComPtr<ID3D12Resource> CreateCommittedBuffer(const D3D12_RESOURCE_DESC& desc,
+        D3D12_RESOURCE_STATES initialState, D3D12_HEAP_TYPE heapType)
+    {
+        Microsoft::WRL::ComPtr<ID3D12Resource> buffer;
+        CD3DX12_HEAP_PROPERTIES heapProperty(heapType);
+        ThrowIfFailed(RevEngineRetrievalFunctions::GetDevice()->CreateCommittedResource(
+            &heapProperty, D3D12_HEAP_FLAG_NONE, &desc, initialState, nullptr, IID_PPV_ARGS(&buffer)));
+        return buffer;
+    }
+}
+
+Microsoft::WRL::ComPtr<ID3D12Resource> RevGpuHeapAllocator::CreateBuffer(UINT64 size, D3D12_RESOURCE_FLAGS flags,
+    D3D12_RESOURCE_STATES initialState, D3D12_HEAP_TYPE heapType)
+{
+    ID3D12Device5* device = RevEngineRetrievalFunctions::GetDevice();
+    const CD3DX12_RESOURCE_DESC desc = CD3DX12_RESOURCE_DESC::Buffer(size, flags);
+    const D3D12_RESOURCE_ALLOCATION_INFO info = device->GetResourceAllocationInfo(0, 1, &desc);
+    if (info.SizeInBytes > REV_GPU_HEAP_BLOCK_SIZE / 4)
+    {
+        return CreateCommittedBuffer(desc, initialState, heapType);
+    }
+
+    std::shared_ptr<RevGpuHeapBlock> block;
+    RevTlsfAllocation allocation;
+    {
+        std::lock_guard<std::mutex> lock(g_blocksMutex);
+        for (const std::shared_ptr<RevGpuHeapBlock>& candidate : g_blocks)
+        {
+            if (candidate->m_heapType != heapType)
+            {
+                continue;
+            }
+            std::lock_guard<std::mutex> blockLock(candidate->m_mutex);
+            allocation = candidate->m_allocator.Allocate(info.SizeInBytes, info.Alignment);
+            if (allocation.IsValid())
+            {
+                block = candidate;
+                break;
+            }
+        }
+        if (!block)
+        {
+            block = CreateBlock(heapType);
+            g_blocks.push_back(block);
+            allocation = block->m_allocator.Allocate(info.SizeInBytes, info.Alignment);
+        }
+    }
+    if (!allocation.IsValid())
+    {
+        throw std::runtime_error("Buffer does not fit a GPU heap block");
+    }
+
+    Microsoft::WRL::ComPtr<ID3D12Resource> buffer;
+    const HRESULT result = device->CreatePlacedResource(block->m_heap.Get(), allocation.m_offset, &desc, initialState,
+        nullptr, IID_PPV_ARGS(&buffer));
+    if (FAILED(result))
+    {
+        std::lock_guard<std::mutex> blockLock(block->m_mutex);
+        block->m_allocator.Free(allocation);
+        ThrowIfFailed(result);
+    }
+    RevPlacementRecord* record = new RevPlacementRecord(std::move(block), allocation);
+    // The buffer holds the only reference from here on.
+    ThrowIfFailed(buffer->SetPrivateDataInterface(g_placementGuid, record));
+    record->Release();
+    return buffer;
+}
+
+std::shared_ptr<const RevGpuBufferRange> RevGpuHeapAllocator::CreateSmallBuffer(UINT64 size, D3D12_HEAP_TYPE heapType,
+    RevEMemoryTag tag)
+{
+    assert(size > 0);
+    // The allocator granule is the constant buffer placement alignment, every offset can back a view.
+    static_assert(RevTlsfAllocator::s_granularity % D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT == 0,
+        "Small buffer offsets must be constant buffer aligned");
+    std::shared_ptr<RevSmallBufferPage> page;
+    RevTlsfAllocation allocation;
+    {
+        std::lock_guard<std::mutex> lock(g_smallPagesMutex);
+        for (const std::shared_ptr<RevSmallBufferPage>& candidate : g_smallPages)
+        {
+            if (candidate->m_heapType != heapType || candidate->m_tag != tag)
+            {
+                continue;
+            }
+            allocation = candidate->m_allocator.Allocate(size, RevTlsfAllocator::s_granularity);
+            if (allocation.IsValid())
+            {
+                page = candidate;
+                break;
+            }
+        }
+        if (!page)
+        {
+            page = CreateSmallBufferPage(heapType, tag, size);
+            g_smallPages.push_back(page);
+            allocation = page->m_allocator.Allocate(size, RevTlsfAllocator::s_granularity);
+        }
+    }
+    // Pages larger than REV_GPU_SMALL_BUFFER_PAGE_SIZE are sized to their buffer, the allocator fits them exactly.
+    if (!allocation.IsValid())
+    {
+        throw std::runtime_error("Small buffer does not fit its page");
+    }
+
+    RevGpuBufferRange* range = new RevGpuBufferRange();
+    range->m_buffer = page->m_buffer.Get();
+    range->m_offset = allocation.m_offset;
+    range->m_size = size;
+    range->m_mapped = page->m_mapped ? page->m_mapped + allocation.m_offset : nullptr;
+
+    // Like RevGeometryPool ranges, the deleter holds the page and the range is reused once the GPU passed its last use.
+    return std::shared_ptr<const RevGpuBufferRange>(range, [page, allocation](const RevGpuBufferRange* released)
+    {
+        RevDeferredRelease::Defer([page, allocation]()
+        {
+            std::lock_guard<std::mutex> lock(g_smallPagesMutex);
+            page->m_allocator.Free(allocation);
+        });
+        delete released;
+    });
+}
+
+UINT64 RevGpuHeapAllocator::GetReservedSize()
+{
+    std::lock_guard<std::mutex> lock(g_blocksMutex);
+    return g_blocks.size() * REV_GPU_HEAP_BLOCK_SIZE;
+}
+
+UINT64 RevGpuHeapAllocator::GetUsedSize()
+{
+    std::lock_guard<std::mutex> lock(g_blocksMutex);
+    UINT64 used = 0;
+    for (const std::shared_ptr<RevGpuHeapBlock>& block : g_blocks)
+    {
+        std::lock_guard<std::mutex> blockLock(block->m_mutex);
+        used += block->m_allocator.GetUsedSize();
+    }
+    return used;
+}
+
+void RevGpuHeapAllocator::Shutdown()
+{
+    std::lock_guard<std::mutex> lock(g_smallPagesMutex);
+    g_smallPages.clear();
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <memory>
+
+enum class RevEMemoryTag : UINT8;
+
+/** Bytes of a shared RevGpuHeapAllocator buffer, m_offset is a multiple of 256 so it can back a constant buffer view. */
+struct RevGpuBufferRange
+{
+    ID3D12Resource* m_buffer = nullptr;
+    UINT64 m_offset = 0;
+    UINT64 m_size = 0;
+    // Persistently mapped start of the range for upload heap ranges, null otherwise.
+    UINT8* m_mapped = nullptr;
+
+    D3D12_GPU_VIRTUAL_ADDRESS GetGpuAddress() const { return m_buffer->GetGPUVirtualAddress() + m_offset; }
+};
+
+/** Places buffers into large ID3D12Heap blocks instead of giving every buffer a committed resource of its own.
+ *  Each block is sub-allocated by a RevTlsfAllocator and a buffer hands its range back when it is destroyed.
+ *  Buffers larger than a quarter of REV_GPU_HEAP_BLOCK_SIZE still get a committed resource.
+ *  D3D12 places buffers at 64 KB, so constant buffers and other small data take a range of a shared buffer instead. */
+class RevGpuHeapAllocator
+{
+public:
+    /** A placed resource of its own, meant for large buffers like acceleration structures and their scratch. */
+    static Microsoft::WRL::ComPtr<ID3D12Resource> CreateBuffer(UINT64 size, D3D12_RESOURCE_FLAGS flags,
+        D3D12_RESOURCE_STATES initialState, D3D12_HEAP_TYPE heapType);
+
+    /** size bytes of a REV_GPU_SMALL_BUFFER_PAGE_SIZE buffer shared by the small buffers of heapType and tag. Default
+     *  heap pages stay in the common state. The range goes back once its last reference is released and the GPU
+     *  is done with it. */
+    static std::shared_ptr<const RevGpuBufferRange> CreateSmallBuffer(UINT64 size, D3D12_HEAP_TYPE heapType, RevEMemoryTag tag);
+
+    /** Bytes reserved in heap blocks and the part of them placed buffers use. */
+    static UINT64 GetReservedSize();
+    static UINT64 GetUsedSize();
+
+    /** Drops the references to the shared small buffer pages, each is released once its last range is. */
+    static void Shutdown();
+};
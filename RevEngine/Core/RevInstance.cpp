@@ -1,16 +1,97 @@
 #include "stdafx.h"
 #include "RevInstance.h"
 
+#include "RevAnimationSystem.h"
 #include "RevEngineRetrievalFunctions.h"
 #include "RevModel.h"
+#include "../Misc/RevTypes.h"
+
+RevInstance::~RevInstance()
+{
+	delete m_animation;
+}
 
 void RevInstance::Initialize(RevModelInitializationData modelInitializationData, DirectX::XMMATRIX transform)
 {
 	m_modelHandle = RevModelManager::FindModelHandleFromType(modelInitializationData);
 	m_transform = transform;
+	const RevAnimationData& animationData = RevModelManager::FindModelFromHandle(m_modelHandle)->GetModelData().m_animation;
+	if (animationData.IsAnimated())
+	{
+		m_animation = new RevAnimationInstance();
+		m_animation->Initialize(&animationData);
+	}
 }
 
 void RevInstance::DrawInstance(const RevDrawData& data)
 {
-	RevModelManager::FindModelFromHandle(m_modelHandle)->DrawRasterized(data);
+	RevModel* model = RevModelManager::FindModelFromHandle(m_modelHandle);
+	if (model->HasClusters() && data.m_lodScale > 0.0f)
+	{
+		// The cut is picked in model space, where the cluster bounds live.
+		XMVECTOR determinant;
+		XMMATRIX inverseTransform = XMMatrixInverse(&determinant, m_transform);
+		XMVECTOR viewPosition = XMVector3TransformCoord(XMLoadFloat3(&data.m_viewPosition), inverseTransform);
+		model->SelectClusterCut(data, viewPosition, m_clusterCut);
+		model->DrawClusters(data, m_clusterCut);
+		return;
+	}
+	if (m_skinnedVertexBufferView.SizeInBytes > 0)
+	{
+		model->DrawRasterized(data, 0, &m_skinnedVertexBufferView);
+		return;
+	}
+	model->DrawRasterized(data, SelectLod(data));
+}
+
+void RevInstance::DrawInstanceDepthOnly(const RevDrawData& data)
+{
+	// The position stream holds the bind pose, skinned instances only lay down depth in the main pass.
+	if (m_skinnedVertexBufferView.SizeInBytes > 0)
+	{
+		return;
+	}
+	RevModelManager::FindModelFromHandle(m_modelHandle)->DrawDepthOnly(data, SelectLod(data));
+}
+
+UINT RevInstance::SelectLod(const RevDrawData& data) const
+{
+	const float distance = XMVectorGetX(XMVector3Length(m_transform.r[3] - XMLoadFloat3(&data.m_viewPosition)));
+	return RevModelManager::FindModelFromHandle(m_modelHandle)->SelectLod(data, distance);
+}
+
+bool RevInstance::IsVisible(const RevDrawData& data) const
+{
+	if (!data.m_frustumCulling)
+	{
+		return true;
+	}
+	const RevBounds& bounds = RevModelManager::FindModelFromHandle(m_modelHandle)->GetBounds();
+	XMVECTOR center = XMVector3TransformCoord(XMLoadFloat3(&bounds.m_sphereCenter), m_transform);
+	const float radius = bounds.m_sphereRadius * GetMaxScale();
+	for (const XMFLOAT4& plane : data.m_frustumPlanes)
+	{
+		if (XMVectorGetX(XMPlaneDotCoord(XMLoadFloat4(&plane), center)) < -radius)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+float RevInstance::GetPixelsPerUnit(const RevDrawData& data) const
+{
+	if (data.m_lodScale <= 0.0f)
+	{
+		return 0.0f;
+	}
+	// Clamped so a camera inside the instance does not divide by zero.
+	const float distance = max(XMVectorGetX(XMVector3Length(m_transform.r[3] - XMLoadFloat3(&data.m_viewPosition))), 0.01f);
+	return data.m_lodScale * GetMaxScale() / distance;
+}
+
+float RevInstance::GetMaxScale() const
+{
+	return sqrtf(max(XMVectorGetX(XMVector3LengthSq(m_transform.r[0])),
+		max(XMVectorGetX(XMVector3LengthSq(m_transform.r[1])), XMVectorGetX(XMVector3LengthSq(m_transform.r[2])))));
 }
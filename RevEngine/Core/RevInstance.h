@@ -5,21 +5,43 @@
 #include "RevCoreDefines.h"
 #include "RevModelManager.h"
 
+struct RevAnimationInstance;
 struct RevDrawData;
 enum RevEModelType : UINT8;
 class RevInstance
 {
 public:
     RevInstance() {};
+    ~RevInstance();
+    RevInstance(const RevInstance&) = delete;
+    RevInstance& operator=(const RevInstance&) = delete;
 
     void Initialize(RevModelInitializationData modelInitializationData, DirectX::XMMATRIX transform);
     void DrawInstance(const RevDrawData& data);
+    void DrawInstanceDepthOnly(const RevDrawData& data);
+    /** LOD of the instance model for the view in data. */
+    UINT SelectLod(const RevDrawData& data) const;
+    /** False when the transformed model sphere is fully outside the frustum in data. */
+    bool IsVisible(const RevDrawData& data) const;
+    /** Pixels one model space unit covers at the instance position for the view in data, 0 without LOD scale. */
+    float GetPixelsPerUnit(const RevDrawData& data) const;
 
     DirectX::XMMATRIX m_transform;
+    // Clusters drawn this frame, kept to reuse the allocation.
+    std::vector<UINT> m_clusterCut;
 
+    // Pose of instances of animated models, nullptr otherwise.
+    RevAnimationInstance* m_animation = nullptr;
+    // This frame's CPU skinned vertexes in the skinning ring of the instance manager, empty when not skinned.
+    // The raster path draws from it and its address is what a BLAS refit of the instance would read.
+    D3D12_VERTEX_BUFFER_VIEW m_skinnedVertexBufferView = {};
     RevModelManager* m_modelManager = nullptr;
     Microsoft::WRL::ComPtr<ID3D12Resource> m_resource = nullptr;
     REV_ID_HANDLE m_modelHandle;
     REV_ID_HANDLE m_instanceHandle;
+
+private:
+    /** Largest axis scale of m_transform. */
+    float GetMaxScale() const;
 };
 
@@ -1,7 +1,11 @@
 #include "stdafx.h"
 #include "RevInstanceManager.h"
+#include <algorithm>
+#include "RevAnimationSystem.h"
+#include "RevDeferredRelease.h"
 #include "RevEngineRetrievalFunctions.h"
 #include "RevModel.h"
+#include "../RevEngineMain.h"
 #include "../TopLevelASGenerator.h"
 
 RevInstanceManager* GetInstanceManagerInternal()
@@ -16,12 +20,36 @@ void RevInstanceManager::AddInstance(RevModelInitializationData data, DirectX::X
     {
         return;
     }
-    RevInstance* newInstance = new RevInstance();
+    RevInstance* newInstance = instanceManager->m_instancePool.Create();
     newInstance->Initialize(data, transform);
     instanceManager->m_instances.push_back(newInstance);
+    if (newInstance->m_animation)
+    {
+        instanceManager->m_animatedInstances.push_back(newInstance);
+        if (RevModelManager::FindModelFromHandle(newInstance->m_modelHandle)->m_skinningData.IsValid())
+        {
+            instanceManager->m_skinnedInstances.push_back(newInstance);
+        }
+    }
+}
+
+void RevInstanceManager::RemoveInstance(RevInstance* instance)
+{
+    RevInstanceManager* instanceManager = GetInstanceManagerInternal();
+    if (!instanceManager || !instance)
+    {
+        return;
+    }
+    for (std::vector<RevInstance*>* instances : { &instanceManager->m_instances, &instanceManager->m_animatedInstances, &instanceManager->m_skinnedInstances })
+    {
+        instances->erase(std::remove(instances->begin(), instances->end(), instance), instances->end());
+    }
+    // Command lists in flight may still reference the instance resource.
+    RevDeferredRelease::Release(instance->m_resource);
+    instanceManager->m_instancePool.Destroy(instance);
 }
 
-void RevInstanceManager::AddAllInstancesToSBT(nv_helpers_dx12::TopLevelASGenerator* generator)
+void RevInstanceManager::AddAllInstancesToSBT(nv_helpers_dx12::TopLevelASGenerator* generator, const RevDrawData& lodData)
 {
     RevInstanceManager* instanceManager = GetInstanceManagerInternal();
     if (!instanceManager)
@@ -33,10 +61,87 @@ void RevInstanceManager::AddAllInstancesToSBT(nv_helpers_dx12::TopLevelASGenerat
     for (size_t i = 0; i < instanceManager->m_instances.size(); i++)
     {
         RevInstance* instance = instanceManager->m_instances[i];
-        ID3D12Resource* resource = RevModelManager::FindModelFromHandle(instance->m_modelHandle)->m_relevantBuffers.pResult.Get();
-        generator->AddInstance(resource, instance->m_transform,
-            static_cast<UINT>(i), static_cast<UINT>(i));
+        RevModel* model = RevModelManager::FindModelFromHandle(instance->m_modelHandle);
+        // Every BLAS chunk of the model is an instance of its own with the same transform, id and hit group.
+        for (const AccelerationStructureBuffers& buffers : model->GetStructureBuffers(instance->SelectLod(lodData)))
+        {
+            generator->AddInstance(buffers.pResult.Get(), instance->m_transform,
+                static_cast<UINT>(i), static_cast<UINT>(i));
+        }
+    }
+}
+
+void RevInstanceManager::UpdateAnimations(float delta, const RevDrawData& view)
+{
+    m_animationViews.resize(m_animatedInstances.size());
+    for (size_t i = 0; i < m_animatedInstances.size(); i++)
+    {
+        const RevInstance* instance = m_animatedInstances[i];
+        RevAnimationView& animationView = m_animationViews[i];
+        animationView.m_instance = instance->m_animation;
+        animationView.m_visible = instance->IsVisible(view);
+        animationView.m_pixelsPerUnit = instance->GetPixelsPerUnit(view);
     }
+    RevAnimationSystem::Update(m_animationViews.data(), static_cast<UINT>(m_animationViews.size()), delta);
+}
+
+void RevInstanceManager::SkinInstances()
+{
+    if (m_skinnedInstances.empty())
+    {
+        return;
+    }
+    if (!m_skinningRing.IsInitialized())
+    {
+        m_skinningRing.Initialize(REV_SKINNING_RING_SIZE, RevEngineMain::FrameCount);
+    }
+    // The frame waits for the previous one to finish, so the region of this back buffer is free again.
+    m_skinningRing.BeginFrame(RevEngineRetrievalFunctions::GetMain()->m_frameIndex);
+
+    m_skinningJobs.clear();
+    UINT overflowInstances = 0;
+    UINT64 overflowBytes = 0;
+    for (RevInstance* instance : m_skinnedInstances)
+    {
+        const RevSkinningData& skinningData = RevModelManager::FindModelFromHandle(instance->m_modelHandle)->m_skinningData;
+        const UINT stride = sizeof(RevVertexPosTexNormBiTan);
+        const UINT64 size = static_cast<UINT64>(skinningData.m_vertexCount) * stride;
+        instance->m_skinnedVertexBufferView = {};
+        // Culled instances are not drawn this frame, their pose is skinned again once they are back in view.
+        if (!instance->m_animation->m_visible)
+        {
+            continue;
+        }
+        const RevUploadAllocation allocation = m_skinningRing.Allocate(size, sizeof(float));
+        if (!allocation.m_data)
+        {
+            // No room left this frame, the instance draws its bind pose.
+            overflowInstances++;
+            overflowBytes += size;
+            continue;
+        }
+        instance->m_skinnedVertexBufferView.BufferLocation = allocation.m_gpuAddress;
+        instance->m_skinnedVertexBufferView.SizeInBytes = static_cast<UINT>(size);
+        instance->m_skinnedVertexBufferView.StrideInBytes = stride;
+
+        RevSkinningJob job;
+        job.m_data = &skinningData;
+        job.m_matrices = instance->m_animation->m_skinningMatrices.data();
+        job.m_outVertexes = static_cast<RevVertexPosTexNormBiTan*>(allocation.m_data);
+        m_skinningJobs.push_back(job);
+    }
+    RevSkinning::Skin(m_skinningJobs.data(), static_cast<UINT>(m_skinningJobs.size()));
+
+    // Only the frame the ring starts overflowing warns, not every one after it.
+    if (overflowInstances > 0 && m_lastSkinningOverflows == 0)
+    {
+        char message[256];
+        sprintf_s(message, "RevInstanceManager: skinning ring of %llu bytes is full, %u instances (%llu bytes) drawn in bind pose\n",
+            REV_SKINNING_RING_SIZE, overflowInstances, overflowBytes);
+        OutputDebugStringA(message);
+    }
+    m_lastSkinningOverflows = overflowInstances;
+    m_skinningOverflows += overflowInstances;
 }
 
 void RevInstanceManager::DrawInstances(const RevDrawData& data)
@@ -44,6 +149,23 @@ void RevInstanceManager::DrawInstances(const RevDrawData& data)
     for (RevInstance* instance : m_instances)
     {
         assert(instance);
+        if (!instance->IsVisible(data))
+        {
+            continue;
+        }
         instance->DrawInstance(data);
     }
-}
\ No newline at end of file
+}
+
+void RevInstanceManager::DrawInstancesDepthOnly(const RevDrawData& data)
+{
+    for (RevInstance* instance : m_instances)
+    {
+        assert(instance);
+        if (!instance->IsVisible(data))
+        {
+            continue;
+        }
+        instance->DrawInstanceDepthOnly(data);
+    }
+}
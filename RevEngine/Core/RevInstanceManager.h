@@ -3,7 +3,11 @@
 #include <DirectXMath.h>
 
 #include "RevEngineManager.h"
+#include "RevAnimationSystem.h"
 #include "RevInstance.h"
+#include "RevSlabPool.h"
+#include "RevSkinning.h"
+#include "RevUploadRing.h"
 
 struct RevDrawData;
 class RevCamera;
@@ -21,13 +25,37 @@ public:
     RevInstanceManager() {};
 
     static void AddInstance(RevModelInitializationData data, DirectX::XMMATRIX transform);
-    static void AddAllInstancesToSBT(nv_helpers_dx12::TopLevelASGenerator* generator);
-
+    /** Destroys instance, its slot is reused by the next AddInstance. The acceleration structures keep
+     *  referencing it until they are built again. */
+    static void RemoveInstance(RevInstance* instance);
+    static void AddAllInstancesToSBT(nv_helpers_dx12::TopLevelASGenerator* generator, const RevDrawData& lodData);
+
+    /** Advances every animated instance and evaluates the ones due, update rate and joints follow their size in view. */
+    void UpdateAnimations(float delta, const RevDrawData& view);
+    /** Skins the vertexes of every visible animated instance with its current pose into this frame's skinning ring.
+     *  Instances the ring has no room for draw their bind pose that frame, see GetSkinningOverflows.
+     *  Only rasterization sees the skinned vertexes: ray tracing keeps the bind pose BLAS of the model. Refitting it
+     *  needs a BLAS per instance built with ALLOW_UPDATE and a TLAS rebuilt every frame, which is out of scope here. */
+    void SkinInstances();
+    /** Skinned instances drawn in bind pose because the skinning ring was full, summed over all frames. */
+    UINT64 GetSkinningOverflows() const { return m_skinningOverflows; }
     void DrawInstances(const RevDrawData& data);
+    void DrawInstancesDepthOnly(const RevDrawData& data);
 
 private:
 
+    // Storage of the instances, m_instances keeps them in creation order for the instance ids.
+    RevSlabPool<RevInstance> m_instancePool{ RevEMemoryTag::Scene };
     std::vector<RevInstance*> m_instances;
+    std::vector<RevInstance*> m_animatedInstances;
+    // One per animated instance, refreshed every frame for the animation scheduler.
+    std::vector<RevAnimationView> m_animationViews;
+    // Instances whose model has skinning data, a subset of the animated ones.
+    std::vector<RevInstance*> m_skinnedInstances;
+    std::vector<RevSkinningJob> m_skinningJobs;
+    RevUploadRing m_skinningRing;
+    UINT64 m_skinningOverflows = 0;
+    UINT m_lastSkinningOverflows = 0;
 
 };
 
@@ -0,0 +1,146 @@
+#include "stdafx.h"
+#include "RevJobSystem.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    // Ranges handed out per thread, more than one so uneven ranges still balance.
+    const UINT g_batchesPerThread = 4;
+
+    struct RevJobPool
+    {
+        std::vector<std::thread> m_threads;
+        std::mutex m_mutex;
+        std::condition_variable m_wake;
+        std::condition_variable m_done;
+        // Serializes ParallelFor calls from different threads, the pool runs one loop at a time.
+        std::mutex m_submitMutex;
+
+        const std::function<void(UINT, UINT)>* m_job = nullptr;
+        UINT m_count = 0;
+        UINT m_batchSize = 0;
+        std::atomic<UINT> m_nextBatch{ 0 };
+        UINT64 m_generation = 0;
+        UINT m_activeWorkers = 0;
+        bool m_shutdown = false;
+    };
+
+    RevJobPool g_pool;
+    thread_local bool t_insideJob = false;
+
+    void RunBatches()
+    {
+        const UINT numBatches = (g_pool.m_count + g_pool.m_batchSize - 1) / g_pool.m_batchSize;
+        for (UINT batch = g_pool.m_nextBatch++; batch < numBatches; batch = g_pool.m_nextBatch++)
+        {
+            const UINT begin = batch * g_pool.m_batchSize;
+            (*g_pool.m_job)(begin, min(begin + g_pool.m_batchSize, g_pool.m_count));
+        }
+    }
+
+    void WorkerLoop()
+    {
+        t_insideJob = true;
+        UINT64 seenGeneration = 0;
+        std::unique_lock<std::mutex> lock(g_pool.m_mutex);
+        while (true)
+        {
+            g_pool.m_wake.wait(lock, [&seenGeneration]
+            {
+                return g_pool.m_shutdown || (g_pool.m_job && g_pool.m_generation != seenGeneration);
+            });
+            if (g_pool.m_shutdown)
+            {
+                return;
+            }
+            seenGeneration = g_pool.m_generation;
+            g_pool.m_activeWorkers++;
+            lock.unlock();
+            RunBatches();
+            lock.lock();
+            if (--g_pool.m_activeWorkers == 0)
+            {
+                g_pool.m_done.notify_all();
+            }
+        }
+    }
+
+    void StartWorkers()
+    {
+        if (!g_pool.m_threads.empty())
+        {
+            return;
+        }
+        const UINT hardwareThreads = std::thread::hardware_concurrency();
+        const UINT numWorkers = hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+        g_pool.m_shutdown = false;
+        for (UINT index = 0; index < numWorkers; index++)
+        {
+            g_pool.m_threads.emplace_back(WorkerLoop);
+        }
+    }
+}
+
+void RevJobSystem::ParallelFor(UINT count, UINT minBatchSize, const std::function<void(UINT begin, UINT end)>& job)
+{
+    if (count == 0)
+    {
+        return;
+    }
+    minBatchSize = max(minBatchSize, 1u);
+    if (t_insideJob || count <= minBatchSize)
+    {
+        job(0, count);
+        return;
+    }
+
+    std::lock_guard<std::mutex> submitLock(g_pool.m_submitMutex);
+    {
+        std::lock_guard<std::mutex> lock(g_pool.m_mutex);
+        StartWorkers();
+        const UINT numThreads = static_cast<UINT>(g_pool.m_threads.size()) + 1;
+        g_pool.m_job = &job;
+        g_pool.m_count = count;
+        g_pool.m_batchSize = max(minBatchSize, (count + numThreads * g_batchesPerThread - 1) / (numThreads * g_batchesPerThread));
+        g_pool.m_nextBatch = 0;
+        g_pool.m_generation++;
+    }
+    g_pool.m_wake.notify_all();
+
+    t_insideJob = true;
+    RunBatches();
+    t_insideJob = false;
+
+    // Every range is claimed once RunBatches returns, wait for the workers still running theirs.
+    // Clearing the job under the lock keeps late workers from picking up this loop.
+    std::unique_lock<std::mutex> lock(g_pool.m_mutex);
+    g_pool.m_done.wait(lock, [] { return g_pool.m_activeWorkers == 0; });
+    g_pool.m_job = nullptr;
+}
+
+UINT RevJobSystem::GetNumThreads()
+{
+    std::lock_guard<std::mutex> lock(g_pool.m_mutex);
+    StartWorkers();
+    return static_cast<UINT>(g_pool.m_threads.size()) + 1;
+}
+
+void RevJobSystem::Shutdown()
+{
+    std::lock_guard<std::mutex> submitLock(g_pool.m_submitMutex);
+    {
+        std::lock_guard<std::mutex> lock(g_pool.m_mutex);
+        g_pool.m_shutdown = true;
+    }
+    g_pool.m_wake.notify_all();
+    for (std::thread& thread : g_pool.m_threads)
+    {
+        thread.join();
+    }
+    g_pool.m_threads.clear();
+}
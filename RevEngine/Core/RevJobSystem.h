@@ -0,0 +1,18 @@
+﻿#pragma once
+#include <functional>
+
+/** Small pool of worker threads for data parallel loops. The workers start on first use and live until Shutdown. */
+class RevJobSystem
+{
+public:
+
+    /** Calls job(begin, end) over [0, count) split into ranges of at least minBatchSize, the calling thread helps out.
+     *  Returns once every range ran. Calls from inside a job run serially on the calling worker. */
+    static void ParallelFor(UINT count, UINT minBatchSize, const std::function<void(UINT begin, UINT end)>& job);
+
+    /** Number of threads ParallelFor spreads work over, the calling thread included. */
+    static UINT GetNumThreads();
+
+    /** Joins the workers, the next ParallelFor starts them again. */
+    static void Shutdown();
+};
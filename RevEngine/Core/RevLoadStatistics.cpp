@@ -0,0 +1,34 @@
+#include "stdafx.h"
+#include "RevLoadStatistics.h"
+#include <atomic>
+
+namespace
+{
+    // Cook steps run on the job system, so the counters are atomics.
+    std::atomic<UINT64> g_allocations{ 0 };
+    std::atomic<UINT64> g_allocatedBytes{ 0 };
+    std::atomic<UINT64> g_copies{ 0 };
+    std::atomic<UINT64> g_copiedBytes{ 0 };
+}
+
+void RevLoadStatistics::RecordAllocation(size_t bytes)
+{
+    g_allocations++;
+    g_allocatedBytes += bytes;
+}
+
+void RevLoadStatistics::RecordCopy(size_t bytes)
+{
+    g_copies++;
+    g_copiedBytes += bytes;
+}
+
+RevLoadStatistics::Snapshot RevLoadStatistics::Get()
+{
+    Snapshot snapshot;
+    snapshot.m_allocations = g_allocations;
+    snapshot.m_allocatedBytes = g_allocatedBytes;
+    snapshot.m_copies = g_copies;
+    snapshot.m_copiedBytes = g_copiedBytes;
+    return snapshot;
+}
@@ -0,0 +1,54 @@
+﻿#pragma once
+#include <vector>
+#include "RevMemoryTracker.h"
+
+/** Allocation and copy counters of the model load pipeline. Geometry is allocated through RevGeometryVector and
+ *  every memcpy of geometry bytes is recorded, so a load can be checked to copy its geometry exactly once, into the
+ *  GPU staging window. */
+class RevLoadStatistics
+{
+public:
+    struct Snapshot
+    {
+        UINT64 m_allocations = 0;
+        UINT64 m_allocatedBytes = 0;
+        UINT64 m_copies = 0;
+        UINT64 m_copiedBytes = 0;
+    };
+
+    static void RecordAllocation(size_t bytes);
+    static void RecordCopy(size_t bytes);
+    static Snapshot Get();
+};
+
+/** std::allocator that reports its allocations to RevLoadStatistics and accounts them to the models tag. */
+template<typename T>
+struct RevTrackedAllocator
+{
+    typedef T value_type;
+
+    RevTrackedAllocator() = default;
+    template<typename U>
+    RevTrackedAllocator(const RevTrackedAllocator<U>&) {}
+
+    T* allocate(size_t count)
+    {
+        RevLoadStatistics::RecordAllocation(count * sizeof(T));
+        RevMemoryTracker::RecordAllocation(RevEMemoryTag::Models, count * sizeof(T));
+        return std::allocator<T>().allocate(count);
+    }
+    void deallocate(T* pointer, size_t count)
+    {
+        RevMemoryTracker::RecordFree(RevEMemoryTag::Models, count * sizeof(T));
+        std::allocator<T>().deallocate(pointer, count);
+    }
+
+    template<typename U>
+    bool operator==(const RevTrackedAllocator<U>&) const { return true; }
+    template<typename U>
+    bool operator!=(const RevTrackedAllocator<U>&) const { return false; }
+};
+
+/** Storage of the large geometry streams in RevModelData. */
+template<typename T>
+using RevGeometryVector = std::vector<T, RevTrackedAllocator<T>>;
@@ -0,0 +1,208 @@
+#include "stdafx.h"
+#include "RevMemoryTracker.h"
+#include <atomic>
+#include <fstream>
+#include "RevEngineRetrievalFunctions.h"
+#include "../DXSampleHelper.h"
+
+namespace
+{
+    struct RevTagCounters
+    {
+        std::atomic<UINT64> m_liveBytes{ 0 };
+        std::atomic<UINT64> m_peakBytes{ 0 };
+        std::atomic<UINT64> m_allocations{ 0 };
+        std::atomic<UINT64> m_frameAllocations{ 0 };
+        std::atomic<UINT64> m_frameAllocatedBytes{ 0 };
+        UINT64 m_lastFrameAllocations = 0;
+        UINT64 m_lastFrameAllocatedBytes = 0;
+        std::atomic<UINT64> m_gpuBytes{ 0 };
+        std::atomic<UINT64> m_gpuPeakBytes{ 0 };
+        std::atomic<UINT64> m_budgetBytes{ 0 };
+        std::atomic<UINT64> m_gpuBudgetBytes{ 0 };
+    };
+
+    // Allocators report from the job system too, so every counter is an atomic.
+    RevTagCounters g_tags[static_cast<size_t>(RevEMemoryTag::Count)];
+
+    const char* g_tagNames[] = { "Models", "Textures", "Shaders", "AccelerationStructures", "Scene", "Frame" };
+    static_assert(_countof(g_tagNames) == static_cast<size_t>(RevEMemoryTag::Count), "Every tag needs a name");
+
+    // Identifies the record a tracked resource holds on to.
+    const GUID g_resourceRecordGuid = { 0x6a1e7f42, 0x93c1, 0x4b0e, { 0x8d, 0x5a, 0x2f, 0x71, 0xc4, 0x0b, 0x9e, 0x13 } };
+
+    RevTagCounters& GetCounters(RevEMemoryTag tag)
+    {
+        assert(tag < RevEMemoryTag::Count);
+        return g_tags[static_cast<size_t>(tag)];
+    }
+
+    void RaisePeak(std::atomic<UINT64>& peak, UINT64 value)
+    {
+        UINT64 current = peak.load();
+        while (value > current && !peak.compare_exchange_weak(current, value))
+        {
+        }
+    }
+
+    void CheckBudget(RevEMemoryTag tag, const char* kind, UINT64 before, UINT64 after, UINT64 budget)
+    {
+        // Only the allocation crossing the budget warns, not every one after it.
+        if (budget == 0 || before > budget || after <= budget)
+        {
+            return;
+        }
+        char message[256];
+        sprintf_s(message, "RevMemoryTracker: %s %s memory is over budget, %llu of %llu bytes\n",
+            RevMemoryTracker::GetTagName(tag), kind, after, budget);
+        OutputDebugStringA(message);
+    }
+
+    void AddGpuBytes(RevEMemoryTag tag, UINT64 bytes)
+    {
+        RevTagCounters& counters = GetCounters(tag);
+        const UINT64 before = counters.m_gpuBytes.fetch_add(bytes);
+        RaisePeak(counters.m_gpuPeakBytes, before + bytes);
+        CheckBudget(tag, "GPU", before, before + bytes, counters.m_gpuBudgetBytes);
+    }
+
+    /** Attached to a tracked resource as private data, the resource releases it when it is destroyed. */
+    class RevResourceRecord : public IUnknown
+    {
+    public:
+        RevResourceRecord(RevEMemoryTag tag, UINT64 bytes) : m_tag(tag), m_bytes(bytes) {}
+
+        HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** object) override
+        {
+            if (!object)
+            {
+                return E_POINTER;
+            }
+            if (riid == __uuidof(IUnknown))
+            {
+                *object = static_cast<IUnknown*>(this);
+                AddRef();
+                return S_OK;
+            }
+            *object = nullptr;
+            return E_NOINTERFACE;
+        }
+        ULONG STDMETHODCALLTYPE AddRef() override
+        {
+            return ++m_references;
+        }
+        ULONG STDMETHODCALLTYPE Release() override
+        {
+            const ULONG references = --m_references;
+            if (references == 0)
+            {
+                GetCounters(m_tag).m_gpuBytes -= m_bytes;
+                delete this;
+            }
+            return references;
+        }
+
+    private:
+        std::atomic<ULONG> m_references{ 1 };
+        RevEMemoryTag m_tag;
+        UINT64 m_bytes;
+    };
+}
+
+void RevMemoryTracker::RecordAllocation(RevEMemoryTag tag, size_t bytes)
+{
+    RevTagCounters& counters = GetCounters(tag);
+    const UINT64 before = counters.m_liveBytes.fetch_add(bytes);
+    RaisePeak(counters.m_peakBytes, before + bytes);
+    counters.m_allocations++;
+    counters.m_frameAllocations++;
+    counters.m_frameAllocatedBytes += bytes;
+    CheckBudget(tag, "CPU", before, before + bytes, counters.m_budgetBytes);
+}
+
+void RevMemoryTracker::RecordFree(RevEMemoryTag tag, size_t bytes)
+{
+    RevTagCounters& counters = GetCounters(tag);
+    assert(counters.m_liveBytes >= bytes);
+    counters.m_liveBytes -= bytes;
+}
+
+void RevMemoryTracker::TrackResource(RevEMemoryTag tag, ID3D12Resource* resource)
+{
+    if (!resource)
+    {
+        return;
+    }
+    const D3D12_RESOURCE_DESC desc = resource->GetDesc();
+    const UINT64 bytes = RevEngineRetrievalFunctions::GetDevice()->GetResourceAllocationInfo(0, 1, &desc).SizeInBytes;
+    RevResourceRecord* record = new RevResourceRecord(tag, bytes);
+    AddGpuBytes(tag, bytes);
+    // The resource holds the only reference from here on.
+    ThrowIfFailed(resource->SetPrivateDataInterface(g_resourceRecordGuid, record));
+    record->Release();
+}
+
+void RevMemoryTracker::SetBudget(RevEMemoryTag tag, UINT64 bytes, UINT64 gpuBytes)
+{
+    RevTagCounters& counters = GetCounters(tag);
+    counters.m_budgetBytes = bytes;
+    counters.m_gpuBudgetBytes = gpuBytes;
+}
+
+void RevMemoryTracker::BeginFrame()
+{
+    for (RevTagCounters& counters : g_tags)
+    {
+        counters.m_lastFrameAllocations = counters.m_frameAllocations.exchange(0);
+        counters.m_lastFrameAllocatedBytes = counters.m_frameAllocatedBytes.exchange(0);
+    }
+}
+
+RevMemoryTracker::TagStatistics RevMemoryTracker::Get(RevEMemoryTag tag)
+{
+    const RevTagCounters& counters = GetCounters(tag);
+    TagStatistics statistics;
+    statistics.m_liveBytes = counters.m_liveBytes;
+    statistics.m_peakBytes = counters.m_peakBytes;
+    statistics.m_allocations = counters.m_allocations;
+    statistics.m_frameAllocations = counters.m_lastFrameAllocations;
+    statistics.m_frameAllocatedBytes = counters.m_lastFrameAllocatedBytes;
+    statistics.m_gpuBytes = counters.m_gpuBytes;
+    statistics.m_gpuPeakBytes = counters.m_gpuPeakBytes;
+    statistics.m_budgetBytes = counters.m_budgetBytes;
+    statistics.m_gpuBudgetBytes = counters.m_gpuBudgetBytes;
+    return statistics;
+}
+
+const char* RevMemoryTracker::GetTagName(RevEMemoryTag tag)
+{
+    assert(tag < RevEMemoryTag::Count);
+    return g_tagNames[static_cast<size_t>(tag)];
+}
+
+bool RevMemoryTracker::DumpSnapshot(const std::wstring& path, const char* label)
+{
+    std::ifstream existing(path.c_str());
+    const bool writeHeader = !existing.good();
+    existing.close();
+
+    std::ofstream file(path.c_str(), std::ios::app);
+    if (!file)
+    {
+        return false;
+    }
+    if (writeHeader)
+    {
+        file << "Label,Tag,LiveBytes,PeakBytes,Allocations,FrameAllocations,FrameAllocatedBytes,GpuBytes,GpuPeakBytes,BudgetBytes,GpuBudgetBytes\n";
+    }
+    for (UINT tag = 0; tag < static_cast<UINT>(RevEMemoryTag::Count); tag++)
+    {
+        const TagStatistics statistics = Get(static_cast<RevEMemoryTag>(tag));
+        file << label << ',' << g_tagNames[tag] << ','
+            << statistics.m_liveBytes << ',' << statistics.m_peakBytes << ','
+            << statistics.m_allocations << ',' << statistics.m_frameAllocations << ',' << statistics.m_frameAllocatedBytes << ','
+            << statistics.m_gpuBytes << ',' << statistics.m_gpuPeakBytes << ','
+            << statistics.m_budgetBytes << ',' << statistics.m_gpuBudgetBytes << '\n';
+    }
+    return file.good();
+}
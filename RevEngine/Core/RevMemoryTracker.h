@@ -0,0 +1,77 @@
+﻿#pragma once
+
+/** Subsystems memory is accounted to. */
+enum class RevEMemoryTag : UINT8
+{
+    Models,
+    Textures,
+    Shaders,
+    AccelerationStructures,
+    Scene,
+    Frame,
+    Count
+};
+
+/** Engine wide memory accounting per tag, system memory reported by the allocators and GPU memory of tracked
+ *  resources. Going over a budget prints a warning to the debugger once per crossing. */
+class RevMemoryTracker
+{
+public:
+    struct TagStatistics
+    {
+        UINT64 m_liveBytes = 0;
+        UINT64 m_peakBytes = 0;
+        UINT64 m_allocations = 0;
+        // Allocations made during the last finished frame, see BeginFrame.
+        UINT64 m_frameAllocations = 0;
+        UINT64 m_frameAllocatedBytes = 0;
+        UINT64 m_gpuBytes = 0;
+        UINT64 m_gpuPeakBytes = 0;
+        // 0 is no budget.
+        UINT64 m_budgetBytes = 0;
+        UINT64 m_gpuBudgetBytes = 0;
+    };
+
+    static void RecordAllocation(RevEMemoryTag tag, size_t bytes);
+    static void RecordFree(RevEMemoryTag tag, size_t bytes);
+    /** Counts the committed size of resource against tag until the resource is destroyed. */
+    static void TrackResource(RevEMemoryTag tag, ID3D12Resource* resource);
+
+    static void SetBudget(RevEMemoryTag tag, UINT64 bytes, UINT64 gpuBytes);
+    /** Closes the allocation rate window of the last frame. */
+    static void BeginFrame();
+
+    static TagStatistics Get(RevEMemoryTag tag);
+    static const char* GetTagName(RevEMemoryTag tag);
+    /** Appends a line per tag to the CSV file at path, label tells the snapshots of one run apart. */
+    static bool DumpSnapshot(const std::wstring& path, const char* label);
+};
+
+/** std::allocator that accounts its memory to Tag. */
+template<typename T, RevEMemoryTag Tag>
+struct RevTaggedAllocator
+{
+    typedef T value_type;
+    template<typename U>
+    struct rebind { typedef RevTaggedAllocator<U, Tag> other; };
+
+    RevTaggedAllocator() = default;
+    template<typename U>
+    RevTaggedAllocator(const RevTaggedAllocator<U, Tag>&) {}
+
+    T* allocate(size_t count)
+    {
+        RevMemoryTracker::RecordAllocation(Tag, count * sizeof(T));
+        return std::allocator<T>().allocate(count);
+    }
+    void deallocate(T* pointer, size_t count)
+    {
+        RevMemoryTracker::RecordFree(Tag, count * sizeof(T));
+        std::allocator<T>().deallocate(pointer, count);
+    }
+
+    template<typename U>
+    bool operator==(const RevTaggedAllocator<U, Tag>&) const { return true; }
+    template<typename U>
+    bool operator!=(const RevTaggedAllocator<U, Tag>&) const { return false; }
+};
@@ -0,0 +1,401 @@
+#include "stdafx.h"
+#include "RevMeshSimplifier.h"
+#include <algorithm>
+#include <cfloat>
+#include "RevCoreDefines.h"
+#include "../D3D/RevD3DTypes.h"
+
+namespace
+{
+    // Every level aims for half the triangles of the previous one.
+    const float g_lodReduction = 0.5f;
+    // A level that keeps more than this fraction of the previous one is not worth its memory.
+    const float g_lodMinimumGain = 0.85f;
+    const size_t g_lodMinimumTriangles = 64;
+
+    /** Symmetric 4x4 plane quadric, stored as its upper triangle. Doubles keep the sums of many planes stable. */
+    struct RevQuadric
+    {
+        double m_a[10] = {};
+
+        static RevQuadric FromPlane(double a, double b, double c, double d)
+        {
+            RevQuadric quadric;
+            quadric.m_a[0] = a * a; quadric.m_a[1] = a * b; quadric.m_a[2] = a * c; quadric.m_a[3] = a * d;
+            quadric.m_a[4] = b * b; quadric.m_a[5] = b * c; quadric.m_a[6] = b * d;
+            quadric.m_a[7] = c * c; quadric.m_a[8] = c * d;
+            quadric.m_a[9] = d * d;
+            return quadric;
+        }
+
+        void Add(const RevQuadric& other)
+        {
+            for (int index = 0; index < 10; index++)
+            {
+                m_a[index] += other.m_a[index];
+            }
+        }
+
+        /** Sum of squared distances of the point to the planes. */
+        double Evaluate(const XMFLOAT3& p) const
+        {
+            const double x = p.x, y = p.y, z = p.z;
+            const double result =
+                m_a[0] * x * x + 2.0 * m_a[1] * x * y + 2.0 * m_a[2] * x * z + 2.0 * m_a[3] * x
+                + m_a[4] * y * y + 2.0 * m_a[5] * y * z + 2.0 * m_a[6] * y
+                + m_a[7] * z * z + 2.0 * m_a[8] * z
+                + m_a[9];
+            return result > 0.0 ? result : 0.0;
+        }
+    };
+
+    struct RevCollapse
+    {
+        UINT m_from;
+        UINT m_to;
+        double m_cost;
+    };
+
+    XMVECTOR TriangleNormal(const std::vector<XMFLOAT3>& positions, UINT a, UINT b, UINT c)
+    {
+        XMVECTOR p0 = XMLoadFloat3(&positions[a]);
+        return XMVector3Cross(XMLoadFloat3(&positions[b]) - p0, XMLoadFloat3(&positions[c]) - p0);
+    }
+
+    /** Whether moving from onto to turns any triangle around from (not shared with to) upside down. */
+    bool CollapseFlipsTriangle(
+        const std::vector<XMFLOAT3>& positions,
+        const std::vector<UINT>& indices,
+        const std::vector<UINT>& adjacencyOffsets,
+        const std::vector<UINT>& adjacency,
+        UINT from,
+        UINT to)
+    {
+        for (UINT entry = adjacencyOffsets[from]; entry < adjacencyOffsets[from + 1]; entry++)
+        {
+            const UINT* triangle = &indices[adjacency[entry] * 3];
+            if (triangle[0] == to || triangle[1] == to || triangle[2] == to)
+            {
+                continue;
+            }
+            UINT moved[3] = { triangle[0], triangle[1], triangle[2] };
+            for (UINT& corner : moved)
+            {
+                corner = corner == from ? to : corner;
+            }
+            XMVECTOR before = TriangleNormal(positions, triangle[0], triangle[1], triangle[2]);
+            XMVECTOR after = TriangleNormal(positions, moved[0], moved[1], moved[2]);
+            if (XMVectorGetX(XMVector3Dot(before, after)) <= 0.0f)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+}
+
+float RevMeshSimplifier::SimplifyTriangles(
+    const std::vector<XMFLOAT3>& positions,
+    const std::vector<bool>& lockedVertexes,
+    std::vector<UINT>& inOutIndices,
+    size_t targetIndexCount,
+    float maxError)
+{
+    const UINT vertexCount = static_cast<UINT>(positions.size());
+    std::vector<bool> locked = lockedVertexes;
+    locked.resize(vertexCount, false);
+
+    // Edges used by a single triangle are open borders, collapsing them would eat into the outline.
+    std::vector<std::pair<UINT, UINT>> edges;
+    edges.reserve(inOutIndices.size());
+    for (size_t index = 0; index + 2 < inOutIndices.size(); index += 3)
+    {
+        for (UINT corner = 0; corner < 3; corner++)
+        {
+            const UINT a = inOutIndices[index + corner];
+            const UINT b = inOutIndices[index + (corner + 1) % 3];
+            edges.push_back(std::make_pair(min(a, b), max(a, b)));
+        }
+    }
+    std::sort(edges.begin(), edges.end());
+    for (size_t edge = 0; edge < edges.size();)
+    {
+        size_t next = edge + 1;
+        while (next < edges.size() && edges[next] == edges[edge])
+        {
+            next++;
+        }
+        if (next - edge == 1)
+        {
+            locked[edges[edge].first] = true;
+            locked[edges[edge].second] = true;
+        }
+        edge = next;
+    }
+
+    std::vector<RevQuadric> quadrics(vertexCount);
+    for (size_t index = 0; index + 2 < inOutIndices.size(); index += 3)
+    {
+        const UINT* triangle = &inOutIndices[index];
+        XMVECTOR normal = TriangleNormal(positions, triangle[0], triangle[1], triangle[2]);
+        if (XMVectorGetX(XMVector3LengthSq(normal)) <= 0.0f)
+        {
+            continue;
+        }
+        XMFLOAT3 n;
+        XMStoreFloat3(&n, XMVector3Normalize(normal));
+        const XMFLOAT3& p = positions[triangle[0]];
+        const RevQuadric plane = RevQuadric::FromPlane(n.x, n.y, n.z, -(n.x * p.x + n.y * p.y + n.z * p.z));
+        for (UINT corner = 0; corner < 3; corner++)
+        {
+            quadrics[triangle[corner]].Add(plane);
+        }
+    }
+
+    const double maxCost = static_cast<double>(maxError) * maxError;
+    double largestCost = 0.0;
+    std::vector<UINT> adjacencyOffsets;
+    std::vector<UINT> adjacency;
+    std::vector<RevCollapse> collapses;
+    std::vector<bool> touched;
+    while (inOutIndices.size() > targetIndexCount)
+    {
+        const UINT triangleCount = static_cast<UINT>(inOutIndices.size() / 3);
+
+        adjacencyOffsets.assign(vertexCount + 1, 0);
+        for (UINT index : inOutIndices)
+        {
+            adjacencyOffsets[index + 1]++;
+        }
+        for (UINT vertex = 0; vertex < vertexCount; vertex++)
+        {
+            adjacencyOffsets[vertex + 1] += adjacencyOffsets[vertex];
+        }
+        adjacency.resize(inOutIndices.size());
+        std::vector<UINT> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+        for (UINT triangle = 0; triangle < triangleCount; triangle++)
+        {
+            for (UINT corner = 0; corner < 3; corner++)
+            {
+                adjacency[fill[inOutIndices[triangle * 3 + corner]]++] = triangle;
+            }
+        }
+
+        collapses.clear();
+        for (UINT triangle = 0; triangle < triangleCount; triangle++)
+        {
+            for (UINT corner = 0; corner < 3; corner++)
+            {
+                const UINT a = inOutIndices[triangle * 3 + corner];
+                const UINT b = inOutIndices[triangle * 3 + (corner + 1) % 3];
+                // Every interior edge is seen from both triangles, so one direction per triangle covers both.
+                if (!locked[a])
+                {
+                    RevQuadric quadric = quadrics[a];
+                    quadric.Add(quadrics[b]);
+                    collapses.push_back({ a, b, quadric.Evaluate(positions[b]) });
+                }
+            }
+        }
+        std::sort(collapses.begin(), collapses.end(),
+            [](const RevCollapse& left, const RevCollapse& right) { return left.m_cost < right.m_cost; });
+
+        // Collapse the cheapest edges first. A collapse freezes the neighbourhood of its vertex for the rest of
+        // the pass so the flip test always sees the triangles as they will be.
+        touched.assign(vertexCount, false);
+        std::vector<UINT> remap(vertexCount);
+        for (UINT vertex = 0; vertex < vertexCount; vertex++)
+        {
+            remap[vertex] = vertex;
+        }
+        const size_t trianglesToRemove = (inOutIndices.size() - targetIndexCount) / 3;
+        size_t removedTriangles = 0;
+        for (const RevCollapse& collapse : collapses)
+        {
+            if (removedTriangles >= trianglesToRemove || collapse.m_cost > maxCost)
+            {
+                break;
+            }
+            if (touched[collapse.m_from] || touched[collapse.m_to]
+                || CollapseFlipsTriangle(positions, inOutIndices, adjacencyOffsets, adjacency, collapse.m_from, collapse.m_to))
+            {
+                continue;
+            }
+
+            remap[collapse.m_from] = collapse.m_to;
+            quadrics[collapse.m_to].Add(quadrics[collapse.m_from]);
+            largestCost = max(largestCost, collapse.m_cost);
+            for (UINT entry = adjacencyOffsets[collapse.m_from]; entry < adjacencyOffsets[collapse.m_from + 1]; entry++)
+            {
+                const UINT* triangle = &inOutIndices[adjacency[entry] * 3];
+                if (triangle[0] == collapse.m_to || triangle[1] == collapse.m_to || triangle[2] == collapse.m_to)
+                {
+                    removedTriangles++;
+                }
+                touched[triangle[0]] = touched[triangle[1]] = touched[triangle[2]] = true;
+            }
+        }
+        if (removedTriangles == 0)
+        {
+            break;
+        }
+
+        size_t writeIndex = 0;
+        for (size_t index = 0; index + 2 < inOutIndices.size(); index += 3)
+        {
+            const UINT a = remap[inOutIndices[index]];
+            const UINT b = remap[inOutIndices[index + 1]];
+            const UINT c = remap[inOutIndices[index + 2]];
+            if (a != b && b != c && a != c)
+            {
+                inOutIndices[writeIndex++] = a;
+                inOutIndices[writeIndex++] = b;
+                inOutIndices[writeIndex++] = c;
+            }
+        }
+        inOutIndices.resize(writeIndex);
+    }
+
+    return static_cast<float>(sqrt(largestCost));
+}
+
+void RevMeshSimplifier::WeldSubMesh(
+    const RevModelData& modelData,
+    const RevSubMesh& subMesh,
+    std::vector<XMFLOAT3>& outPositions,
+    std::vector<bool>& outLocked,
+    std::vector<UINT>& outIndices)
+{
+    outPositions.clear();
+    outLocked.clear();
+    outIndices.clear();
+    if (subMesh.m_vertexCount == 0)
+    {
+        return;
+    }
+    const RevVertexPosTexNormBiTan* vertexes = modelData.m_vertexStream.Get<RevVertexPosTexNormBiTan>() + subMesh.m_baseVertex;
+    std::vector<UINT> order(subMesh.m_vertexCount);
+    for (UINT vertex = 0; vertex < subMesh.m_vertexCount; vertex++)
+    {
+        order[vertex] = vertex;
+    }
+    std::sort(order.begin(), order.end(), [vertexes](UINT left, UINT right)
+    {
+        return memcmp(&vertexes[left], &vertexes[right], sizeof(RevVertexPosTexNormBiTan)) < 0;
+    });
+    std::vector<UINT> canonical(subMesh.m_vertexCount);
+    outLocked.assign(subMesh.m_vertexCount, false);
+    for (size_t first = 0; first < order.size();)
+    {
+        size_t positionEnd = first + 1;
+        while (positionEnd < order.size()
+            && memcmp(&vertexes[order[first]].m_position, &vertexes[order[positionEnd]].m_position, sizeof(XMFLOAT3)) == 0)
+        {
+            positionEnd++;
+        }
+        // The sort keeps equal positions together with equal vertexes in runs inside them.
+        bool seam = false;
+        for (size_t run = first; run < positionEnd;)
+        {
+            size_t runEnd = run + 1;
+            while (runEnd < positionEnd
+                && memcmp(&vertexes[order[run]], &vertexes[order[runEnd]], sizeof(RevVertexPosTexNormBiTan)) == 0)
+            {
+                runEnd++;
+            }
+            for (size_t entry = run; entry < runEnd; entry++)
+            {
+                canonical[order[entry]] = order[run];
+            }
+            seam = seam || run != first;
+            run = runEnd;
+        }
+        if (seam)
+        {
+            for (size_t entry = first; entry < positionEnd; entry++)
+            {
+                outLocked[order[entry]] = true;
+            }
+        }
+        first = positionEnd;
+    }
+
+    outPositions.resize(subMesh.m_vertexCount);
+    for (UINT vertex = 0; vertex < subMesh.m_vertexCount; vertex++)
+    {
+        outPositions[vertex] = vertexes[vertex].m_position;
+    }
+    outIndices.resize(subMesh.m_indexCount);
+    for (UINT index = 0; index < subMesh.m_indexCount; index++)
+    {
+        outIndices[index] = canonical[modelData.m_indices[subMesh.m_indexOffset + index]];
+    }
+}
+
+void RevMeshSimplifier::BuildLodChain(RevModelData& modelData)
+{
+    modelData.m_lods.clear();
+    modelData.m_lodSubMeshes.clear();
+    if (!modelData.m_vertexStream.Holds<RevVertexPosTexNormBiTan>() || modelData.m_indices.empty() || modelData.m_subMeshes.empty())
+    {
+        return;
+    }
+
+    struct RevSubMeshLodSource
+    {
+        std::vector<XMFLOAT3> m_positions;
+        std::vector<bool> m_locked;
+        std::vector<UINT> m_indices;
+    };
+    std::vector<RevSubMeshLodSource> sources(modelData.m_subMeshes.size());
+    size_t totalIndices = 0;
+    for (size_t subMeshIndex = 0; subMeshIndex < modelData.m_subMeshes.size(); subMeshIndex++)
+    {
+        RevSubMeshLodSource& source = sources[subMeshIndex];
+        WeldSubMesh(modelData, modelData.m_subMeshes[subMeshIndex], source.m_positions, source.m_locked, source.m_indices);
+        totalIndices += source.m_indices.size();
+    }
+
+    RevModelLod baseLod = {};
+    modelData.m_lods.push_back(baseLod);
+    for (UINT level = 1; level < REV_MAX_LODS && totalIndices / 3 > g_lodMinimumTriangles; level++)
+    {
+        // Every level simplifies the previous one, so its distance to level 0 is bounded by the sum of the steps.
+        size_t levelIndices = 0;
+        float stepError = 0.0f;
+        for (RevSubMeshLodSource& source : sources)
+        {
+            const size_t target = static_cast<size_t>(source.m_indices.size() / 3 * g_lodReduction) * 3;
+            const float error = SimplifyTriangles(source.m_positions, source.m_locked, source.m_indices, target, FLT_MAX);
+            stepError = max(stepError, error);
+            levelIndices += source.m_indices.size();
+        }
+        const float levelError = modelData.m_lods.back().m_error + stepError;
+        if (levelIndices > totalIndices * g_lodMinimumGain)
+        {
+            break;
+        }
+
+        RevModelLod lod = {};
+        lod.m_subMeshOffset = static_cast<UINT>(modelData.m_lodSubMeshes.size());
+        lod.m_error = levelError;
+        modelData.m_lods.push_back(lod);
+        for (size_t subMeshIndex = 0; subMeshIndex < sources.size(); subMeshIndex++)
+        {
+            const std::vector<UINT>& indices = sources[subMeshIndex].m_indices;
+            RevSubMesh subMesh = modelData.m_subMeshes[subMeshIndex];
+            subMesh.m_indexOffset = static_cast<UINT>(modelData.m_indices.size());
+            subMesh.m_indexCount = static_cast<UINT>(indices.size());
+            subMesh.m_meshletOffset = 0;
+            subMesh.m_meshletCount = 0;
+            modelData.m_lodSubMeshes.push_back(subMesh);
+            modelData.m_indices.insert(modelData.m_indices.end(), indices.begin(), indices.end());
+        }
+        totalIndices = levelIndices;
+    }
+}
+
+float RevMeshSimplifier::ProjectError(float objectError, float distance, float lodScale)
+{
+    return objectError * lodScale / max(distance, 1e-3f);
+}
@@ -0,0 +1,35 @@
+﻿#pragma once
+#include <vector>
+
+struct RevModelData;
+
+class RevMeshSimplifier
+{
+public:
+
+    /** Appends up to REV_MAX_LODS - 1 simplified levels of every submesh to m_indices and fills m_lods/m_lodSubMeshes.
+     *  Vertexes on UV/normal seams and open borders never move. Run at cook time, before the indices are compacted. */
+    static void BuildLodChain(RevModelData& modelData);
+
+    /** Quadric error half-edge collapse of a triangle list towards targetIndexCount, collapses costing more than
+     *  maxError are skipped and locked vertexes (plus vertexes on open borders) are kept.
+     *  Returns the largest object space error of the performed collapses. */
+    static float SimplifyTriangles(
+        const std::vector<DirectX::XMFLOAT3>& positions,
+        const std::vector<bool>& lockedVertexes,
+        std::vector<UINT>& inOutIndices,
+        size_t targetIndexCount,
+        float maxError);
+
+    /** Gathers the submesh positions and its local indices with identical vertexes welded (the importer does not weld).
+     *  Vertexes sharing a position but not their attributes are UV/normal seams and come back locked. */
+    static void WeldSubMesh(
+        const RevModelData& modelData,
+        const struct RevSubMesh& subMesh,
+        std::vector<DirectX::XMFLOAT3>& outPositions,
+        std::vector<bool>& outLocked,
+        std::vector<UINT>& outIndices);
+
+    /** Object space error in pixels at distance, lodScale as in RevDrawData::m_lodScale. */
+    static float ProjectError(float objectError, float distance, float lodScale);
+};
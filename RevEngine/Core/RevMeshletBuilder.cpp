@@ -0,0 +1,195 @@
+#include "stdafx.h"
+#include "RevMeshletBuilder.h"
+#include "RevCoreDefines.h"
+#include "RevModelConstructionFunctions.h"
+#include "../D3D/RevD3DTypes.h"
+
+namespace
+{
+    // Below this the triangle normals spread over more than ~84 degrees and the cone culls close to nothing.
+    const float g_minimumConeSpread = 0.1f;
+    const float g_minimumTriangleArea = 1e-12f;
+}
+
+void RevMeshletBuilder::BuildMeshlets(RevModelData& modelData)
+{
+    modelData.m_meshlets.clear();
+    modelData.m_meshletVertexes.clear();
+    modelData.m_meshletTriangles.clear();
+    if (!modelData.m_vertexStream.Holds<RevVertexPosTexNormBiTan>() || modelData.m_indices.empty())
+    {
+        return;
+    }
+
+    UINT maxSubMeshVertexes = 0;
+    for (const RevSubMesh& subMesh : modelData.m_subMeshes)
+    {
+        maxSubMeshVertexes = max(maxSubMeshVertexes, subMesh.m_vertexCount);
+    }
+    // Position of a submesh vertex inside the meshlet being built, REV_INDEX_NONE when not added yet.
+    std::vector<int> meshletIndex(maxSubMeshVertexes, REV_INDEX_NONE);
+
+    for (RevSubMesh& subMesh : modelData.m_subMeshes)
+    {
+        subMesh.m_meshletOffset = static_cast<UINT>(modelData.m_meshlets.size());
+
+        RevMeshlet meshlet = {};
+        meshlet.m_vertexOffset = static_cast<UINT>(modelData.m_meshletVertexes.size());
+        meshlet.m_triangleOffset = static_cast<UINT>(modelData.m_meshletTriangles.size() / 3);
+
+        const UINT indexEnd = subMesh.m_indexOffset + subMesh.m_indexCount;
+        for (UINT index = subMesh.m_indexOffset; index + 2 < indexEnd; index += 3)
+        {
+            const UINT triangle[3] = { modelData.m_indices[index], modelData.m_indices[index + 1], modelData.m_indices[index + 2] };
+            UINT newVertexes = 0;
+            for (UINT corner = 0; corner < 3; corner++)
+            {
+                const bool repeated = (corner > 0 && triangle[corner] == triangle[0]) || (corner > 1 && triangle[corner] == triangle[1]);
+                if (!repeated && meshletIndex[triangle[corner]] == REV_INDEX_NONE)
+                {
+                    newVertexes++;
+                }
+            }
+
+            if (meshlet.m_vertexCount + newVertexes > REV_MESHLET_MAX_VERTEXES || meshlet.m_triangleCount == REV_MESHLET_MAX_TRIANGLES)
+            {
+                ComputeMeshletBounds(modelData, subMesh.m_baseVertex, meshlet);
+                modelData.m_meshlets.push_back(meshlet);
+                for (UINT vertex = 0; vertex < meshlet.m_vertexCount; vertex++)
+                {
+                    meshletIndex[modelData.m_meshletVertexes[meshlet.m_vertexOffset + vertex]] = REV_INDEX_NONE;
+                }
+
+                meshlet = {};
+                meshlet.m_vertexOffset = static_cast<UINT>(modelData.m_meshletVertexes.size());
+                meshlet.m_triangleOffset = static_cast<UINT>(modelData.m_meshletTriangles.size() / 3);
+            }
+
+            for (UINT corner = 0; corner < 3; corner++)
+            {
+                int& localIndex = meshletIndex[triangle[corner]];
+                if (localIndex == REV_INDEX_NONE)
+                {
+                    localIndex = static_cast<int>(meshlet.m_vertexCount++);
+                    modelData.m_meshletVertexes.push_back(triangle[corner]);
+                }
+                modelData.m_meshletTriangles.push_back(static_cast<UINT8>(localIndex));
+            }
+            meshlet.m_triangleCount++;
+        }
+
+        if (meshlet.m_triangleCount > 0)
+        {
+            ComputeMeshletBounds(modelData, subMesh.m_baseVertex, meshlet);
+            modelData.m_meshlets.push_back(meshlet);
+            for (UINT vertex = 0; vertex < meshlet.m_vertexCount; vertex++)
+            {
+                meshletIndex[modelData.m_meshletVertexes[meshlet.m_vertexOffset + vertex]] = REV_INDEX_NONE;
+            }
+        }
+        subMesh.m_meshletCount = static_cast<UINT>(modelData.m_meshlets.size()) - subMesh.m_meshletOffset;
+    }
+}
+
+bool RevMeshletBuilder::IsMeshletBackFacing(const RevMeshlet& meshlet, FXMVECTOR viewerPosition)
+{
+    return IsConeBackFacing(meshlet.m_coneApex, meshlet.m_coneAxis, meshlet.m_coneCutoff, viewerPosition);
+}
+
+bool RevMeshletBuilder::IsConeBackFacing(const XMFLOAT3& apex, const XMFLOAT3& axis, float cutoff, FXMVECTOR viewerPosition)
+{
+    if (cutoff >= 1.0f)
+    {
+        return false;
+    }
+    XMVECTOR viewDirection = XMVector3Normalize(XMLoadFloat3(&apex) - viewerPosition);
+    return XMVectorGetX(XMVector3Dot(viewDirection, XMLoadFloat3(&axis))) >= cutoff;
+}
+
+void RevMeshletBuilder::ComputeNormalCone(
+    const std::vector<XMFLOAT3>& positions,
+    const std::vector<UINT>& indices,
+    FXMVECTOR center,
+    XMFLOAT3& outApex,
+    XMFLOAT3& outAxis,
+    float& outCutoff)
+{
+    const UINT triangleCount = static_cast<UINT>(indices.size() / 3);
+    auto triangleNormal = [&](UINT triangle)
+    {
+        XMVECTOR p0 = XMLoadFloat3(&positions[indices[triangle * 3]]);
+        return XMVector3Cross(
+            XMLoadFloat3(&positions[indices[triangle * 3 + 1]]) - p0,
+            XMLoadFloat3(&positions[indices[triangle * 3 + 2]]) - p0);
+    };
+
+    // Degenerate triangles keep a zero normal and are left out of the cone.
+    std::vector<XMVECTOR> normals(triangleCount, XMVectorZero());
+    XMVECTOR normalSum = XMVectorZero();
+    bool hasNormals = false;
+    for (UINT triangle = 0; triangle < triangleCount; triangle++)
+    {
+        XMVECTOR normal = triangleNormal(triangle);
+        if (XMVectorGetX(XMVector3LengthSq(normal)) > g_minimumTriangleArea)
+        {
+            normals[triangle] = XMVector3Normalize(normal);
+            normalSum += normals[triangle];
+            hasNormals = true;
+        }
+    }
+
+    XMStoreFloat3(&outApex, center);
+    outAxis = XMFLOAT3(0.0f, 0.0f, 1.0f);
+    outCutoff = 1.0f;
+    if (!hasNormals || XMVectorGetX(XMVector3LengthSq(normalSum)) <= g_minimumTriangleArea)
+    {
+        return;
+    }
+
+    XMVECTOR axis = XMVector3Normalize(normalSum);
+    float minimumDot = 1.0f;
+    for (UINT triangle = 0; triangle < triangleCount; triangle++)
+    {
+        if (!XMVector3Equal(normals[triangle], XMVectorZero()))
+        {
+            minimumDot = min(minimumDot, XMVectorGetX(XMVector3Dot(normals[triangle], axis)));
+        }
+    }
+    XMStoreFloat3(&outAxis, axis);
+    if (minimumDot <= g_minimumConeSpread)
+    {
+        return;
+    }
+
+    // Move the apex back along the axis until it lies behind every triangle plane.
+    float maxDistance = 0.0f;
+    for (UINT triangle = 0; triangle < triangleCount; triangle++)
+    {
+        if (XMVector3Equal(normals[triangle], XMVectorZero()))
+        {
+            continue;
+        }
+        XMVECTOR p0 = XMLoadFloat3(&positions[indices[triangle * 3]]);
+        const float distance = XMVectorGetX(XMVector3Dot(center - p0, normals[triangle])) / XMVectorGetX(XMVector3Dot(axis, normals[triangle]));
+        maxDistance = max(maxDistance, distance);
+    }
+    XMStoreFloat3(&outApex, center - axis * maxDistance);
+    outCutoff = sqrtf(1.0f - minimumDot * minimumDot);
+}
+
+void RevMeshletBuilder::ComputeMeshletBounds(const RevModelData& modelData, INT baseVertex, RevMeshlet& meshlet)
+{
+    const RevVertexPosTexNormBiTan* vertexes = modelData.m_vertexStream.Get<RevVertexPosTexNormBiTan>() + baseVertex;
+    std::vector<XMFLOAT3> positions(meshlet.m_vertexCount);
+    for (UINT vertex = 0; vertex < meshlet.m_vertexCount; vertex++)
+    {
+        positions[vertex] = vertexes[modelData.m_meshletVertexes[meshlet.m_vertexOffset + vertex]].m_position;
+    }
+    std::vector<UINT> indices(modelData.m_meshletTriangles.begin() + meshlet.m_triangleOffset * 3,
+        modelData.m_meshletTriangles.begin() + (meshlet.m_triangleOffset + meshlet.m_triangleCount) * 3);
+
+    const RevBounds bounds = RevModelConstructionFunctions::ComputeBounds(positions.data(), positions.size(), sizeof(XMFLOAT3));
+    meshlet.m_center = bounds.m_sphereCenter;
+    meshlet.m_radius = bounds.m_sphereRadius;
+    ComputeNormalCone(positions, indices, XMLoadFloat3(&meshlet.m_center), meshlet.m_coneApex, meshlet.m_coneAxis, meshlet.m_coneCutoff);
+}
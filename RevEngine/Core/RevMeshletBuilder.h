@@ -0,0 +1,30 @@
+﻿#pragma once
+#include <vector>
+
+struct RevModelData;
+struct RevMeshlet;
+
+class RevMeshletBuilder
+{
+public:
+
+    /** Partitions every submesh of the full vertexes/m_indices into meshlets with bounding spheres and normal cones.
+     *  Run at cook time, before the indices are compacted and the vertexes packed. */
+    static void BuildMeshlets(RevModelData& modelData);
+
+    /** Whether every triangle of the meshlet faces away from the viewer, both in the meshlet's object space. */
+    static bool IsMeshletBackFacing(const RevMeshlet& meshlet, DirectX::FXMVECTOR viewerPosition);
+    static bool IsConeBackFacing(const DirectX::XMFLOAT3& apex, const DirectX::XMFLOAT3& axis, float cutoff, DirectX::FXMVECTOR viewerPosition);
+
+    /** Normal cone of a triangle list, see RevMeshlet for the meaning of apex, axis and cutoff. */
+    static void ComputeNormalCone(
+        const std::vector<DirectX::XMFLOAT3>& positions,
+        const std::vector<UINT>& indices,
+        DirectX::FXMVECTOR center,
+        DirectX::XMFLOAT3& outApex,
+        DirectX::XMFLOAT3& outAxis,
+        float& outCutoff);
+
+private:
+    static void ComputeMeshletBounds(const RevModelData& modelData, INT baseVertex, RevMeshlet& meshlet);
+};
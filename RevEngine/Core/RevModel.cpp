@@ -1,57 +1,231 @@
 #include "stdafx.h"
 #include "RevModel.h"
+#include <algorithm>
 #include "RevCoreDefines.h"
+#include "RevClusterDagBuilder.h"
 #include "RevEngineRetrievalFunctions.h"
+#include "RevMeshSimplifier.h"
 #include "RevModelConstructionFunctions.h"
 #include "RevModelTypes.h"
 #include "../BottomLevelASGenerator.h"
 #include "../d3dx12.h"
 #include "../Misc/RevTypes.h"
 
-void RevModel::Initialize(const RevModelData& modelData, REV_ID_HANDLE handle)
+void RevModel::Initialize(RevModelData&& modelData, REV_ID_HANDLE handle, RevModel* geometrySource)
 {
-    m_modelData = modelData;
+    m_modelData = std::move(modelData);
     m_handle = handle;
-    m_d3dData = RevModelD3DData::Create(m_modelData);
+    m_geometrySource = geometrySource;
+    m_d3dData = RevModelD3DData::Create(m_modelData, geometrySource ? &geometrySource->m_d3dData : nullptr);
+    RevSkinning::BuildSkinningData(m_modelData, m_skinningData);
 }
 
-void RevModel::DrawRasterized(const RevDrawData& data) const
+namespace
 {
+    /** Clears values and hands its memory back, clear() alone keeps the capacity. */
+    template<typename T>
+    void ReleaseVector(T& values)
+    {
+        T().swap(values);
+    }
+}
+
+void RevModel::SetResidency(RevEGeometryResidency residency)
+{
+    if (residency > m_residency)
+    {
+        // Only geometry is refetched, the GPU buffers and the rest of the model stay as they are.
+        RevModelData modelData = RevModelConstructionFunctions::CreateModelDataType(m_initializationData);
+        m_modelData = std::move(modelData);
+        m_residency = RevEGeometryResidency::All;
+    }
+    if (residency == m_residency)
+    {
+        return;
+    }
+
+    if (residency == RevEGeometryResidency::PositionsAndIndices && m_modelData.m_positions.empty())
+    {
+        RevModelConstructionFunctions::ExtractPositionStream(m_modelData);
+    }
+    m_modelData.m_vertexStream.Release();
+    ReleaseVector(m_modelData.m_clusters);
+    ReleaseVector(m_modelData.m_clusterGroups);
+    ReleaseVector(m_modelData.m_clusterPages);
+    ReleaseVector(m_modelData.m_meshletVertexes);
+    ReleaseVector(m_modelData.m_meshletTriangles);
+    ReleaseVector(m_modelData.m_textures);
+    ReleaseVector(m_modelData.m_shaderPath);
+    if (residency == RevEGeometryResidency::None)
+    {
+        ReleaseVector(m_modelData.m_positions);
+        ReleaseVector(m_modelData.m_indices);
+        ReleaseVector(m_modelData.m_shortIndices);
+    }
+    m_residency = residency;
+}
+
+void RevModel::DrawRasterized(const RevDrawData& data, UINT lod, const D3D12_VERTEX_BUFFER_VIEW* vertexBufferView) const
+{
+    if (!vertexBufferView && !m_d3dData.m_vertexRange)
+    {
+        return;
+    }
+    BindRasterized(data, vertexBufferView);
+    // An explicit view holds only this model's vertexes, the pool buffer holds them from the range start.
+    DrawRanges(lod, vertexBufferView ? 0 : m_d3dData.m_vertexRange->m_first);
+}
+
+void RevModel::DrawClusters(const RevDrawData& data, const std::vector<UINT>& clusters) const
+{
+    if (!m_d3dData.m_indexRange || !m_d3dData.m_vertexRange)
+    {
+        return;
+    }
     ID3D12GraphicsCommandList4* list = RevEngineRetrievalFunctions::GetCommandList();
-    bool drawIndexed = false;
-    if (m_d3dData.m_vertexBuffer.Get())
+    BindRasterized(data, nullptr);
+    const UINT firstIndex = m_d3dData.m_indexRange->m_first;
+    const INT firstVertex = static_cast<INT>(m_d3dData.m_vertexRange->m_first);
+    // Siblings sit next to each other in the index buffer, so a sorted cut collapses into a few draws.
+    for (size_t begin = 0; begin < clusters.size();)
     {
-        list->IASetVertexBuffers(0, 1, &m_d3dData.m_vertexBufferView);
+        const RevCluster& first = m_d3dData.m_clusters[clusters[begin]];
+        UINT indexCount = first.m_indexCount;
+        size_t end = begin + 1;
+        for (; end < clusters.size(); end++)
+        {
+            const RevCluster& next = m_d3dData.m_clusters[clusters[end]];
+            if (next.m_subMesh != first.m_subMesh || next.m_indexOffset != first.m_indexOffset + indexCount)
+            {
+                break;
+            }
+            indexCount += next.m_indexCount;
+        }
+        list->DrawIndexedInstanced(indexCount, 1, firstIndex + first.m_indexOffset,
+            firstVertex + m_d3dData.m_subMeshes[first.m_subMesh].m_baseVertex, 0);
+        begin = end;
     }
-    if (m_d3dData.m_indexBuffer.Get())
+}
+
+void RevModel::SelectClusterCut(const RevDrawData& data, FXMVECTOR viewPosition, std::vector<UINT>& outClusters) const
+{
+    outClusters.clear();
+    RevClusterDagBuilder::SelectCut(
+        m_d3dData.m_clusters, m_d3dData.m_clusterGroups, viewPosition, data.m_lodScale, data.m_lodPixelError, outClusters);
+    std::sort(outClusters.begin(), outClusters.end());
+}
+
+void RevModel::BindRasterized(const RevDrawData& data, const D3D12_VERTEX_BUFFER_VIEW* vertexBufferView) const
+{
+    ID3D12GraphicsCommandList4* list = RevEngineRetrievalFunctions::GetCommandList();
+    if (vertexBufferView)
     {
-        drawIndexed = true;
-        list->IASetIndexBuffer(&m_d3dData.m_indexBufferView);
+        list->IASetVertexBuffers(0, 1, vertexBufferView);
+    }
+    else if (m_d3dData.m_vertexRange)
+    {
+        const D3D12_VERTEX_BUFFER_VIEW poolView = RevGeometryPool::GetVertexBufferView(*m_d3dData.m_vertexRange);
+        list->IASetVertexBuffers(0, 1, &poolView);
+    }
+    if (m_d3dData.m_indexRange)
+    {
+        const D3D12_INDEX_BUFFER_VIEW poolView = RevGeometryPool::GetIndexBufferView(*m_d3dData.m_indexRange, m_d3dData.m_indexFormat);
+        list->IASetIndexBuffer(&poolView);
     }
 
     ID3D12GraphicsCommandList* commandList = RevEngineRetrievalFunctions::GetCommandList();
     commandList->SetPipelineState(m_d3dData.m_pso);
     commandList->SetGraphicsRootSignature(m_d3dData.m_rootSignature.Get());
     commandList->SetGraphicsRootConstantBufferView(
-        0, data.m_cameraCB.Get()->GetGPUVirtualAddress());
+        0, data.m_cameraCB);
+    commandList->SetGraphicsRoot32BitConstants(
+        1, sizeof(RevPositionQuantization) / sizeof(UINT), &m_d3dData.m_positionQuantization, 0);
+}
+
+void RevModel::DrawDepthOnly(const RevDrawData& data, UINT lod) const
+{
+    if (!m_d3dData.m_positionRange || !m_d3dData.m_depthOnlyPso)
+    {
+        return;
+    }
+
+    ID3D12GraphicsCommandList4* list = RevEngineRetrievalFunctions::GetCommandList();
+    const D3D12_VERTEX_BUFFER_VIEW positionView = RevGeometryPool::GetVertexBufferView(*m_d3dData.m_positionRange);
+    list->IASetVertexBuffers(0, 1, &positionView);
+    list->SetPipelineState(m_d3dData.m_depthOnlyPso);
+    list->SetGraphicsRootSignature(m_d3dData.m_rootSignature.Get());
+    list->SetGraphicsRootConstantBufferView(
+        0, data.m_cameraCB);
+
+    if (m_d3dData.m_indexRange)
+    {
+        const D3D12_INDEX_BUFFER_VIEW indexView = RevGeometryPool::GetIndexBufferView(*m_d3dData.m_indexRange, m_d3dData.m_indexFormat);
+        list->IASetIndexBuffer(&indexView);
+    }
+    // The position stream is indexed like the vertexes, only its range start differs.
+    DrawRanges(lod, m_d3dData.m_positionRange->m_first);
+}
 
-    if (m_d3dData.m_descriptorHeap.Get())
+void RevModel::DrawRanges(UINT lod, UINT firstVertex) const
+{
+    ID3D12GraphicsCommandList4* list = RevEngineRetrievalFunctions::GetCommandList();
+    if (!m_d3dData.m_indexRange)
     {
-        ID3D12DescriptorHeap* descriptorHeaps[] = { m_d3dData.m_descriptorHeap.Get() };
-        commandList->SetDescriptorHeaps(_countof(descriptorHeaps), descriptorHeaps);
+        list->DrawInstanced(m_d3dData.m_vertexCount, 1, firstVertex, 0);
+        return;
     }
-    if (drawIndexed)
+    const UINT firstIndex = m_d3dData.m_indexRange->m_first;
+    if (m_d3dData.m_subMeshes.size() > 0)
     {
-        list->DrawIndexedInstanced(m_d3dData.m_indexCount, 1, 0, 0, 0);
+        const RevSubMesh* subMeshes = m_d3dData.GetLodSubMeshes(lod);
+        for (size_t index = 0; index < m_d3dData.m_subMeshes.size(); index++)
+        {
+            const RevSubMesh& subMesh = subMeshes[index];
+            if (subMesh.m_indexCount > 0)
+            {
+                list->DrawIndexedInstanced(subMesh.m_indexCount, 1, firstIndex + subMesh.m_indexOffset,
+                    static_cast<INT>(firstVertex) + subMesh.m_baseVertex, 0);
+            }
+        }
     }
     else
     {
-        list->DrawInstanced(m_d3dData.m_vertexCount, 1, 0, 0);
+        list->DrawIndexedInstanced(m_d3dData.m_indexCount, 1, firstIndex, static_cast<INT>(firstVertex), 0);
     }
 }
 
-AccelerationStructureBuffers RevModel::CreateStructureBuffer()
+UINT RevModel::SelectLod(const RevDrawData& data, float distance) const
 {
-    m_relevantBuffers = RevModelD3DData::CreateAccelerationStructure(m_d3dData);
-    return m_relevantBuffers;
+    if (data.m_lodScale <= 0.0f)
+    {
+        return 0;
+    }
+    // Errors grow with every level, so the first level from the coarse end that is precise enough wins.
+    for (UINT lod = static_cast<UINT>(m_d3dData.m_lods.size()); lod-- > 1;)
+    {
+        if (RevMeshSimplifier::ProjectError(m_d3dData.m_lods[lod].m_error, distance, data.m_lodScale) <= data.m_lodPixelError)
+        {
+            return lod;
+        }
+    }
+    return 0;
+}
+
+const std::vector<AccelerationStructureBuffers>& RevModel::GetStructureBuffers(UINT lod)
+{
+    if (m_geometrySource)
+    {
+        return m_geometrySource->GetStructureBuffers(lod);
+    }
+    if (m_structureBuffers.empty())
+    {
+        m_structureBuffers.resize(m_d3dData.GetNumLods());
+    }
+    lod = min(lod, static_cast<UINT>(m_structureBuffers.size()) - 1);
+    std::vector<AccelerationStructureBuffers>& buffers = m_structureBuffers[lod];
+    if (buffers.empty())
+    {
+        RevModelD3DData::CreateAccelerationStructures(m_d3dData, lod, buffers);
+    }
+    return buffers;
 }
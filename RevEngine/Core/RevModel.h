@@ -1,6 +1,7 @@
 #pragma once
 
 #include "RevCoreDefines.h"
+#include "RevSkinning.h"
 #include "../TopLevelASGenerator.h"
 #include "../D3D/RevD3DTypes.h"
 
@@ -14,16 +15,61 @@ class RevModel
 public:
     RevModel() {};
 
-    void Initialize(const RevModelData& modelData, REV_ID_HANDLE handle);
+    /** geometrySource, when given, is a loaded model with the same geometry hash whose buffers and BLAS are reused. */
+    void Initialize(RevModelData&& modelData, REV_ID_HANDLE handle, RevModel* geometrySource = nullptr);
 
-    void DrawRasterized(const RevDrawData& data) const;
+    /** vertexBufferView replaces the model vertex buffer when given, for CPU skinned vertexes of the same layout. */
+    void DrawRasterized(const RevDrawData& data, UINT lod = 0, const D3D12_VERTEX_BUFFER_VIEW* vertexBufferView = nullptr) const;
+    /** Draws only the position stream with the depth-only pso, does nothing for models without one. */
+    void DrawDepthOnly(const RevDrawData& data, UINT lod = 0) const;
 
-    AccelerationStructureBuffers CreateStructureBuffer();
+    /** Draws the given clusters of the cluster DAG, see SelectClusterCut. Runs of clusters adjacent in the index
+     *  buffer go out as one draw. */
+    void DrawClusters(const RevDrawData& data, const std::vector<UINT>& clusters) const;
+    /** Picks the DAG cut for a viewer at viewPosition in model space, every surface ends up covered once.
+     *  The clusters come out sorted by index. */
+    void SelectClusterCut(const RevDrawData& data, DirectX::FXMVECTOR viewPosition, std::vector<UINT>& outClusters) const;
+    bool HasClusters() const { return m_d3dData.m_clusters.size() > 0; }
+    /** False when the geometry failed to upload, the model then draws and traces nothing. */
+    bool HasGeometry() const { return m_d3dData.m_vertexCount > 0 || m_d3dData.m_indexCount > 0; }
 
-    AccelerationStructureBuffers m_relevantBuffers;
+    /** Coarsest LOD whose error stays below data.m_lodPixelError when seen from distance. */
+    UINT SelectLod(const RevDrawData& data, float distance) const;
+
+    /** Bottom level AS chunks of the lod, each one becomes its own TLAS instance. Only LODs some instance traces
+     *  get built, on their first request, on the current command list. Sharing models use the owner's chunks. */
+    const std::vector<AccelerationStructureBuffers>& GetStructureBuffers(UINT lod);
+
+    /** Clusters built at cook time, ranges per submesh are in RevSubMesh::m_meshletOffset/m_meshletCount.
+     *  Empty unless the model was loaded with RevModelInitializationData::m_meshlets. */
+    const std::vector<RevMeshlet>& GetMeshlets() const { return m_modelData.m_meshlets; }
+    /** Object space bounds computed at cook time, per submesh bounds are in RevSubMesh::m_bounds. */
+    const RevBounds& GetBounds() const { return m_modelData.m_bounds; }
+
+    /** Releases CPU side geometry down to residency, or fetches it again from the cooked file (or the
+     *  construction functions for built in types) when residency asks for more than is resident. */
+    void SetResidency(RevEGeometryResidency residency);
+    RevEGeometryResidency GetResidency() const { return m_residency; }
+    /** CPU side data, only holds what GetResidency() keeps. */
+    const RevModelData& GetModelData() const { return m_modelData; }
+
+    // Bottom level AS chunks per LOD, empty until the LOD is first traced.
+    std::vector<std::vector<AccelerationStructureBuffers>> m_structureBuffers;
     RevModelD3DData m_d3dData;
     RevModelData m_modelData;
+    RevModelInitializationData m_initializationData;
+    // Bind pose the instances of animated models are skinned from, invalid for other models.
+    RevSkinningData m_skinningData;
 
     RevEModelType m_type;
     REV_ID_HANDLE m_handle = REV_INDEX_NONE;
+    // Model owning the shared geometry, nullptr when this model owns its own.
+    RevModel* m_geometrySource = nullptr;
+    RevEGeometryResidency m_residency = RevEGeometryResidency::All;
+
+private:
+    /** Sets the buffers, pso and root arguments shared by every raster draw of the model. */
+    void BindRasterized(const RevDrawData& data, const D3D12_VERTEX_BUFFER_VIEW* vertexBufferView) const;
+    /** Draws every submesh range of the lod, firstVertex is where the bound vertex stream of the model starts. */
+    void DrawRanges(UINT lod, UINT firstVertex) const;
 };
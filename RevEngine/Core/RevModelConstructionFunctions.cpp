@@ -17,7 +17,7 @@ RevModelData RevModelConstructionFunctions::CreateModelDataType(RevModelInitiali
     else
     if(inData.m_type == RevEModelType::ModelStatic)
     {
-        return RevModelLoader::CreateModelDataFromFile(inData.m_path.c_str());
+        return RevModelLoader::CreateModelDataFromFile(inData);
     }
     return RevModelData();
 }
@@ -26,20 +26,17 @@ RevModelData RevModelConstructionFunctions::CreateTriangleData()
 {
     RevModelData returnData = {};
     returnData.m_type = RevEModelType::Triangle;
-    returnData.m_vertexes = {
+    returnData.m_vertexStream.Assign<RevVertexPosCol>({
         {{sqrtf(8.f / 9.f), 0.f, -1.f / 3.f}, {1.f, 0.f, 0.f, 1.f}},
         {{-sqrtf(2.f / 9.f), sqrtf(2.f / 3.f), -1.f / 3.f}, {0.f, 1.f, 0.f, 1.f}},
         {{-sqrtf(2.f / 9.f), -sqrtf(2.f / 3.f), -1.f / 3.f}, {0.f, 0.f, 1.f, 1.f}},
-        {{0.f, 0.f, 1.f}, {1, 0, 1, 1}}};
+        {{0.f, 0.f, 1.f}, {1, 0, 1, 1}}});
 
     {
         returnData.m_indices = {0, 1, 2, 0, 3, 1, 0, 2, 3, 1, 3, 2};
+        CompactIndices(returnData);
     }
-    returnData.m_inputLayout =
-    {
-        { "POSITION", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-{ "COLOR", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-};
+    ComputeBounds(returnData);
     returnData.m_shaderPath = L"Data//Shaders//Shaders.hlsl";
     return returnData;
 }
@@ -48,19 +45,197 @@ RevModelData RevModelConstructionFunctions::CreatePlaneData()
 {
     RevModelData returnData = {};
     returnData.m_type = RevEModelType::Plane;
-    returnData.m_vertexes = {
+    returnData.m_vertexStream.Assign<RevVertexPosCol>({
         {{-1.5f, -.8f, 1.5f}, {1.0f, 1.0f, 1.0f, 1.0f}}, // 0
         {{-1.5f, -.8f, -1.5f}, {1.0f, 1.0f, 1.0f, 1.0f}}, // 1
         {{1.5f, -.8f, 1.5f}, {1.0f, 1.0f, 1.0f, 1.0f}}, // 2
         {{1.5f, -.8f, 1.5f}, {1.0f, 1.0f, 1.0f, 1.0f}}, // 2
         {{-1.5f, -.8f, -1.5f}, {1.0f, 1.0f, 1.0f, 1.0f}}, // 1
         {{1.5f, -.8f, -1.5f}, {1.0f, 1.0f, 1.0f, 1.0f}}  // 4
-    };
+    });
+    ComputeBounds(returnData);
     returnData.m_shaderPath = L"Data//Shaders//Shaders.hlsl";
-    returnData.m_inputLayout =
-    {
-        { "POSITION", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-{ "COLOR", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-};
     return returnData;
 }
+
+void RevModelConstructionFunctions::CompactIndices(RevModelData& modelData)
+{
+    if (modelData.m_indices.empty())
+    {
+        return;
+    }
+    const UINT maxShortVertexes = static_cast<UINT>(UINT16_MAX) + 1;
+    if (modelData.m_subMeshes.size() > 0)
+    {
+        for (const RevSubMesh& subMesh : modelData.m_subMeshes)
+        {
+            if (subMesh.m_vertexCount >= maxShortVertexes)
+            {
+                return;
+            }
+        }
+    }
+    else if (modelData.GetNumVertexes() >= maxShortVertexes)
+    {
+        return;
+    }
+
+    modelData.m_shortIndices.resize(modelData.m_indices.size());
+    for (size_t index = 0; index < modelData.m_indices.size(); index++)
+    {
+        assert(modelData.m_indices[index] <= UINT16_MAX);
+        modelData.m_shortIndices[index] = static_cast<UINT16>(modelData.m_indices[index]);
+    }
+    RevGeometryVector<UINT>().swap(modelData.m_indices);
+}
+
+void RevModelConstructionFunctions::ExtractPositionStream(RevModelData& modelData)
+{
+    const UINT numVertexes = modelData.GetNumVertexes();
+    const UINT stride = modelData.GetVertexStride();
+    modelData.m_positions.resize(numVertexes);
+    if (const RevVertexPosTexNormTanPacked* packedVertexes = modelData.m_vertexStream.Get<RevVertexPosTexNormTanPacked>())
+    {
+        XMVECTOR center = XMLoadFloat3(&modelData.m_positionQuantization.m_center);
+        XMVECTOR extent = XMLoadFloat3(&modelData.m_positionQuantization.m_extent);
+        for (UINT index = 0; index < numVertexes; index++)
+        {
+            XMVECTOR packed = DirectX::PackedVector::XMLoadShortN4(&packedVertexes[index].m_position);
+            XMStoreFloat3(&modelData.m_positions[index], XMVectorMultiplyAdd(packed, extent, center));
+        }
+    }
+    else if (const XMFLOAT3* positions = modelData.m_vertexStream.GetFloatPositions())
+    {
+        const UINT8* first = reinterpret_cast<const UINT8*>(positions);
+        for (UINT index = 0; index < numVertexes; index++)
+        {
+            modelData.m_positions[index] = *reinterpret_cast<const XMFLOAT3*>(first + static_cast<size_t>(index) * stride);
+        }
+    }
+}
+
+void RevModelConstructionFunctions::ComputeBounds(RevModelData& modelData)
+{
+    // Runs before packing, quantized positions have no float3 to read.
+    const XMFLOAT3* positions = modelData.m_vertexStream.GetFloatPositions();
+    const size_t stride = modelData.GetVertexStride();
+    if (!positions)
+    {
+        return;
+    }
+
+    const size_t numVertexes = modelData.GetNumVertexes();
+    modelData.m_bounds = ComputeBounds(positions, numVertexes, stride);
+    for (RevSubMesh& subMesh : modelData.m_subMeshes)
+    {
+        const UINT8* first = reinterpret_cast<const UINT8*>(positions) + static_cast<size_t>(subMesh.m_baseVertex) * stride;
+        subMesh.m_bounds = ComputeBounds(reinterpret_cast<const XMFLOAT3*>(first), subMesh.m_vertexCount, stride);
+    }
+}
+
+RevBounds RevModelConstructionFunctions::ComputeBounds(const XMFLOAT3* positions, size_t count, size_t stride)
+{
+    RevBounds bounds = {};
+    if (count == 0)
+    {
+        return bounds;
+    }
+    const UINT8* base = reinterpret_cast<const UINT8*>(positions);
+    auto load = [base, stride](size_t index)
+    {
+        return XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(base + index * stride));
+    };
+
+    // Four independent accumulators so consecutive min/max operations do not wait on each other.
+    XMVECTOR boundsMin[4] = { g_XMFltMax, g_XMFltMax, g_XMFltMax, g_XMFltMax };
+    XMVECTOR boundsMax[4] = { -g_XMFltMax, -g_XMFltMax, -g_XMFltMax, -g_XMFltMax };
+    size_t index = 0;
+    for (; index + 4 <= count; index += 4)
+    {
+        for (size_t lane = 0; lane < 4; lane++)
+        {
+            XMVECTOR position = load(index + lane);
+            boundsMin[lane] = XMVectorMin(boundsMin[lane], position);
+            boundsMax[lane] = XMVectorMax(boundsMax[lane], position);
+        }
+    }
+    for (; index < count; index++)
+    {
+        XMVECTOR position = load(index);
+        boundsMin[0] = XMVectorMin(boundsMin[0], position);
+        boundsMax[0] = XMVectorMax(boundsMax[0], position);
+    }
+    XMVECTOR totalMin = XMVectorMin(XMVectorMin(boundsMin[0], boundsMin[1]), XMVectorMin(boundsMin[2], boundsMin[3]));
+    XMVECTOR totalMax = XMVectorMax(XMVectorMax(boundsMax[0], boundsMax[1]), XMVectorMax(boundsMax[2], boundsMax[3]));
+    XMVECTOR center = (totalMin + totalMax) * 0.5f;
+
+    XMVECTOR radiusSquared[4] = { XMVectorZero(), XMVectorZero(), XMVectorZero(), XMVectorZero() };
+    for (index = 0; index + 4 <= count; index += 4)
+    {
+        for (size_t lane = 0; lane < 4; lane++)
+        {
+            radiusSquared[lane] = XMVectorMax(radiusSquared[lane], XMVector3LengthSq(load(index + lane) - center));
+        }
+    }
+    for (; index < count; index++)
+    {
+        radiusSquared[0] = XMVectorMax(radiusSquared[0], XMVector3LengthSq(load(index) - center));
+    }
+    XMVECTOR totalRadiusSquared = XMVectorMax(XMVectorMax(radiusSquared[0], radiusSquared[1]), XMVectorMax(radiusSquared[2], radiusSquared[3]));
+
+    XMStoreFloat3(&bounds.m_min, totalMin);
+    XMStoreFloat3(&bounds.m_max, totalMax);
+    XMStoreFloat3(&bounds.m_sphereCenter, center);
+    bounds.m_sphereRadius = XMVectorGetX(XMVectorSqrt(totalRadiusSquared));
+    return bounds;
+}
+
+namespace
+{
+    // 64 bit FNV-1a.
+    const UINT64 g_hashOffsetBasis = 14695981039346656037ull;
+    const UINT64 g_hashPrime = 1099511628211ull;
+
+    UINT64 HashBytes(UINT64 hash, const void* data, size_t size)
+    {
+        const UINT8* bytes = static_cast<const UINT8*>(data);
+        for (size_t index = 0; index < size; index++)
+        {
+            hash = (hash ^ bytes[index]) * g_hashPrime;
+        }
+        return hash;
+    }
+}
+
+UINT64 RevModelConstructionFunctions::ComputeGeometryHash(const RevModelData& modelData)
+{
+    const RevVertexPosTexNormBiTan* staticVertexes = modelData.m_vertexStream.Get<RevVertexPosTexNormBiTan>();
+    if (!staticVertexes || modelData.m_subMeshes.empty())
+    {
+        return 0;
+    }
+
+    UINT64 hash = g_hashOffsetBasis;
+    for (const RevSubMesh& subMesh : modelData.m_subMeshes)
+    {
+        hash = HashBytes(hash, &subMesh.m_vertexCount, sizeof(subMesh.m_vertexCount));
+        hash = HashBytes(hash, &subMesh.m_indexCount, sizeof(subMesh.m_indexCount));
+        hash = HashBytes(hash, staticVertexes + subMesh.m_baseVertex, subMesh.m_vertexCount * sizeof(RevVertexPosTexNormBiTan));
+        hash = HashBytes(hash, modelData.m_indices.data() + subMesh.m_indexOffset, subMesh.m_indexCount * sizeof(UINT));
+    }
+    // 0 marks models without a hash.
+    return hash != 0 ? hash : 1;
+}
+
+bool RevModelConstructionFunctions::IsSameGeometry(const RevModelData& left, const RevModelData& right)
+{
+    const UINT64 vertexSize = left.GetModelVertexSize();
+    const UINT64 indexSize = left.GetModelIndexSize();
+    if (vertexSize == 0 || vertexSize != right.GetModelVertexSize() || indexSize != right.GetModelIndexSize()
+        || left.GetIndexStride() != right.GetIndexStride())
+    {
+        return false;
+    }
+    return memcmp(left.GetData(), right.GetData(), static_cast<size_t>(vertexSize)) == 0
+        && (indexSize == 0 || memcmp(left.GetIndexData(), right.GetIndexData(), static_cast<size_t>(indexSize)) == 0);
+}
@@ -8,6 +8,24 @@ public:
     static RevModelData CreateModelDataType(RevModelInitializationData inData);
     static RevModelData CreateTriangleData();
     static RevModelData CreatePlaneData();
+
+    /** Moves the indices to 16-bit storage when every submesh (or the whole model) has less than 65536 vertexes. */
+    static void CompactIndices(RevModelData& modelData);
+
+    /** Fills m_bounds of the model and its submeshes from the full precision vertexes, run before packing. */
+    static void ComputeBounds(RevModelData& modelData);
+    /** Hash of the imported vertex and index bytes of every submesh, models only share geometry when their buffers are
+     *  identical anyway. Run at cook time on the imported full precision data. */
+    static UINT64 ComputeGeometryHash(const RevModelData& modelData);
+    /** Whether both models hold byte identical vertex streams and indices, in whatever format the models are in.
+     *  Needs the vertex streams and indices of both resident. */
+    static bool IsSameGeometry(const RevModelData& left, const RevModelData& right);
+
+    /** Bounds of count positions laid out stride bytes apart. */
+    static RevBounds ComputeBounds(const DirectX::XMFLOAT3* positions, size_t count, size_t stride);
+
+    /** Fills m_positions with the positions as the raster path sees them (dequantized for packed vertexes). */
+    static void ExtractPositionStream(RevModelData& modelData);
     
 };
 
@@ -2,28 +2,74 @@
 #include "RevModelManager.h"
 #include "RevCoreDefines.h"
 #include "RevEngineRetrievalFunctions.h"
+#include "RevLoadStatistics.h"
 #include "RevModel.h"
 #include "RevModelConstructionFunctions.h"
 
+namespace
+{
+    bool IsSameBounds(const RevBounds& left, const RevBounds& right)
+    {
+        return memcmp(&left, &right, sizeof(RevBounds)) == 0;
+    }
+
+    /** Counts, submesh layout and bounds of the geometry model uploaded against modelData, all kept whatever the
+     *  residency of model. */
+    bool HasSameLayout(const RevModel& model, const RevModelData& modelData)
+    {
+        const RevModelD3DData& d3dData = model.m_d3dData;
+        const std::vector<RevSubMesh>& subMeshes = model.m_modelData.m_subMeshes;
+        if (d3dData.m_vertexCount != modelData.GetNumVertexes()
+            || d3dData.m_vertexStride != modelData.GetVertexStride()
+            || d3dData.m_indexCount != modelData.GetNumIndices()
+            || d3dData.m_indexStride != modelData.GetIndexStride()
+            || subMeshes.size() != modelData.m_subMeshes.size()
+            || !IsSameBounds(model.m_modelData.m_bounds, modelData.m_bounds))
+        {
+            return false;
+        }
+        for (size_t index = 0; index < subMeshes.size(); index++)
+        {
+            const RevSubMesh& left = subMeshes[index];
+            const RevSubMesh& right = modelData.m_subMeshes[index];
+            if (left.m_indexOffset != right.m_indexOffset || left.m_indexCount != right.m_indexCount
+                || left.m_baseVertex != right.m_baseVertex || left.m_vertexCount != right.m_vertexCount
+                || !IsSameBounds(left.m_bounds, right.m_bounds))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
 RevModelManager* GetModelManagerInternal()
 {
     return RevEngineRetrievalFunctions::GetModelManager();
 }
 
-RevModel* RevModelManager::FindModel(RevModelInitializationData desiredType, bool loadIfNotFound /*= true*/)
+RevModelManager::RevModelManager()
+{
+}
+
+RevModelManager::~RevModelManager()
+{
+}
+
+RevModel* RevModelManager::FindModel(const RevModelInitializationData& desiredType, bool loadIfNotFound /*= true*/)
 {
     RevModelManager* modelManager = GetModelManagerInternal();
     if (!modelManager)
     {
         return nullptr;
     }
-    if (RevModel* model = modelManager->FindModelTypeInternal(desiredType.m_type))
+    if (RevModel* model = modelManager->FindModelInternal(desiredType))
     {
         return model;
     }
     if (loadIfNotFound)
     {
-        return modelManager->CreateModelInternal(desiredType.m_type);
+        return modelManager->CreateModelInternal(desiredType);
     }
     return nullptr;
 }
@@ -37,7 +83,7 @@ RevModel* RevModelManager::FindModelFromHandle(REV_ID_HANDLE handle)
     return modelManager->FindModelHandleInternal(handle);
 }
 
-REV_ID_HANDLE RevModelManager::FindModelHandleFromType(RevModelInitializationData desiredType, bool loadIfNotFound)
+REV_ID_HANDLE RevModelManager::FindModelHandleFromType(const RevModelInitializationData& desiredType, bool loadIfNotFound)
 {
     RevModelManager* modelManager = GetModelManagerInternal();
     if (!modelManager)
@@ -45,7 +91,7 @@ REV_ID_HANDLE RevModelManager::FindModelHandleFromType(RevModelInitializationDat
         return REV_ID_NONE;
     }
 
-    if (RevModel* model = modelManager->FindModelTypeInternal(desiredType.m_type))
+    if (RevModel* model = modelManager->FindModelInternal(desiredType))
     {
         return model->m_handle;
     }
@@ -57,35 +103,36 @@ REV_ID_HANDLE RevModelManager::FindModelHandleFromType(RevModelInitializationDat
     return REV_ID_NONE;
 }
 
-RevModel* RevModelManager::CreateModelInternal(RevModelInitializationData inData)
+RevModel* RevModelManager::CreateModelInternal(const RevModelInitializationData& inData)
 {
-    RevModel* model = new RevModel();
+    RevModel* model = m_modelPool.Create();
     m_modelCounter++;
-    model->Initialize(RevModelConstructionFunctions::CreateModelDataType(inData), m_modelCounter);
+    model->m_initializationData = inData;
+    // The model data is moved into the model, its geometry is only copied once more into the staging window.
+    RevModelData modelData = RevModelConstructionFunctions::CreateModelDataType(inData);
+    RevModel* geometrySource = FindGeometrySourceInternal(modelData, inData);
+#if defined(_DEBUG)
+    const RevLoadStatistics::Snapshot statisticsBefore = RevLoadStatistics::Get();
+    const UINT64 expectedCopyBytes = geometrySource ? 0 :
+        modelData.GetModelVertexSize() + modelData.GetModelIndexSize() + modelData.m_positions.size() * sizeof(XMFLOAT3);
+#endif
+    model->Initialize(std::move(modelData), m_modelCounter, geometrySource);
+#if defined(_DEBUG)
+    // A model whose geometry failed to upload may have copied some of its streams before the failure.
+    assert(!model->HasGeometry() ||
+        RevLoadStatistics::Get().m_copiedBytes - statisticsBefore.m_copiedBytes == expectedCopyBytes);
+#endif
+    model->SetResidency(inData.m_residency);
     m_models.push_back(model);
     return model;
 }
 
-void RevModelManager::GenerateAccelerationBuffersAllModels()
-{
-    RevModelManager* modelManager = GetModelManagerInternal();
-    if (!modelManager)
-    {
-        return;
-    }
-    for (int index = 0; index < modelManager->m_models.size(); index++)
-    {
-        assert(modelManager->m_models[index]);
-        modelManager->m_models[index]->CreateStructureBuffer();
-    }
-}
-
-RevModel* RevModelManager::FindModelTypeInternal(RevEModelType desiredType)
+RevModel* RevModelManager::FindModelInternal(const RevModelInitializationData& desiredType)
 {
     for (int index = 0; index < m_models.size(); index++)
     {
         assert(m_models[index]);
-        if (m_models[index]->m_modelData.m_type == desiredType)
+        if (m_models[index]->m_initializationData.IsSameModel(desiredType))
         {
             return m_models[index];
         }
@@ -104,3 +151,40 @@ RevModel* RevModelManager::FindModelHandleInternal(REV_ID_HANDLE handle)
     }
     return nullptr;
 }
+
+RevModel* RevModelManager::FindGeometrySourceInternal(const RevModelData& modelData, const RevModelInitializationData& inData)
+{
+    if (modelData.m_geometryHash == 0)
+    {
+        return nullptr;
+    }
+    for (int index = 0; index < m_models.size(); index++)
+    {
+        RevModel* model = m_models[index];
+        assert(model);
+        // Sharing models point at the owner, so only owners with geometry are candidates. Vertex layout and
+        // the position stream have to match too, the hash only covers the imported geometry.
+        if (model->m_geometrySource
+            || !model->HasGeometry()
+            || model->m_modelData.m_geometryHash != modelData.m_geometryHash
+            || model->m_modelData.m_vertexFormat != modelData.m_vertexFormat
+            || model->m_initializationData.m_positionStream != inData.m_positionStream)
+        {
+            continue;
+        }
+        // A hash collision would draw another mesh and borrow its LODs and clusters, so the geometry has to agree as
+        // well. The streams are compared when the owner still holds them, its residency may have released them.
+        if (!HasSameLayout(*model, modelData))
+        {
+            continue;
+        }
+        const RevModelData& sourceData = model->m_modelData;
+        if (sourceData.m_vertexStream.GetSize() > 0 && sourceData.GetNumIndices() > 0
+            && !RevModelConstructionFunctions::IsSameGeometry(sourceData, modelData))
+        {
+            continue;
+        }
+        return model;
+    }
+    return nullptr;
+}
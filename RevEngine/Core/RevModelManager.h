@@ -3,6 +3,7 @@
 #include "RevCoreDefines.h"
 #include "RevEngineManager.h"
 #include "RevModelTypes.h"
+#include "RevSlabPool.h"
 
 enum RevEModelType : UINT8;
 class RevModel;
@@ -10,23 +11,26 @@ class RevModel;
 class RevModelManager : public RevEngineManager
 {
 public:
-    RevModelManager() {};
+    // Out of line, destroying the model pool needs the complete RevModel.
+    RevModelManager();
+    ~RevModelManager() override;
 
     /** Finds a model (or tries loading it if desired). */
-    static RevModel* FindModel(RevModelInitializationData desiredType, bool loadIfNotFound = true);
+    static RevModel* FindModel(const RevModelInitializationData& desiredType, bool loadIfNotFound = true);
     static RevModel* FindModelFromHandle(REV_ID_HANDLE handle);
-    static REV_ID_HANDLE FindModelHandleFromType(RevModelInitializationData desiredType, bool loadIfNotFound = true);
-
-    /** Generates all SBT models. */
-    static void GenerateAccelerationBuffersAllModels();
+    static REV_ID_HANDLE FindModelHandleFromType(const RevModelInitializationData& desiredType, bool loadIfNotFound = true);
 
 private:
 
-    RevModel* CreateModelInternal(RevModelInitializationData inData);
+    RevModel* CreateModelInternal(const RevModelInitializationData& inData);
 
-    RevModel* FindModelTypeInternal(RevEModelType desiredType);
+    RevModel* FindModelInternal(const RevModelInitializationData& desiredType);
     RevModel* FindModelHandleInternal(REV_ID_HANDLE handle);
+    /** Loaded model owning geometry identical to modelData that a model created from inData can share. */
+    RevModel* FindGeometrySourceInternal(const RevModelData& modelData, const RevModelInitializationData& inData);
 
+    // Storage of the models, m_models keeps them in load order.
+    RevSlabPool<RevModel> m_modelPool{ RevEMemoryTag::Models };
     std::vector<RevModel*> m_models;
     REV_ID_HANDLE m_modelCounter = 0;
 };
@@ -1,5 +1,6 @@
 ﻿#pragma once
 #include <string>
+#include <DirectXPackedVector.h>
 
 struct RevVertexPosCol
 {
@@ -16,6 +17,133 @@ struct RevVertexPosTexNormBiTan
     DirectX::XMFLOAT3 m_tangent;
 };
 
+/** Compact version of RevVertexPosTexNormBiTan (20 bytes instead of 56).
+ *  Position is quantized against the mesh bounds (see RevPositionQuantization), normal and tangent
+ *  are octahedral encoded and the sign of the reconstructed binormal is stored in m_position.w. */
+struct RevVertexPosTexNormTanPacked
+{
+    DirectX::PackedVector::XMSHORTN4 m_position;
+    DirectX::PackedVector::XMHALF2 m_tex;
+    DirectX::PackedVector::XMSHORTN2 m_normal;
+    DirectX::PackedVector::XMSHORTN2 m_tangent;
+};
+
+/** Dequantization parameters for packed positions, position = center + packed * extent.
+ *  Laid out to match the b1 constants in StaticModel.hlsl. */
+struct RevPositionQuantization
+{
+    DirectX::XMFLOAT3 m_center = { 0.0f, 0.0f, 0.0f };
+    float m_padding0 = 0.0f;
+    DirectX::XMFLOAT3 m_extent = { 1.0f, 1.0f, 1.0f };
+    float m_padding1 = 0.0f;
+};
+
+/** Object space bounds, an AABB and a sphere around its center. */
+struct RevBounds
+{
+    DirectX::XMFLOAT3 m_min = { 0.0f, 0.0f, 0.0f };
+    DirectX::XMFLOAT3 m_max = { 0.0f, 0.0f, 0.0f };
+    DirectX::XMFLOAT3 m_sphereCenter = { 0.0f, 0.0f, 0.0f };
+    float m_sphereRadius = 0.0f;
+};
+
+/** Range of the model index buffer drawn with its own base vertex, indices are local to the submesh
+ *  so they stay 16-bit friendly as long as the submesh itself has less than 65536 vertexes. */
+struct RevSubMesh
+{
+    UINT m_indexOffset = 0;
+    UINT m_indexCount = 0;
+    INT m_baseVertex = 0;
+    UINT m_vertexCount = 0;
+    UINT m_meshletOffset = 0;
+    UINT m_meshletCount = 0;
+    RevBounds m_bounds;
+};
+
+/** Cluster of at most REV_MESHLET_MAX_VERTEXES vertexes and REV_MESHLET_MAX_TRIANGLES triangles of a submesh.
+ *  The vertex range indexes RevModelData::m_meshletVertexes (submesh local vertex indices) and every triangle
+ *  is three bytes in RevModelData::m_meshletTriangles indexing the meshlet vertexes.
+ *  The cone is the normal cone of the triangles, the meshlet is entirely back facing for a viewer when
+ *  dot(normalize(m_coneApex - viewer), m_coneAxis) >= m_coneCutoff. A cutoff of 1 or more disables the test. */
+struct RevMeshlet
+{
+    UINT m_vertexOffset = 0;
+    UINT m_vertexCount = 0;
+    UINT m_triangleOffset = 0;
+    UINT m_triangleCount = 0;
+    DirectX::XMFLOAT3 m_center = { 0.0f, 0.0f, 0.0f };
+    float m_radius = 0.0f;
+    DirectX::XMFLOAT3 m_coneApex = { 0.0f, 0.0f, 0.0f };
+    float m_coneCutoff = 1.0f;
+    DirectX::XMFLOAT3 m_coneAxis = { 0.0f, 0.0f, 1.0f };
+};
+
+/** Level of a model LOD chain, all levels share the vertex buffer. Level 0 draws RevModelData::m_subMeshes,
+ *  coarser levels draw m_subMeshes.size() ranges starting at m_subMeshOffset in m_lodSubMeshes.
+ *  m_error is the object space error of the level against level 0, see RevMeshSimplifier::ProjectError. */
+struct RevModelLod
+{
+    UINT m_subMeshOffset = 0;
+    float m_error = 0.0f;
+};
+
+/** Node of the cluster LOD DAG, its indices are a range of RevModelData::m_indices relative to the base vertex
+ *  of m_subMesh. A cluster is drawn when its own error is small enough and the error of the simplified group
+ *  replacing it (m_parentError) is not. Both are measured at group spheres, so the test is monotonic through the
+ *  DAG and every surface is covered exactly once. Roots have a parent error of FLT_MAX. */
+struct RevCluster
+{
+    UINT m_indexOffset = 0;
+    UINT m_indexCount = 0;
+    UINT m_subMesh = 0;
+    UINT m_level = 0;
+    DirectX::XMFLOAT4 m_bounds = { 0.0f, 0.0f, 0.0f, 0.0f };
+    DirectX::XMFLOAT4 m_parentBounds = { 0.0f, 0.0f, 0.0f, 0.0f };
+    float m_error = 0.0f;
+    float m_parentError = 0.0f;
+    // Normal cone of the cluster triangles, see RevMeshlet.
+    DirectX::XMFLOAT3 m_coneApex = { 0.0f, 0.0f, 0.0f };
+    float m_coneCutoff = 1.0f;
+    DirectX::XMFLOAT3 m_coneAxis = { 0.0f, 0.0f, 1.0f };
+    // RevClusterGroup this cluster was simplified from, UINT_MAX at level 0. Only the first cluster split
+    // from a group points at it, so the cut traversal visits every group once.
+    UINT m_childGroup = UINT_MAX;
+};
+
+/** Clusters grouped and simplified together, a contiguous range of RevModelData::m_clusters. Group 0 holds the
+ *  roots of the DAG, the cut traversal starts there and only descends into groups whose error is too large. */
+struct RevClusterGroup
+{
+    UINT m_clusterOffset = 0;
+    UINT m_clusterCount = 0;
+};
+
+/** Streaming unit of the cluster DAG, its clusters and their indices are contiguous. Pages are ordered
+ *  coarsest level first so the head of the data is always enough to draw the model. */
+struct RevClusterPage
+{
+    UINT m_clusterOffset = 0;
+    UINT m_clusterCount = 0;
+    UINT m_indexOffset = 0;
+    UINT m_indexCount = 0;
+};
+
+enum class RevEVertexFormat : UINT8
+{
+    Full,
+    Packed
+};
+
+/** How much of RevModelData a model keeps in system memory once its geometry is on the GPU, ordered from least to most. */
+enum class RevEGeometryResidency : UINT8
+{
+    // Only bounds, submesh ranges and other small metadata. Animation data is always kept.
+    None,
+    // The float3 position stream and the indices, enough for CPU picking and collision.
+    PositionsAndIndices,
+    All
+};
+
 
 enum RevEModelType : UINT8
 {
@@ -33,10 +161,12 @@ struct RevModelInitializationData
         m_type = RevEModelType::Invalid;
     }
 
-    RevModelInitializationData(std::wstring path)
+    RevModelInitializationData(std::wstring path, RevEVertexFormat vertexFormat = RevEVertexFormat::Full, bool positionStream = false)
     {
         m_type = ModelStatic;
         m_path = path;
+        m_vertexFormat = vertexFormat;
+        m_positionStream = positionStream;
     }
     RevModelInitializationData(RevEModelType type)
     {
@@ -44,6 +174,24 @@ struct RevModelInitializationData
         m_path = L"";
     }
     
+    bool IsSameModel(const RevModelInitializationData& other) const
+    {
+        return m_type == other.m_type && m_vertexFormat == other.m_vertexFormat && m_path == other.m_path
+            && m_clusterDag == other.m_clusterDag && m_meshlets == other.m_meshlets;
+    }
+    
     std::wstring m_path;
     RevEModelType m_type;
+    RevEVertexFormat m_vertexFormat = RevEVertexFormat::Full;
+    // Keeps a tightly packed float3 position stream next to the vertexes for depth-only passes (see
+    // RevScene::DrawSceneDepthOnly). Without it the BLAS reads the positions straight from the vertexes.
+    bool m_positionStream = false;
+    // Cooks a cluster LOD DAG and draws the cut picked per instance instead of the discrete LOD chain. Static
+    // models only, it pays off for large meshes seen at very different distances.
+    bool m_clusterDag = false;
+    // Cooks meshlets for a mesh shader path (see RevModel::GetMeshlets). Nothing draws them yet, so they cost cook
+    // time and file size only for models asking for them. Static models only.
+    bool m_meshlets = false;
+    // CPU side geometry kept after the upload. Not part of IsSameModel, the first load decides, see RevModel::SetResidency.
+    RevEGeometryResidency m_residency = RevEGeometryResidency::All;
 };
\ No newline at end of file
@@ -9,7 +9,18 @@ void RevScene::Initialize()
     m_instanceManager->AddInstance(std::wstring(L"Data//Models//CleaningBot//cleaningBot.dae"), XMMatrixTranslation(0, -1, 3));
 }
 
+void RevScene::Update(float delta, const RevDrawData& view)
+{
+    m_instanceManager->UpdateAnimations(delta, view);
+    m_instanceManager->SkinInstances();
+}
+
 void RevScene::DrawScene(const RevDrawData& data)
 {
     m_instanceManager->DrawInstances(data);   
 }
+
+void RevScene::DrawSceneDepthOnly(const RevDrawData& data)
+{
+    m_instanceManager->DrawInstancesDepthOnly(data);
+}
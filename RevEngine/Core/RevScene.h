@@ -11,8 +11,13 @@ class RevScene
 public:
 
     void Initialize();
+    /** Animates and skins the scene instances, view decides their animation level of detail. */
+    void Update(float delta, const RevDrawData& view);
 
     void DrawScene(const RevDrawData& data);
+    /** Lays down depth for every instance using the position-only streams, models loaded without
+     *  RevModelInitializationData::m_positionStream are skipped. */
+    void DrawSceneDepthOnly(const RevDrawData& data);
     
     RevInstanceManager* m_instanceManager;
 };
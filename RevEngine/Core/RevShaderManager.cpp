@@ -14,6 +14,8 @@ void RevShaderManager::Initialize()
 {
     AddRasterizerShader( L"Data//Shaders//Shaders.hlsl");
     AddRasterizerShader( L"Data//Shaders//StaticModel.hlsl");
+    AddRasterizerShader( L"Data//Shaders//StaticModelPacked.hlsl");
+    AddRasterizerShader( L"Data//Shaders//DepthOnly.hlsl");
     AddShaderLibrary(L"Data//Shaders//RayGen.hlsl");
     AddShaderLibrary(L"Data//Shaders//Miss.hlsl");
     AddShaderLibrary(L"Data//Shaders//Hit.hlsl");
@@ -70,13 +72,9 @@ RevShaderLibrary* RevShaderManager::AddShaderLibrary(std::wstring path)
 {
     if(m_pathToShaderLibrary.find(path) == m_pathToShaderLibrary.end())
     {
-        RevShaderLibrary* library = LoadShaderLibrary(path);
-        if(library)
-        {
-            m_pathToShaderLibrary.insert_or_assign(path, library);
-            return library;
-        }
-        return nullptr;
+        RevShaderLibrary* library = m_libraryPool.Create(LoadShaderLibrary(path));
+        m_pathToShaderLibrary.insert_or_assign(path, library);
+        return library;
     }
     else
     {
@@ -89,7 +87,7 @@ RevShaderRasterizer* RevShaderManager::AddRasterizerShader(std::wstring path)
     RevShaderRasterizer* returnValue = nullptr;
     if(m_pathToShaderRaster.find(path) == m_pathToShaderRaster.end())
     {
-       RevShaderRasterizer* rasterShader = LoadRasterizerShader(path);
+       RevShaderRasterizer* rasterShader = m_rasterizerPool.Create(LoadRasterizerShader(path));
        m_pathToShaderRaster.insert_or_assign(path, rasterShader);
        returnValue = m_pathToShaderRaster[path];
     }
@@ -100,17 +98,17 @@ RevShaderRasterizer* RevShaderManager::AddRasterizerShader(std::wstring path)
     return returnValue;
 }
 
-RevShaderLibrary* RevShaderManager::LoadShaderLibrary(std::wstring path)
+RevShaderLibrary RevShaderManager::LoadShaderLibrary(std::wstring path)
 {
-    RevShaderLibrary* library = new RevShaderLibrary();
-    library->m_path = path;
-    library->m_blob = nv_helpers_dx12::CompileShaderLibrary(path.c_str());
+    RevShaderLibrary library;
+    library.m_path = path;
+    library.m_blob = nv_helpers_dx12::CompileShaderLibrary(path.c_str());
     return library;
 }
 
-RevShaderRasterizer* RevShaderManager::LoadRasterizerShader( std::wstring shaderPath)
+RevShaderRasterizer RevShaderManager::LoadRasterizerShader( std::wstring shaderPath)
 {
-    RevShaderRasterizer* rasterizer = new RevShaderRasterizer();
+    RevShaderRasterizer rasterizer;
 #if defined(_DEBUG)
     // Enable better shader debugging with the graphics debugging tools.
     UINT compileFlags = D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
@@ -118,12 +116,13 @@ RevShaderRasterizer* RevShaderManager::LoadRasterizerShader( std::wstring shader
     UINT compileFlags = 0;
 #endif
 
+    // Shader variants (e.g. StaticModelPacked.hlsl) include their base shader relative to themselves.
     ThrowIfFailed(D3DCompileFromFile(shaderPath.c_str(),
-                                     nullptr, nullptr, "VSMain", "vs_5_0",
-                                     compileFlags, 0, &rasterizer->m_vertexShader, nullptr));
+                                     nullptr, D3D_COMPILE_STANDARD_FILE_INCLUDE, "VSMain", "vs_5_0",
+                                     compileFlags, 0, &rasterizer.m_vertexShader, nullptr));
     ThrowIfFailed(D3DCompileFromFile(shaderPath.c_str(),
-                                     nullptr, nullptr, "PSMain", "ps_5_0",
-                                     compileFlags, 0, &rasterizer->m_pixelShader, nullptr));
-    rasterizer->m_path = shaderPath;
+                                     nullptr, D3D_COMPILE_STANDARD_FILE_INCLUDE, "PSMain", "ps_5_0",
+                                     compileFlags, 0, &rasterizer.m_pixelShader, nullptr));
+    rasterizer.m_path = shaderPath;
     return rasterizer;
 }
\ No newline at end of file
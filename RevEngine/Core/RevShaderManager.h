@@ -3,6 +3,7 @@
 #include <string>
 
 #include "RevShaderTypes.h"
+#include "RevSlabPool.h"
 
 class RevShaderManager
 {
@@ -17,9 +18,11 @@ private:
     RevShaderLibrary* AddShaderLibrary(std::wstring path);
     RevShaderRasterizer* AddRasterizerShader(std::wstring path);
     
-    static RevShaderLibrary* LoadShaderLibrary(std::wstring path);
-    static RevShaderRasterizer* LoadRasterizerShader(std::wstring shaderPath);
+    static RevShaderLibrary LoadShaderLibrary(std::wstring path);
+    static RevShaderRasterizer LoadRasterizerShader(std::wstring shaderPath);
 
+    RevSlabPool<RevShaderLibrary> m_libraryPool{ RevEMemoryTag::Shaders };
+    RevSlabPool<RevShaderRasterizer> m_rasterizerPool{ RevEMemoryTag::Shaders };
     std::map<std::wstring, RevShaderRasterizer*> m_pathToShaderRaster;
     std::map<std::wstring, RevShaderLibrary*> m_pathToShaderLibrary;
     
@@ -0,0 +1,269 @@
+#include "stdafx.h"
+#include "RevSkinning.h"
+#include <algorithm>
+#include <intrin.h>
+#include <immintrin.h>
+#include "RevFrameArena.h"
+#include "RevJobSystem.h"
+#include "RevModelTypes.h"
+#include "../D3D/RevD3DTypes.h"
+
+namespace
+{
+    // Vertexes per job system batch, a multiple of RevSkinning::s_lanes.
+    const UINT g_vertexesPerBatch = 2048;
+    // Skinned normals shorter than this are left unnormalized instead of dividing by zero.
+    const float g_minNormalLengthSq = 1.0e-12f;
+
+    bool DetectAvx2()
+    {
+        int info[4] = {};
+        __cpuid(info, 0);
+        if (info[0] < 7)
+        {
+            return false;
+        }
+        __cpuid(info, 1);
+        const bool fma = (info[2] & (1 << 12)) != 0;
+        const bool osxsave = (info[2] & (1 << 27)) != 0;
+        const bool avx = (info[2] & (1 << 28)) != 0;
+        // The OS has to save the YMM registers on context switches.
+        if (!fma || !osxsave || !avx || (_xgetbv(0) & 6) != 6)
+        {
+            return false;
+        }
+        __cpuidex(info, 7, 0);
+        return (info[1] & (1 << 5)) != 0;
+    }
+
+    void StoreFloat3(DirectX::XMFLOAT3& outValue, const float* x, const float* y, const float* z, UINT lane)
+    {
+        outValue.x = x[lane];
+        outValue.y = y[lane];
+        outValue.z = z[lane];
+    }
+
+    XMVECTOR LoadComponents(const std::vector<float>* components, UINT vertex)
+    {
+        return XMVectorSet(components[0][vertex], components[1][vertex], components[2][vertex], 0.0f);
+    }
+
+    XMVECTOR SkinDirection(FXMVECTOR direction, CXMMATRIX skinning)
+    {
+        const XMVECTOR skinned = XMVector3TransformNormal(direction, skinning);
+        return XMVectorGetX(XMVector3LengthSq(skinned)) > g_minNormalLengthSq ? XMVector3Normalize(skinned) : skinned;
+    }
+}
+
+void RevSkinning::BuildSkinningData(const RevModelData& modelData, RevSkinningData& outData)
+{
+    outData = {};
+    const RevAnimationData& animation = modelData.m_animation;
+    const RevVertexPosTexNormBiTan* vertexes = modelData.m_vertexStream.Get<RevVertexPosTexNormBiTan>();
+    if (!animation.IsAnimated() || !vertexes || animation.m_skinWeights.size() != modelData.GetNumVertexes())
+    {
+        return;
+    }
+
+    outData.m_vertexCount = modelData.GetNumVertexes();
+    outData.m_numJoints = animation.m_skeleton.GetNumJoints();
+    const size_t paddedCount = (outData.m_vertexCount + s_lanes - 1) / s_lanes * s_lanes;
+    for (UINT component = 0; component < 3; component++)
+    {
+        outData.m_positions[component].resize(paddedCount, 0.0f);
+        outData.m_normals[component].resize(paddedCount, 0.0f);
+        outData.m_binormals[component].resize(paddedCount, 0.0f);
+        outData.m_tangents[component].resize(paddedCount, 0.0f);
+    }
+    outData.m_texcoords.resize(paddedCount, XMFLOAT2(0.0f, 0.0f));
+    for (UINT influence = 0; influence < REV_MAX_JOINT_INFLUENCES; influence++)
+    {
+        outData.m_matrixOffsets[influence].resize(paddedCount, 0);
+        outData.m_weights[influence].resize(paddedCount, 0.0f);
+    }
+
+    for (UINT vertex = 0; vertex < outData.m_vertexCount; vertex++)
+    {
+        const RevVertexPosTexNormBiTan& source = vertexes[vertex];
+        const XMFLOAT3* attributes[] = { &source.m_position, &source.m_normal, &source.m_binormal, &source.m_tangent };
+        std::vector<float>* targets[] = { outData.m_positions, outData.m_normals, outData.m_binormals, outData.m_tangents };
+        for (UINT attribute = 0; attribute < _countof(attributes); attribute++)
+        {
+            targets[attribute][0][vertex] = attributes[attribute]->x;
+            targets[attribute][1][vertex] = attributes[attribute]->y;
+            targets[attribute][2][vertex] = attributes[attribute]->z;
+        }
+        outData.m_texcoords[vertex] = source.m_tex;
+
+        const RevSkinWeights& skin = animation.m_skinWeights[vertex];
+        for (UINT influence = 0; influence < REV_MAX_JOINT_INFLUENCES; influence++)
+        {
+            assert(skin.m_joints[influence] < outData.m_numJoints);
+            const UINT joint = min(static_cast<UINT>(skin.m_joints[influence]), outData.m_numJoints - 1);
+            outData.m_matrixOffsets[influence][vertex] = static_cast<INT>(joint * 16);
+            outData.m_weights[influence][vertex] = skin.m_weights[influence];
+        }
+    }
+}
+
+void RevSkinning::Skin(const RevSkinningJob* jobs, UINT count)
+{
+    // First batch of every job, the batches of all jobs form one range for the job system.
+    RevFrameVector<UINT> firstBatches(count + 1, 0);
+    for (UINT job = 0; job < count; job++)
+    {
+        firstBatches[job + 1] = firstBatches[job] + (jobs[job].m_data->m_vertexCount + g_vertexesPerBatch - 1) / g_vertexesPerBatch;
+    }
+    RevJobSystem::ParallelFor(firstBatches[count], 1, [jobs, &firstBatches](UINT begin, UINT end)
+    {
+        for (UINT batch = begin; batch < end; batch++)
+        {
+            const UINT job = static_cast<UINT>(std::upper_bound(firstBatches.begin(), firstBatches.end(), batch) - firstBatches.begin()) - 1;
+            const UINT firstVertex = (batch - firstBatches[job]) * g_vertexesPerBatch;
+            SkinVertexes(jobs[job], firstVertex, min(firstVertex + g_vertexesPerBatch, jobs[job].m_data->m_vertexCount));
+        }
+    });
+}
+
+void RevSkinning::SkinVertexes(const RevSkinningJob& job, UINT begin, UINT end)
+{
+    assert(begin % s_lanes == 0 && end <= job.m_data->m_vertexCount);
+    if (IsAvx2Supported())
+    {
+        SkinVertexesAvx2(job, begin, end);
+    }
+    else
+    {
+        SkinVertexesScalar(job, begin, end);
+    }
+}
+
+void RevSkinning::SkinVertexesScalar(const RevSkinningJob& job, UINT begin, UINT end)
+{
+    const RevSkinningData& data = *job.m_data;
+    for (UINT vertex = begin; vertex < end; vertex++)
+    {
+        XMMATRIX skinning(XMVectorZero(), XMVectorZero(), XMVectorZero(), XMVectorZero());
+        for (UINT influence = 0; influence < REV_MAX_JOINT_INFLUENCES; influence++)
+        {
+            const float weight = data.m_weights[influence][vertex];
+            if (weight <= 0.0f)
+            {
+                continue;
+            }
+            const XMMATRIX joint = XMLoadFloat4x4(&job.m_matrices[data.m_matrixOffsets[influence][vertex] / 16]);
+            const XMVECTOR weights = XMVectorReplicate(weight);
+            for (UINT row = 0; row < 4; row++)
+            {
+                skinning.r[row] = XMVectorMultiplyAdd(joint.r[row], weights, skinning.r[row]);
+            }
+        }
+
+        RevVertexPosTexNormBiTan& out = job.m_outVertexes[vertex];
+        XMStoreFloat3(&out.m_position, XMVector3Transform(LoadComponents(data.m_positions, vertex), skinning));
+        out.m_tex = data.m_texcoords[vertex];
+        XMStoreFloat3(&out.m_normal, SkinDirection(LoadComponents(data.m_normals, vertex), skinning));
+        XMStoreFloat3(&out.m_binormal, SkinDirection(LoadComponents(data.m_binormals, vertex), skinning));
+        XMStoreFloat3(&out.m_tangent, SkinDirection(LoadComponents(data.m_tangents, vertex), skinning));
+    }
+}
+
+namespace
+{
+    /** x * m[0] + y * m[3] + z * m[6] for the three output columns, adds the translation row m[9] when asked to. */
+    void TransformAvx2(const __m256 m[12], __m256 x, __m256 y, __m256 z, bool translate, __m256 out[3])
+    {
+        for (UINT column = 0; column < 3; column++)
+        {
+            __m256 result = translate ? m[9 + column] : _mm256_setzero_ps();
+            result = _mm256_fmadd_ps(x, m[column], result);
+            result = _mm256_fmadd_ps(y, m[3 + column], result);
+            out[column] = _mm256_fmadd_ps(z, m[6 + column], result);
+        }
+    }
+
+    void NormalizeAvx2(__m256 inOut[3])
+    {
+        __m256 lengthSq = _mm256_mul_ps(inOut[0], inOut[0]);
+        lengthSq = _mm256_fmadd_ps(inOut[1], inOut[1], lengthSq);
+        lengthSq = _mm256_fmadd_ps(inOut[2], inOut[2], lengthSq);
+        const __m256 valid = _mm256_cmp_ps(lengthSq, _mm256_set1_ps(g_minNormalLengthSq), _CMP_GT_OQ);
+        const __m256 scale = _mm256_blendv_ps(_mm256_set1_ps(1.0f), _mm256_div_ps(_mm256_set1_ps(1.0f), _mm256_sqrt_ps(lengthSq)), valid);
+        for (UINT component = 0; component < 3; component++)
+        {
+            inOut[component] = _mm256_mul_ps(inOut[component], scale);
+        }
+    }
+
+    void SkinDirectionAvx2(const __m256 m[12], const std::vector<float>* components, UINT vertex, float outLanes[3][RevSkinning::s_lanes])
+    {
+        __m256 direction[3];
+        TransformAvx2(m, _mm256_loadu_ps(&components[0][vertex]), _mm256_loadu_ps(&components[1][vertex]), _mm256_loadu_ps(&components[2][vertex]), false, direction);
+        NormalizeAvx2(direction);
+        for (UINT component = 0; component < 3; component++)
+        {
+            _mm256_storeu_ps(outLanes[component], direction[component]);
+        }
+    }
+}
+
+void RevSkinning::SkinVertexesAvx2(const RevSkinningJob& job, UINT begin, UINT end)
+{
+    const RevSkinningData& data = *job.m_data;
+    const float* matrices = &job.m_matrices[0].m[0][0];
+    for (UINT vertex = begin; vertex < end; vertex += s_lanes)
+    {
+        // Weighted sum of the joint matrices of eight vertexes, only the 4x3 affine part is needed.
+        __m256 skinning[12];
+        for (__m256& element : skinning)
+        {
+            element = _mm256_setzero_ps();
+        }
+        for (UINT influence = 0; influence < REV_MAX_JOINT_INFLUENCES; influence++)
+        {
+            const __m256 weights = _mm256_loadu_ps(&data.m_weights[influence][vertex]);
+            const __m256i offsets = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&data.m_matrixOffsets[influence][vertex]));
+            for (UINT row = 0; row < 4; row++)
+            {
+                for (UINT column = 0; column < 3; column++)
+                {
+                    const __m256 element = _mm256_i32gather_ps(matrices + row * 4 + column, offsets, sizeof(float));
+                    skinning[row * 3 + column] = _mm256_fmadd_ps(weights, element, skinning[row * 3 + column]);
+                }
+            }
+        }
+
+        // The lanes are transposed back into vertexes through the stack, the output is write combined upload memory
+        // so every vertex is written front to back exactly once.
+        float positions[3][s_lanes];
+        float normals[3][s_lanes];
+        float binormals[3][s_lanes];
+        float tangents[3][s_lanes];
+        __m256 position[3];
+        TransformAvx2(skinning, _mm256_loadu_ps(&data.m_positions[0][vertex]), _mm256_loadu_ps(&data.m_positions[1][vertex]), _mm256_loadu_ps(&data.m_positions[2][vertex]), true, position);
+        for (UINT component = 0; component < 3; component++)
+        {
+            _mm256_storeu_ps(positions[component], position[component]);
+        }
+        SkinDirectionAvx2(skinning, data.m_normals, vertex, normals);
+        SkinDirectionAvx2(skinning, data.m_binormals, vertex, binormals);
+        SkinDirectionAvx2(skinning, data.m_tangents, vertex, tangents);
+
+        const UINT numLanes = min(s_lanes, end - vertex);
+        for (UINT lane = 0; lane < numLanes; lane++)
+        {
+            RevVertexPosTexNormBiTan& out = job.m_outVertexes[vertex + lane];
+            StoreFloat3(out.m_position, positions[0], positions[1], positions[2], lane);
+            out.m_tex = data.m_texcoords[vertex + lane];
+            StoreFloat3(out.m_normal, normals[0], normals[1], normals[2], lane);
+            StoreFloat3(out.m_binormal, binormals[0], binormals[1], binormals[2], lane);
+            StoreFloat3(out.m_tangent, tangents[0], tangents[1], tangents[2], lane);
+        }
+    }
+}
+
+bool RevSkinning::IsAvx2Supported()
+{
+    static const bool s_supported = DetectAvx2();
+    return s_supported;
+}
@@ -0,0 +1,54 @@
+﻿#pragma once
+#include <vector>
+#include "RevCoreDefines.h"
+
+struct RevModelData;
+struct RevVertexPosTexNormBiTan;
+
+/** Bind pose of a skinned model in structure of arrays form, what the skinning kernel streams through.
+ *  Every array is padded to a multiple of RevSkinning::s_lanes with zero weights. */
+struct RevSkinningData
+{
+    UINT m_vertexCount = 0;
+    UINT m_numJoints = 0;
+    // x, y and z arrays of the bind pose.
+    std::vector<float> m_positions[3];
+    std::vector<float> m_normals[3];
+    std::vector<float> m_binormals[3];
+    std::vector<float> m_tangents[3];
+    std::vector<DirectX::XMFLOAT2> m_texcoords;
+    // Per influence slot, the float offset of the joint matrix (joint * 16) and its weight.
+    std::vector<INT> m_matrixOffsets[REV_MAX_JOINT_INFLUENCES];
+    std::vector<float> m_weights[REV_MAX_JOINT_INFLUENCES];
+
+    bool IsValid() const { return m_vertexCount > 0; }
+};
+
+/** Skinned vertexes of one instance, vertexes of data transformed by matrices written to m_outVertexes. */
+struct RevSkinningJob
+{
+    const RevSkinningData* m_data = nullptr;
+    const DirectX::XMFLOAT4X4* m_matrices = nullptr;
+    RevVertexPosTexNormBiTan* m_outVertexes = nullptr;
+};
+
+class RevSkinning
+{
+public:
+    // Vertexes one AVX2 iteration skins.
+    static const UINT s_lanes = 8;
+
+    /** Fills outData from the full vertexes and skin weights of an animated model, leaves it invalid for other models. */
+    static void BuildSkinningData(const RevModelData& modelData, RevSkinningData& outData);
+
+    /** Skins every job, split into vertex batches spread over the job system so one large or many small
+     *  instances both use every worker. */
+    static void Skin(const RevSkinningJob* jobs, UINT count);
+
+    /** Skins vertexes [begin, end) of job, begin a multiple of s_lanes. Uses AVX2 when the CPU and OS support it. */
+    static void SkinVertexes(const RevSkinningJob& job, UINT begin, UINT end);
+    static void SkinVertexesScalar(const RevSkinningJob& job, UINT begin, UINT end);
+    static void SkinVertexesAvx2(const RevSkinningJob& job, UINT begin, UINT end);
+
+    static bool IsAvx2Supported();
+};
@@ -0,0 +1,131 @@
+#pragma once
+#include <cassert>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+#include "RevMemoryTracker.h"
+
+/** Typed pool handing out objects from slabs of s_slabSize slots. Addresses stay stable until Destroy, freed slots
+ *  are reused through a free list before a new slab is added, so create and destroy churn does not touch the heap
+ *  and live objects stay packed. The pool only owns the storage, owners keep their own ordered lists of the objects
+ *  (instance ids, model handles), which slot reuse would not preserve. Slabs are accounted to the tag the pool is
+ *  created with. */
+template<typename T>
+class RevSlabPool
+{
+public:
+    static const UINT s_slabSize = 64;
+
+    explicit RevSlabPool(RevEMemoryTag tag) : m_tag(tag) {}
+    ~RevSlabPool() { Clear(); }
+
+    RevSlabPool(const RevSlabPool&) = delete;
+    RevSlabPool& operator=(const RevSlabPool&) = delete;
+
+    template<typename... Args>
+    T* Create(Args&&... args)
+    {
+        if (!m_freeList)
+        {
+            AddSlab();
+        }
+        Slot* slot = m_freeList;
+        m_freeList = slot->m_next;
+        UINT slabIndex = 0;
+        const UINT slotIndex = Locate(slot, slabIndex);
+        T* object = new (slot->m_object) T(std::forward<Args>(args)...);
+        m_slabs[slabIndex]->m_live |= 1ull << slotIndex;
+        m_count++;
+        return object;
+    }
+
+    void Destroy(T* object)
+    {
+        if (!object)
+        {
+            return;
+        }
+        Slot* slot = reinterpret_cast<Slot*>(object);
+        UINT slabIndex = 0;
+        const UINT slotIndex = Locate(slot, slabIndex);
+        Slab& slab = *m_slabs[slabIndex];
+        assert(slab.m_live & (1ull << slotIndex));
+        object->~T();
+        slab.m_live &= ~(1ull << slotIndex);
+        slot->m_next = m_freeList;
+        m_freeList = slot;
+        m_count--;
+    }
+
+    /** Destroys every live object and releases the slabs. */
+    void Clear()
+    {
+        for (const std::unique_ptr<Slab>& slab : m_slabs)
+        {
+            for (UINT index = 0; index < s_slabSize; index++)
+            {
+                if (slab->m_live & (1ull << index))
+                {
+                    reinterpret_cast<T*>(slab->m_slots[index].m_object)->~T();
+                }
+            }
+        }
+        RevMemoryTracker::RecordFree(m_tag, m_slabs.size() * sizeof(Slab));
+        m_slabs.clear();
+        m_freeList = nullptr;
+        m_count = 0;
+    }
+
+    UINT GetCount() const { return m_count; }
+    UINT64 GetReservedSize() const { return m_slabs.size() * sizeof(Slab); }
+
+private:
+    union Slot
+    {
+        alignas(T) unsigned char m_object[sizeof(T)];
+        Slot* m_next;
+    };
+
+    struct Slab
+    {
+        Slot m_slots[s_slabSize];
+        // Bit per slot holding a constructed object.
+        UINT64 m_live = 0;
+    };
+
+    void AddSlab()
+    {
+        m_slabs.push_back(std::unique_ptr<Slab>(new Slab()));
+        RevMemoryTracker::RecordAllocation(m_tag, sizeof(Slab));
+        Slab& slab = *m_slabs.back();
+        // Pushed back to front so the slab fills in address order.
+        for (UINT index = s_slabSize; index-- > 0;)
+        {
+            slab.m_slots[index].m_next = m_freeList;
+            m_freeList = &slab.m_slots[index];
+        }
+    }
+
+    /** Slot index of slot in its slab, slabs are few so a linear search is enough. */
+    UINT Locate(const Slot* slot, UINT& outSlabIndex) const
+    {
+        for (UINT slabIndex = 0; slabIndex < m_slabs.size(); slabIndex++)
+        {
+            const Slot* first = m_slabs[slabIndex]->m_slots;
+            if (slot >= first && slot < first + s_slabSize)
+            {
+                outSlabIndex = slabIndex;
+                return static_cast<UINT>(slot - first);
+            }
+        }
+        assert(false && "Object does not belong to this pool");
+        outSlabIndex = 0;
+        return 0;
+    }
+
+    std::vector<std::unique_ptr<Slab>> m_slabs;
+    Slot* m_freeList = nullptr;
+    UINT m_count = 0;
+    RevEMemoryTag m_tag;
+};
@@ -0,0 +1,248 @@
+#include "stdafx.h"
+#include "RevStagingUpload.h"
+#include <deque>
+#include <vector>
+#include "RevCoreDefines.h"
+#include "RevEngineRetrievalFunctions.h"
+#include "RevGpuHeapAllocator.h"
+#include "RevLoadStatistics.h"
+#include "RevMemoryTracker.h"
+#include "../DXSampleHelper.h"
+
+namespace
+{
+    // Uploads larger than this are split, so a big mesh never needs the whole ring to itself.
+    const UINT64 g_maxChunkSize = REV_STAGING_WINDOW_SIZE / 2;
+    const UINT64 g_ringAlignment = 16;
+
+    /** Copies submitted together, their ring memory and allocator are free once the queue passed m_fenceValue. */
+    struct RevStagingBatch
+    {
+        ComPtr<ID3D12CommandAllocator> m_allocator;
+        UINT64 m_fenceValue = 0;
+        UINT64 m_ringSize = 0;
+    };
+
+    struct RevStagingRing
+    {
+        ComPtr<ID3D12Resource> m_buffer;
+        UINT8* m_mapped = nullptr;
+        // Next free byte and bytes still owned by pending or in flight copies, the free range starts at m_head.
+        UINT64 m_head = 0;
+        UINT64 m_used = 0;
+        ComPtr<ID3D12GraphicsCommandList> m_commandList;
+        ComPtr<ID3D12Fence> m_fence;
+        HANDLE m_fenceEvent = nullptr;
+        UINT64 m_fenceValue = 0;
+        // Copies recorded into m_commandList, not submitted yet. Recording when m_pending.m_allocator is set.
+        RevStagingBatch m_pending;
+        std::deque<RevStagingBatch> m_inFlight;
+        std::vector<ComPtr<ID3D12CommandAllocator>> m_freeAllocators;
+    };
+
+    RevStagingRing g_ring;
+
+    void InitializeRing()
+    {
+        if (g_ring.m_buffer)
+        {
+            return;
+        }
+        ID3D12Device5* device = RevEngineRetrievalFunctions::GetDevice();
+        CD3DX12_HEAP_PROPERTIES heapProperty(D3D12_HEAP_TYPE_UPLOAD);
+        CD3DX12_RESOURCE_DESC bufferResource = CD3DX12_RESOURCE_DESC::Buffer(REV_STAGING_WINDOW_SIZE);
+        ThrowIfFailed(device->CreateCommittedResource(
+            &heapProperty, D3D12_HEAP_FLAG_NONE, &bufferResource,
+            D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&g_ring.m_buffer)));
+        // Only geometry is staged through the ring.
+        RevMemoryTracker::TrackResource(RevEMemoryTag::Models, g_ring.m_buffer.Get());
+        CD3DX12_RANGE readRange(0, 0);
+        ThrowIfFailed(g_ring.m_buffer->Map(0, &readRange, reinterpret_cast<void**>(&g_ring.m_mapped)));
+
+        ComPtr<ID3D12CommandAllocator> allocator;
+        ThrowIfFailed(device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&allocator)));
+        ThrowIfFailed(device->CreateCommandList(
+            0, D3D12_COMMAND_LIST_TYPE_DIRECT, allocator.Get(), nullptr, IID_PPV_ARGS(&g_ring.m_commandList)));
+        ThrowIfFailed(g_ring.m_commandList->Close());
+        g_ring.m_freeAllocators.push_back(allocator);
+        ThrowIfFailed(device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&g_ring.m_fence)));
+        g_ring.m_fenceEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+        if (g_ring.m_fenceEvent == nullptr)
+        {
+            ThrowIfFailed(HRESULT_FROM_WIN32(GetLastError()));
+        }
+    }
+
+    void WaitForFence(UINT64 fenceValue)
+    {
+        if (g_ring.m_fence->GetCompletedValue() < fenceValue)
+        {
+            ThrowIfFailed(g_ring.m_fence->SetEventOnCompletion(fenceValue, g_ring.m_fenceEvent));
+            WaitForSingleObject(g_ring.m_fenceEvent, INFINITE);
+        }
+    }
+
+    void RetireBatch()
+    {
+        RevStagingBatch& batch = g_ring.m_inFlight.front();
+        g_ring.m_used -= batch.m_ringSize;
+        g_ring.m_freeAllocators.push_back(batch.m_allocator);
+        g_ring.m_inFlight.pop_front();
+    }
+
+    /** Hands ring memory and allocators of finished batches back without waiting. */
+    void RetireCompletedBatches()
+    {
+        const UINT64 completedValue = g_ring.m_fence->GetCompletedValue();
+        while (!g_ring.m_inFlight.empty() && g_ring.m_inFlight.front().m_fenceValue <= completedValue)
+        {
+            RetireBatch();
+        }
+    }
+
+    /** Offset of size bytes of ring memory, submitting and waiting on older copies while the ring is full. */
+    UINT64 AllocateRing(UINT64 size, UINT64 alignment = g_ringAlignment)
+    {
+        assert(size <= REV_STAGING_WINDOW_SIZE && alignment > 0 && (alignment & (alignment - 1)) == 0);
+        RetireCompletedBatches();
+        for (;;)
+        {
+            if (g_ring.m_used == 0)
+            {
+                g_ring.m_head = 0;
+            }
+            // A range never wraps, the alignment padding and the bytes skipped at the end of the ring belong to it.
+            UINT64 offset = (g_ring.m_head + alignment - 1) & ~(alignment - 1);
+            UINT64 ringSize = offset + size - g_ring.m_head;
+            if (offset + size > REV_STAGING_WINDOW_SIZE)
+            {
+                offset = 0;
+                ringSize = REV_STAGING_WINDOW_SIZE - g_ring.m_head + size;
+            }
+            if (g_ring.m_used + ringSize <= REV_STAGING_WINDOW_SIZE)
+            {
+                g_ring.m_head = offset + size;
+                g_ring.m_used += ringSize;
+                g_ring.m_pending.m_ringSize += ringSize;
+                return offset;
+            }
+            if (g_ring.m_inFlight.empty())
+            {
+                RevStagingUpload::Submit();
+            }
+            WaitForFence(g_ring.m_inFlight.front().m_fenceValue);
+            RetireBatch();
+        }
+    }
+
+    ID3D12GraphicsCommandList* GetRecordingCommandList()
+    {
+        if (!g_ring.m_pending.m_allocator)
+        {
+            if (g_ring.m_freeAllocators.empty())
+            {
+                ID3D12Device5* device = RevEngineRetrievalFunctions::GetDevice();
+                ComPtr<ID3D12CommandAllocator> allocator;
+                ThrowIfFailed(device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&allocator)));
+                g_ring.m_freeAllocators.push_back(allocator);
+            }
+            g_ring.m_pending.m_allocator = g_ring.m_freeAllocators.back();
+            g_ring.m_freeAllocators.pop_back();
+            ThrowIfFailed(g_ring.m_pending.m_allocator->Reset());
+            ThrowIfFailed(g_ring.m_commandList->Reset(g_ring.m_pending.m_allocator.Get(), nullptr));
+        }
+        return g_ring.m_commandList.Get();
+    }
+}
+
+ComPtr<ID3D12Resource> RevStagingUpload::CreateBuffer(const void* data, UINT64 size)
+{
+    ComPtr<ID3D12Resource> buffer = RevGpuHeapAllocator::CreateBuffer(
+        size, D3D12_RESOURCE_FLAG_NONE, D3D12_RESOURCE_STATE_COMMON, D3D12_HEAP_TYPE_DEFAULT);
+    Upload(buffer.Get(), 0, data, size);
+    return buffer;
+}
+
+void RevStagingUpload::Upload(ID3D12Resource* destination, UINT64 destinationOffset, const void* data, UINT64 size)
+{
+    InitializeRing();
+    const UINT8* source = static_cast<const UINT8*>(data);
+    for (UINT64 offset = 0; offset < size; offset += g_maxChunkSize)
+    {
+        const UINT64 chunkSize = min(g_maxChunkSize, size - offset);
+        const UINT64 ringOffset = AllocateRing(chunkSize);
+        memcpy(g_ring.m_mapped + ringOffset, source + offset, static_cast<size_t>(chunkSize));
+        RevLoadStatistics::RecordCopy(static_cast<size_t>(chunkSize));
+
+        // Buffers promote from common to copy dest implicitly and decay back once the submission finished executing.
+        ID3D12GraphicsCommandList* commandList = GetRecordingCommandList();
+        commandList->CopyBufferRegion(destination, destinationOffset + offset, g_ring.m_buffer.Get(), ringOffset, chunkSize);
+    }
+}
+
+void RevStagingUpload::UploadTexture(ID3D12Resource* texture, const D3D12_SUBRESOURCE_DATA* subresources, UINT count,
+    D3D12_RESOURCE_STATES finalState)
+{
+    InitializeRing();
+    ID3D12Device5* device = RevEngineRetrievalFunctions::GetDevice();
+    const D3D12_RESOURCE_DESC desc = texture->GetDesc();
+    for (UINT index = 0; index < count; index++)
+    {
+        D3D12_PLACED_SUBRESOURCE_FOOTPRINT footprint;
+        UINT numRows;
+        UINT64 rowSize;
+        UINT64 size;
+        device->GetCopyableFootprints(&desc, index, 1, 0, &footprint, &numRows, &rowSize, &size);
+        footprint.Offset = AllocateRing(size, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT);
+
+        const D3D12_MEMCPY_DEST destination =
+        {
+            g_ring.m_mapped + footprint.Offset,
+            footprint.Footprint.RowPitch,
+            static_cast<SIZE_T>(footprint.Footprint.RowPitch) * numRows
+        };
+        // Not recorded in RevLoadStatistics, its copy counters cover geometry only.
+        MemcpySubresource(&destination, &subresources[index], static_cast<SIZE_T>(rowSize), numRows, footprint.Footprint.Depth);
+
+        const CD3DX12_TEXTURE_COPY_LOCATION target(texture, index);
+        const CD3DX12_TEXTURE_COPY_LOCATION source(g_ring.m_buffer.Get(), footprint);
+        GetRecordingCommandList()->CopyTextureRegion(&target, 0, 0, 0, &source, nullptr);
+    }
+    // Unlike buffers, textures do not decay out of the copy dest state.
+    const CD3DX12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(texture, D3D12_RESOURCE_STATE_COPY_DEST, finalState);
+    GetRecordingCommandList()->ResourceBarrier(1, &barrier);
+}
+
+void RevStagingUpload::Submit()
+{
+    if (!g_ring.m_buffer)
+    {
+        return;
+    }
+    RetireCompletedBatches();
+    if (!g_ring.m_pending.m_allocator)
+    {
+        return;
+    }
+    ThrowIfFailed(g_ring.m_commandList->Close());
+    ID3D12CommandQueue* queue = RevEngineRetrievalFunctions::GetCommandQueue();
+    ID3D12CommandList* commandLists[] = { g_ring.m_commandList.Get() };
+    queue->ExecuteCommandLists(_countof(commandLists), commandLists);
+    ThrowIfFailed(queue->Signal(g_ring.m_fence.Get(), ++g_ring.m_fenceValue));
+    g_ring.m_pending.m_fenceValue = g_ring.m_fenceValue;
+    g_ring.m_inFlight.push_back(g_ring.m_pending);
+    g_ring.m_pending = RevStagingBatch();
+}
+
+void RevStagingUpload::Shutdown()
+{
+    if (!g_ring.m_buffer)
+    {
+        return;
+    }
+    Submit();
+    WaitForFence(g_ring.m_fenceValue);
+    g_ring.m_buffer->Unmap(0, nullptr);
+    CloseHandle(g_ring.m_fenceEvent);
+    g_ring = RevStagingRing();
+}
@@ -0,0 +1,29 @@
+﻿#pragma once
+
+/** Copies CPU data into default heap buffers through a persistently mapped upload ring of REV_STAGING_WINDOW_SIZE.
+ *  Data is copied into the ring right away so the caller may free it, the GPU copies are recorded into a single
+ *  command list and submitted together by Submit. Ring memory is reused once the fence of its submission passed,
+ *  the CPU only waits when the ring is full. */
+class RevStagingUpload
+{
+public:
+
+    /** Default heap buffer of size bytes that holds data once the pending copies are submitted. The buffer is left
+     *  in the common state, which buffers promote from to any read state on first use. */
+    static Microsoft::WRL::ComPtr<ID3D12Resource> CreateBuffer(const void* data, UINT64 size);
+
+    /** Copies size bytes of data to destinationOffset in a buffer in the common state, with the next Submit. */
+    static void Upload(ID3D12Resource* destination, UINT64 destinationOffset, const void* data, UINT64 size);
+
+    /** Copies the count subresources into a texture in the copy dest state and transitions it to finalState,
+     *  with the next Submit. Every subresource has to fit into the ring on its own. */
+    static void UploadTexture(ID3D12Resource* texture, const D3D12_SUBRESOURCE_DATA* subresources, UINT count,
+        D3D12_RESOURCE_STATES finalState);
+
+    /** Submits the copies recorded since the last call on the engine queue, command lists executed on it afterwards
+     *  see the data. Called once per frame and before executing anything that reads freshly loaded geometry. */
+    static void Submit();
+
+    /** Waits for every submitted copy and releases the ring and its command objects, the next upload creates them again. */
+    static void Shutdown();
+};
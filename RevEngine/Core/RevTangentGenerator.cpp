@@ -0,0 +1,271 @@
+#include "stdafx.h"
+#include "RevTangentGenerator.h"
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+#include "RevJobSystem.h"
+#include "../D3D/RevD3DTypes.h"
+
+namespace
+{
+    const UINT g_trianglesPerBatch = 1024;
+    const UINT g_vertexesPerBatch = 2048;
+    // Same threshold MikkTSpace uses to treat a vector as zero.
+    const float g_epsilon = 1e-20f;
+
+    XMVECTOR ProjectOnPlaneNormalized(FXMVECTOR vector, FXMVECTOR normal)
+    {
+        XMVECTOR projected = XMVectorNegativeMultiplySubtract(XMVector3Dot(normal, vector), normal, vector);
+        return XMVectorGetX(XMVector3LengthSq(projected)) > g_epsilon ? XMVector3Normalize(projected) : XMVectorZero();
+    }
+
+    // Position, UV and normal lead the vertex, these bytes decide which vertexes MikkTSpace treats as one.
+    const size_t g_weldKeySize = offsetof(RevVertexPosTexNormBiTan, m_binormal);
+    // Generated normals are smooth across every vertex at the same position.
+    const size_t g_positionKeySize = sizeof(XMFLOAT3);
+
+    /** Weighted tangent and bitangent one triangle adds to one of its vertexes. */
+    struct RevCornerTangent
+    {
+        XMFLOAT3 m_tangent;
+        XMFLOAT3 m_bitangent;
+        // Sign of the UV area, 0 for triangles without one.
+        INT8 m_orientation;
+    };
+
+    /** Maps every vertex to the first of the vertexes whose leading keySize bytes are equal, returns their count. */
+    UINT WeldVertexes(const RevVertexPosTexNormBiTan* vertexes, UINT numVertexes, size_t keySize, std::vector<UINT>& outWelded)
+    {
+        std::vector<UINT> order(numVertexes);
+        for (UINT vertex = 0; vertex < numVertexes; vertex++)
+        {
+            order[vertex] = vertex;
+        }
+        std::sort(order.begin(), order.end(), [vertexes, keySize](UINT left, UINT right)
+        {
+            const int compare = memcmp(&vertexes[left], &vertexes[right], keySize);
+            return compare < 0 || (compare == 0 && left < right);
+        });
+        outWelded.resize(numVertexes);
+        UINT numWelded = 0;
+        for (size_t first = 0; first < order.size();)
+        {
+            size_t end = first + 1;
+            while (end < order.size() && memcmp(&vertexes[order[first]], &vertexes[order[end]], keySize) == 0)
+            {
+                end++;
+            }
+            for (size_t entry = first; entry < end; entry++)
+            {
+                outWelded[order[entry]] = numWelded;
+            }
+            numWelded++;
+            first = end;
+        }
+        return numWelded;
+    }
+
+    /** Angle between the edges of the triangle leaving corner, measured in the plane of normal. */
+    float GetCornerAngle(const RevVertexPosTexNormBiTan* vertexes, const UINT* triangleIndices, UINT corner, FXMVECTOR normal)
+    {
+        XMVECTOR position = XMLoadFloat3(&vertexes[triangleIndices[corner]].m_position);
+        XMVECTOR toNext = ProjectOnPlaneNormalized(XMLoadFloat3(&vertexes[triangleIndices[(corner + 1) % 3]].m_position) - position, normal);
+        XMVECTOR toPrevious = ProjectOnPlaneNormalized(XMLoadFloat3(&vertexes[triangleIndices[(corner + 2) % 3]].m_position) - position, normal);
+        return XMVectorGetX(XMVectorACos(XMVectorClamp(XMVector3Dot(toNext, toPrevious), g_XMNegativeOne, g_XMOne)));
+    }
+}
+
+void RevTangentGenerator::GenerateNormals(RevModelData& modelData, const RevSubMesh& subMesh)
+{
+    const UINT numTriangles = subMesh.m_indexCount / 3;
+    const UINT numVertexes = subMesh.m_vertexCount;
+    if (numTriangles == 0 || numVertexes == 0)
+    {
+        return;
+    }
+    RevVertexPosTexNormBiTan* vertexes = modelData.m_vertexStream.Get<RevVertexPosTexNormBiTan>() + subMesh.m_baseVertex;
+    const UINT* indices = &modelData.m_indices[subMesh.m_indexOffset];
+
+    std::vector<XMFLOAT3> corners(numTriangles * 3);
+    RevJobSystem::ParallelFor(numTriangles, g_trianglesPerBatch, [&](UINT begin, UINT end)
+    {
+        for (UINT triangle = begin; triangle < end; triangle++)
+        {
+            const UINT* triangleIndices = &indices[triangle * 3];
+            XMVECTOR p0 = XMLoadFloat3(&vertexes[triangleIndices[0]].m_position);
+            XMVECTOR faceNormal = XMVector3Cross(
+                XMLoadFloat3(&vertexes[triangleIndices[1]].m_position) - p0, XMLoadFloat3(&vertexes[triangleIndices[2]].m_position) - p0);
+            // Degenerate triangles add nothing.
+            faceNormal = XMVectorGetX(XMVector3LengthSq(faceNormal)) > g_epsilon ? XMVector3Normalize(faceNormal) : XMVectorZero();
+            for (UINT corner = 0; corner < 3; corner++)
+            {
+                XMStoreFloat3(&corners[triangle * 3 + corner], faceNormal * GetCornerAngle(vertexes, triangleIndices, corner, faceNormal));
+            }
+        }
+    });
+
+    std::vector<UINT> welded;
+    const UINT numWelded = WeldVertexes(vertexes, numVertexes, g_positionKeySize, welded);
+    std::vector<XMFLOAT3> normals(numWelded, XMFLOAT3(0.0f, 0.0f, 0.0f));
+    for (UINT index = 0; index < numTriangles * 3; index++)
+    {
+        assert(indices[index] < numVertexes);
+        XMFLOAT3& normal = normals[welded[indices[index]]];
+        XMStoreFloat3(&normal, XMLoadFloat3(&normal) + XMLoadFloat3(&corners[index]));
+    }
+
+    RevJobSystem::ParallelFor(numVertexes, g_vertexesPerBatch, [&](UINT begin, UINT end)
+    {
+        for (UINT vertexIndex = begin; vertexIndex < end; vertexIndex++)
+        {
+            XMVECTOR normal = XMLoadFloat3(&normals[welded[vertexIndex]]);
+            // Vertexes used by degenerate triangles only still need a unit normal for the tangent frame.
+            normal = XMVectorGetX(XMVector3LengthSq(normal)) > g_epsilon ? XMVector3Normalize(normal) : g_XMIdentityR2;
+            XMStoreFloat3(&vertexes[vertexIndex].m_normal, normal);
+        }
+    });
+}
+
+void RevTangentGenerator::GenerateTangents(RevModelData& modelData, const RevSubMesh& subMesh)
+{
+    const UINT numTriangles = subMesh.m_indexCount / 3;
+    const UINT numVertexes = subMesh.m_vertexCount;
+    if (numTriangles == 0 || numVertexes == 0)
+    {
+        return;
+    }
+    RevVertexPosTexNormBiTan* vertexes = modelData.m_vertexStream.Get<RevVertexPosTexNormBiTan>() + subMesh.m_baseVertex;
+    const UINT* indices = &modelData.m_indices[subMesh.m_indexOffset];
+
+    std::vector<RevCornerTangent> corners(numTriangles * 3);
+    RevJobSystem::ParallelFor(numTriangles, g_trianglesPerBatch, [&](UINT begin, UINT end)
+    {
+        for (UINT triangle = begin; triangle < end; triangle++)
+        {
+            const UINT* triangleIndices = &indices[triangle * 3];
+            const RevVertexPosTexNormBiTan& v0 = vertexes[triangleIndices[0]];
+            const RevVertexPosTexNormBiTan& v1 = vertexes[triangleIndices[1]];
+            const RevVertexPosTexNormBiTan& v2 = vertexes[triangleIndices[2]];
+            XMVECTOR p0 = XMLoadFloat3(&v0.m_position);
+            XMVECTOR edge1 = XMLoadFloat3(&v1.m_position) - p0;
+            XMVECTOR edge2 = XMLoadFloat3(&v2.m_position) - p0;
+            const float s1 = v1.m_tex.x - v0.m_tex.x;
+            const float t1 = v1.m_tex.y - v0.m_tex.y;
+            const float s2 = v2.m_tex.x - v0.m_tex.x;
+            const float t2 = v2.m_tex.y - v0.m_tex.y;
+
+            // Triangles without UV area add nothing, their vertexes take the frame from their neighbours.
+            const float signedArea = s1 * t2 - t1 * s2;
+            XMVECTOR faceTangent = XMVectorZero();
+            XMVECTOR faceBitangent = XMVectorZero();
+            INT8 faceOrientation = 0;
+            if (fabsf(signedArea) > g_epsilon)
+            {
+                faceOrientation = signedArea > 0.0f ? 1 : -1;
+                const float orientation = static_cast<float>(faceOrientation);
+                faceTangent = XMVectorSubtract(edge1 * t2, edge2 * t1);
+                faceBitangent = XMVectorSubtract(edge2 * s1, edge1 * s2);
+                faceTangent = XMVectorGetX(XMVector3LengthSq(faceTangent)) > g_epsilon ? XMVector3Normalize(faceTangent) * orientation : XMVectorZero();
+                faceBitangent = XMVectorGetX(XMVector3LengthSq(faceBitangent)) > g_epsilon ? XMVector3Normalize(faceBitangent) * orientation : XMVectorZero();
+            }
+
+            for (UINT corner = 0; corner < 3; corner++)
+            {
+                XMVECTOR normal = XMLoadFloat3(&vertexes[triangleIndices[corner]].m_normal);
+                const float angle = GetCornerAngle(vertexes, triangleIndices, corner, normal);
+
+                RevCornerTangent& cornerTangent = corners[triangle * 3 + corner];
+                XMStoreFloat3(&cornerTangent.m_tangent, ProjectOnPlaneNormalized(faceTangent, normal) * angle);
+                XMStoreFloat3(&cornerTangent.m_bitangent, ProjectOnPlaneNormalized(faceBitangent, normal) * angle);
+                cornerTangent.m_orientation = faceOrientation;
+            }
+        }
+    });
+
+    // The importer does not weld, so split UVs and duplicated vertexes would each get the tangent of their own faces.
+    // Like MikkTSpace, corners are gathered per welded vertex and per UV orientation, mirrored halves stay apart.
+    std::vector<UINT> welded;
+    const UINT numWelded = WeldVertexes(vertexes, numVertexes, g_weldKeySize, welded);
+
+    // Corners per welded vertex laid out back to back, so every group sums its own corners without sharing writes.
+    std::vector<UINT> cornerOffsets(numWelded + 1, 0);
+    for (UINT index = 0; index < numTriangles * 3; index++)
+    {
+        assert(indices[index] < numVertexes);
+        cornerOffsets[welded[indices[index]] + 1]++;
+    }
+    for (UINT weld = 0; weld < numWelded; weld++)
+    {
+        cornerOffsets[weld + 1] += cornerOffsets[weld];
+    }
+    std::vector<UINT> weldCorners(numTriangles * 3);
+    std::vector<UINT> fill(cornerOffsets.begin(), cornerOffsets.end() - 1);
+    for (UINT index = 0; index < numTriangles * 3; index++)
+    {
+        weldCorners[fill[welded[indices[index]]]++] = index;
+    }
+
+    // Two groups per welded vertex, [0] for mirrored UVs and [1] for the rest.
+    std::vector<RevCornerTangent> groups(numWelded * 2);
+    RevJobSystem::ParallelFor(numWelded, g_vertexesPerBatch, [&](UINT begin, UINT end)
+    {
+        for (UINT weld = begin; weld < end; weld++)
+        {
+            XMVECTOR tangents[2] = { XMVectorZero(), XMVectorZero() };
+            XMVECTOR bitangents[2] = { XMVectorZero(), XMVectorZero() };
+            INT votes = 0;
+            for (UINT corner = cornerOffsets[weld]; corner < cornerOffsets[weld + 1]; corner++)
+            {
+                const RevCornerTangent& cornerTangent = corners[weldCorners[corner]];
+                if (cornerTangent.m_orientation == 0)
+                {
+                    continue;
+                }
+                const UINT group = cornerTangent.m_orientation > 0 ? 1 : 0;
+                tangents[group] += XMLoadFloat3(&cornerTangent.m_tangent);
+                bitangents[group] += XMLoadFloat3(&cornerTangent.m_bitangent);
+                votes += cornerTangent.m_orientation;
+            }
+            for (UINT group = 0; group < 2; group++)
+            {
+                RevCornerTangent& groupTangent = groups[weld * 2 + group];
+                XMStoreFloat3(&groupTangent.m_tangent, tangents[group]);
+                XMStoreFloat3(&groupTangent.m_bitangent, bitangents[group]);
+                // Mark the group most corners of the vertex fall into.
+                groupTangent.m_orientation = (group == 1) == (votes >= 0) ? 1 : 0;
+            }
+        }
+    });
+
+    RevJobSystem::ParallelFor(numVertexes, g_vertexesPerBatch, [&](UINT begin, UINT end)
+    {
+        for (UINT vertexIndex = begin; vertexIndex < end; vertexIndex++)
+        {
+            // A vertex shared by mirrored and unmirrored faces holds one frame, it takes the one of the majority.
+            const RevCornerTangent* group = &groups[welded[vertexIndex] * 2];
+            if (!group->m_orientation)
+            {
+                group++;
+            }
+            XMVECTOR tangent = XMLoadFloat3(&group->m_tangent);
+            XMVECTOR bitangent = XMLoadFloat3(&group->m_bitangent);
+
+            RevVertexPosTexNormBiTan& vertex = vertexes[vertexIndex];
+            XMVECTOR normal = XMLoadFloat3(&vertex.m_normal);
+            if (XMVectorGetX(XMVector3LengthSq(tangent)) > g_epsilon)
+            {
+                tangent = XMVector3Normalize(tangent);
+            }
+            else
+            {
+                // No usable UVs around this vertex, any frame around the normal will do.
+                XMVECTOR axis = fabsf(vertex.m_normal.x) < 0.9f ? g_XMIdentityR0 : g_XMIdentityR1;
+                tangent = ProjectOnPlaneNormalized(axis, normal);
+            }
+            XMVECTOR crossed = XMVector3Cross(normal, tangent);
+            const float sign = XMVectorGetX(XMVector3Dot(crossed, bitangent)) < 0.0f ? -1.0f : 1.0f;
+            XMStoreFloat3(&vertex.m_tangent, tangent);
+            XMStoreFloat3(&vertex.m_binormal, crossed * sign);
+        }
+    });
+}
@@ -0,0 +1,20 @@
+﻿#pragma once
+
+struct RevModelData;
+struct RevSubMesh;
+
+class RevTangentGenerator
+{
+public:
+
+    /** Rebuilds m_tangent and m_binormal of the subMesh vertexes from positions, normals and UVs the way MikkTSpace does:
+     *  per corner UV tangents projected onto the vertex normal and weighted by the corner angle, summed over the corners
+     *  of vertexes with equal position, UV and normal and split by UV orientation. The binormal is sign * cross(normal,
+     *  tangent). There is no angular split, MikkTSpace's default 180 degree threshold never splits either. */
+    static void GenerateTangents(RevModelData& modelData, const RevSubMesh& subMesh);
+
+    /** Fills m_normal of the subMesh vertexes for meshes imported without normals: face normals weighted by the corner
+     *  angle, summed over all vertexes at the same position, so the surface shades smooth. Run before GenerateTangents,
+     *  which needs the normals. */
+    static void GenerateNormals(RevModelData& modelData, const RevSubMesh& subMesh);
+};
@@ -0,0 +1,350 @@
+#include "stdafx.h"
+#include "RevTlsfAllocator.h"
+#include <intrin.h>
+
+namespace
+{
+    const UINT g_granularityLog = 8;
+    static_assert((1ull << g_granularityLog) == RevTlsfAllocator::s_granularity, "Granularity and its log disagree");
+    // Sizes below this share the first first level class, split linearly.
+    const UINT g_firstLevelShift = 4 + g_granularityLog;
+    const UINT64 g_smallSize = 1ull << g_firstLevelShift;
+
+    UINT FindFirstSet(UINT64 value)
+    {
+        unsigned long index = 0;
+        _BitScanForward64(&index, value);
+        return index;
+    }
+
+    UINT FindLastSet(UINT64 value)
+    {
+        unsigned long index = 0;
+        _BitScanReverse64(&index, value);
+        return index;
+    }
+
+    UINT64 AlignUp(UINT64 value, UINT64 alignment)
+    {
+        return (value + alignment - 1) & ~(alignment - 1);
+    }
+}
+
+void RevTlsfAllocator::Initialize(UINT64 size)
+{
+    m_size = size & ~(s_granularity - 1);
+    m_usedSize = 0;
+    m_blocks.clear();
+    m_unusedBlocks.clear();
+    m_firstLevelBitmap = 0;
+    for (UINT firstLevel = 0; firstLevel < s_firstLevelCount; firstLevel++)
+    {
+        m_secondLevelBitmaps[firstLevel] = 0;
+        for (UINT secondLevel = 0; secondLevel < s_secondLevelCount; secondLevel++)
+        {
+            m_freeHeads[firstLevel][secondLevel] = s_none;
+        }
+    }
+    if (m_size == 0)
+    {
+        return;
+    }
+    const UINT block = NewBlock();
+    m_blocks[block].m_offset = 0;
+    m_blocks[block].m_size = m_size;
+    InsertFree(block);
+}
+
+RevTlsfAllocation RevTlsfAllocator::Allocate(UINT64 size, UINT64 alignment)
+{
+    assert(alignment > 0 && (alignment & (alignment - 1)) == 0);
+    RevTlsfAllocation allocation;
+    size = AlignUp(max(size, 1ull), s_granularity);
+    alignment = max(alignment, s_granularity);
+    // Any block this large fits the request wherever its start lands relative to the alignment.
+    const UINT64 searchSize = size + alignment - s_granularity;
+    if (searchSize > m_size)
+    {
+        return allocation;
+    }
+    UINT block = FindFreeBlock(searchSize);
+    if (block == s_none)
+    {
+        return allocation;
+    }
+    RemoveFree(block);
+
+    const UINT64 padding = AlignUp(m_blocks[block].m_offset, alignment) - m_blocks[block].m_offset;
+    if (padding > 0)
+    {
+        // The block in front was in use, otherwise it would have merged, so the padding stays a lone free block.
+        InsertFree(SplitFront(block, padding));
+    }
+    if (m_blocks[block].m_size - size >= s_granularity)
+    {
+        const UINT used = SplitFront(block, size);
+        InsertFree(block);
+        block = used;
+    }
+    m_blocks[block].m_free = false;
+    m_usedSize += m_blocks[block].m_size;
+    allocation.m_offset = m_blocks[block].m_offset;
+    allocation.m_block = block;
+    return allocation;
+}
+
+void RevTlsfAllocator::Free(const RevTlsfAllocation& allocation)
+{
+    if (!allocation.IsValid())
+    {
+        return;
+    }
+    UINT block = allocation.m_block;
+    assert(block < m_blocks.size() && !m_blocks[block].m_free && m_blocks[block].m_offset == allocation.m_offset);
+    m_usedSize -= m_blocks[block].m_size;
+    m_blocks[block].m_free = true;
+
+    const UINT previous = m_blocks[block].m_previousPhysical;
+    if (previous != s_none && m_blocks[previous].m_free)
+    {
+        RemoveFree(previous);
+        m_blocks[previous].m_size += m_blocks[block].m_size;
+        m_blocks[previous].m_nextPhysical = m_blocks[block].m_nextPhysical;
+        if (m_blocks[block].m_nextPhysical != s_none)
+        {
+            m_blocks[m_blocks[block].m_nextPhysical].m_previousPhysical = previous;
+        }
+        ReleaseBlock(block);
+        block = previous;
+    }
+    const UINT next = m_blocks[block].m_nextPhysical;
+    if (next != s_none && m_blocks[next].m_free)
+    {
+        RemoveFree(next);
+        m_blocks[block].m_size += m_blocks[next].m_size;
+        m_blocks[block].m_nextPhysical = m_blocks[next].m_nextPhysical;
+        if (m_blocks[next].m_nextPhysical != s_none)
+        {
+            m_blocks[m_blocks[next].m_nextPhysical].m_previousPhysical = block;
+        }
+        ReleaseBlock(next);
+    }
+    InsertFree(block);
+}
+
+bool RevTlsfAllocator::Validate() const
+{
+    UINT first = s_none;
+    for (UINT block = 0; block < m_blocks.size(); block++)
+    {
+        if (m_blocks[block].m_size > 0 && m_blocks[block].m_previousPhysical == s_none)
+        {
+            if (first != s_none)
+            {
+                return false;
+            }
+            first = block;
+        }
+    }
+    UINT64 offset = 0;
+    UINT64 used = 0;
+    UINT numFree = 0;
+    bool previousFree = false;
+    for (UINT block = first; block != s_none; block = m_blocks[block].m_nextPhysical)
+    {
+        const Block& current = m_blocks[block];
+        if (current.m_offset != offset || current.m_size == 0 || (current.m_free && previousFree))
+        {
+            return false;
+        }
+        if (current.m_nextPhysical != s_none && m_blocks[current.m_nextPhysical].m_previousPhysical != block)
+        {
+            return false;
+        }
+        offset += current.m_size;
+        used += current.m_free ? 0 : current.m_size;
+        numFree += current.m_free ? 1 : 0;
+        previousFree = current.m_free;
+    }
+    if (offset != m_size || used != m_usedSize)
+    {
+        return false;
+    }
+    UINT numListed = 0;
+    for (UINT firstLevel = 0; firstLevel < s_firstLevelCount; firstLevel++)
+    {
+        const bool firstLevelSet = (m_firstLevelBitmap >> firstLevel) & 1;
+        if (firstLevelSet != (m_secondLevelBitmaps[firstLevel] != 0))
+        {
+            return false;
+        }
+        for (UINT secondLevel = 0; secondLevel < s_secondLevelCount; secondLevel++)
+        {
+            const bool secondLevelSet = (m_secondLevelBitmaps[firstLevel] >> secondLevel) & 1;
+            if (secondLevelSet != (m_freeHeads[firstLevel][secondLevel] != s_none))
+            {
+                return false;
+            }
+            for (UINT block = m_freeHeads[firstLevel][secondLevel]; block != s_none; block = m_blocks[block].m_nextFree)
+            {
+                UINT blockFirstLevel = 0;
+                UINT blockSecondLevel = 0;
+                Mapping(m_blocks[block].m_size, blockFirstLevel, blockSecondLevel);
+                if (!m_blocks[block].m_free || blockFirstLevel != firstLevel || blockSecondLevel != secondLevel)
+                {
+                    return false;
+                }
+                numListed++;
+            }
+        }
+    }
+    return numListed == numFree;
+}
+
+void RevTlsfAllocator::Mapping(UINT64 size, UINT& outFirstLevel, UINT& outSecondLevel)
+{
+    if (size < g_smallSize)
+    {
+        outFirstLevel = 0;
+        outSecondLevel = static_cast<UINT>(size >> g_granularityLog);
+        return;
+    }
+    const UINT lastSet = FindLastSet(size);
+    outSecondLevel = static_cast<UINT>(size >> (lastSet - s_secondLevelLog)) ^ s_secondLevelCount;
+    outFirstLevel = lastSet - g_firstLevelShift + 1;
+}
+
+UINT RevTlsfAllocator::FindFreeBlock(UINT64 size) const
+{
+    // Rounded up to the next class, so every block in the class found is large enough.
+    UINT64 roundedSize = size;
+    if (size >= g_smallSize)
+    {
+        roundedSize += (1ull << (FindLastSet(size) - s_secondLevelLog)) - 1;
+    }
+    UINT firstLevel = 0;
+    UINT secondLevel = 0;
+    Mapping(roundedSize, firstLevel, secondLevel);
+    if (firstLevel < s_firstLevelCount)
+    {
+        UINT secondLevelMap = m_secondLevelBitmaps[firstLevel] & (~0u << secondLevel);
+        if (secondLevelMap == 0)
+        {
+            const UINT64 firstLevelMap = firstLevel + 1 < s_firstLevelCount ? m_firstLevelBitmap & (~0ull << (firstLevel + 1)) : 0;
+            if (firstLevelMap != 0)
+            {
+                firstLevel = FindFirstSet(firstLevelMap);
+                secondLevelMap = m_secondLevelBitmaps[firstLevel];
+            }
+        }
+        if (secondLevelMap != 0)
+        {
+            return m_freeHeads[firstLevel][FindFirstSet(secondLevelMap)];
+        }
+    }
+
+    // The class of size itself holds blocks both smaller and larger than it. Rounding skips them all, which would
+    // fail a request that only fits one of them exactly, like a whole block sized to it. Its list tells them apart.
+    Mapping(size, firstLevel, secondLevel);
+    for (UINT block = m_freeHeads[firstLevel][secondLevel]; block != s_none; block = m_blocks[block].m_nextFree)
+    {
+        if (m_blocks[block].m_size >= size)
+        {
+            return block;
+        }
+    }
+    return s_none;
+}
+
+void RevTlsfAllocator::InsertFree(UINT block)
+{
+    UINT firstLevel = 0;
+    UINT secondLevel = 0;
+    Mapping(m_blocks[block].m_size, firstLevel, secondLevel);
+    Block& inserted = m_blocks[block];
+    inserted.m_free = true;
+    inserted.m_previousFree = s_none;
+    inserted.m_nextFree = m_freeHeads[firstLevel][secondLevel];
+    if (inserted.m_nextFree != s_none)
+    {
+        m_blocks[inserted.m_nextFree].m_previousFree = block;
+    }
+    m_freeHeads[firstLevel][secondLevel] = block;
+    m_firstLevelBitmap |= 1ull << firstLevel;
+    m_secondLevelBitmaps[firstLevel] |= 1u << secondLevel;
+}
+
+void RevTlsfAllocator::RemoveFree(UINT block)
+{
+    UINT firstLevel = 0;
+    UINT secondLevel = 0;
+    Mapping(m_blocks[block].m_size, firstLevel, secondLevel);
+    Block& removed = m_blocks[block];
+    if (removed.m_previousFree != s_none)
+    {
+        m_blocks[removed.m_previousFree].m_nextFree = removed.m_nextFree;
+    }
+    else
+    {
+        m_freeHeads[firstLevel][secondLevel] = removed.m_nextFree;
+    }
+    if (removed.m_nextFree != s_none)
+    {
+        m_blocks[removed.m_nextFree].m_previousFree = removed.m_previousFree;
+    }
+    if (m_freeHeads[firstLevel][secondLevel] == s_none)
+    {
+        m_secondLevelBitmaps[firstLevel] &= ~(1u << secondLevel);
+        if (m_secondLevelBitmaps[firstLevel] == 0)
+        {
+            m_firstLevelBitmap &= ~(1ull << firstLevel);
+        }
+    }
+    removed.m_previousFree = s_none;
+    removed.m_nextFree = s_none;
+    removed.m_free = false;
+}
+
+UINT RevTlsfAllocator::SplitFront(UINT block, UINT64 size)
+{
+    assert(size > 0 && size < m_blocks[block].m_size);
+    const UINT front = NewBlock();
+    // NewBlock may grow m_blocks, references are taken after it.
+    Block& split = m_blocks[front];
+    Block& rest = m_blocks[block];
+    split.m_offset = rest.m_offset;
+    split.m_size = size;
+    split.m_previousPhysical = rest.m_previousPhysical;
+    split.m_nextPhysical = block;
+    if (rest.m_previousPhysical != s_none)
+    {
+        m_blocks[rest.m_previousPhysical].m_nextPhysical = front;
+    }
+    rest.m_previousPhysical = front;
+    rest.m_offset += size;
+    rest.m_size -= size;
+    return front;
+}
+
+UINT RevTlsfAllocator::NewBlock()
+{
+    UINT block = 0;
+    if (!m_unusedBlocks.empty())
+    {
+        block = m_unusedBlocks.back();
+        m_unusedBlocks.pop_back();
+    }
+    else
+    {
+        block = static_cast<UINT>(m_blocks.size());
+        m_blocks.emplace_back();
+    }
+    m_blocks[block] = Block();
+    return block;
+}
+
+void RevTlsfAllocator::ReleaseBlock(UINT block)
+{
+    m_blocks[block] = Block();
+    m_unusedBlocks.push_back(block);
+}
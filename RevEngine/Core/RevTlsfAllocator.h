@@ -0,0 +1,68 @@
+#pragma once
+#include <climits>
+#include <vector>
+
+/** Range handed out by RevTlsfAllocator, m_block is what Free needs back. */
+struct RevTlsfAllocation
+{
+    UINT64 m_offset = 0;
+    UINT m_block = UINT_MAX;
+
+    bool IsValid() const { return m_block != UINT_MAX; }
+};
+
+/** Two level segregated fit allocator over an abstract range of s_granularity sized units. It only does offset
+ *  bookkeeping, the memory itself is never touched, so it works for GPU heaps and can be tested without a device.
+ *  Allocation and free are O(1): free blocks sit in size classes of 16 linear subdivisions per power of two,
+ *  found through two bitmaps, and neighbours merge on free. Only a request no larger class can serve walks the
+ *  list of its own class, so a block still fits a request of exactly its size. */
+class RevTlsfAllocator
+{
+public:
+    static const UINT64 s_granularity = 256;
+
+    void Initialize(UINT64 size);
+    /** Aligned range of at least size bytes, invalid when no free block fits. alignment is a power of two. */
+    RevTlsfAllocation Allocate(UINT64 size, UINT64 alignment);
+    void Free(const RevTlsfAllocation& allocation);
+
+    UINT64 GetSize() const { return m_size; }
+    UINT64 GetUsedSize() const { return m_usedSize; }
+    bool IsEmpty() const { return m_usedSize == 0; }
+    /** Walks every block and checks the links, bitmaps and sizes agree. For debugging and tests. */
+    bool Validate() const;
+
+private:
+    static const UINT s_secondLevelLog = 4;
+    static const UINT s_secondLevelCount = 1u << s_secondLevelLog;
+    static const UINT s_firstLevelCount = 64;
+    static const UINT s_none = UINT_MAX;
+
+    struct Block
+    {
+        UINT64 m_offset = 0;
+        UINT64 m_size = 0;
+        UINT m_previousPhysical = s_none;
+        UINT m_nextPhysical = s_none;
+        UINT m_previousFree = s_none;
+        UINT m_nextFree = s_none;
+        bool m_free = false;
+    };
+
+    static void Mapping(UINT64 size, UINT& outFirstLevel, UINT& outSecondLevel);
+    UINT FindFreeBlock(UINT64 size) const;
+    void InsertFree(UINT block);
+    void RemoveFree(UINT block);
+    /** Splits size bytes off the front of block into a block of its own, returned, block keeps the rest. */
+    UINT SplitFront(UINT block, UINT64 size);
+    UINT NewBlock();
+    void ReleaseBlock(UINT block);
+
+    std::vector<Block> m_blocks;
+    std::vector<UINT> m_unusedBlocks;
+    UINT64 m_firstLevelBitmap = 0;
+    UINT m_secondLevelBitmaps[s_firstLevelCount] = {};
+    UINT m_freeHeads[s_firstLevelCount][s_secondLevelCount];
+    UINT64 m_size = 0;
+    UINT64 m_usedSize = 0;
+};
@@ -0,0 +1,45 @@
+#include "stdafx.h"
+#include "RevUploadRing.h"
+#include "RevEngineRetrievalFunctions.h"
+#include "RevMemoryTracker.h"
+#include "../DXSampleHelper.h"
+
+void RevUploadRing::Initialize(UINT64 frameSize, UINT frameCount)
+{
+    assert(frameSize > 0 && frameCount > 0);
+    ID3D12Device5* device = RevEngineRetrievalFunctions::GetDevice();
+    CD3DX12_HEAP_PROPERTIES heapProperty(D3D12_HEAP_TYPE_UPLOAD);
+    CD3DX12_RESOURCE_DESC bufferResource = CD3DX12_RESOURCE_DESC::Buffer(frameSize * frameCount);
+    ThrowIfFailed(device->CreateCommittedResource(
+        &heapProperty, D3D12_HEAP_FLAG_NONE, &bufferResource,
+        D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&m_buffer)));
+    RevMemoryTracker::TrackResource(RevEMemoryTag::Frame, m_buffer.Get());
+    CD3DX12_RANGE readRange(0, 0);
+    ThrowIfFailed(m_buffer->Map(0, &readRange, reinterpret_cast<void**>(&m_mapped)));
+    m_frameSize = frameSize;
+    m_frameCount = frameCount;
+    m_frameBegin = 0;
+    m_offset = 0;
+}
+
+void RevUploadRing::BeginFrame(UINT frameIndex)
+{
+    assert(IsInitialized() && frameIndex < m_frameCount);
+    m_frameBegin = frameIndex * m_frameSize;
+    m_offset = 0;
+}
+
+RevUploadAllocation RevUploadRing::Allocate(UINT64 size, UINT64 alignment)
+{
+    assert(IsInitialized() && alignment > 0 && (alignment & (alignment - 1)) == 0);
+    const UINT64 offset = (m_offset + alignment - 1) & ~(alignment - 1);
+    RevUploadAllocation allocation;
+    if (offset + size > m_frameSize)
+    {
+        return allocation;
+    }
+    m_offset = offset + size;
+    allocation.m_data = m_mapped + m_frameBegin + offset;
+    allocation.m_gpuAddress = m_buffer->GetGPUVirtualAddress() + m_frameBegin + offset;
+    return allocation;
+}
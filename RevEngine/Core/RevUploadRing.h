@@ -0,0 +1,31 @@
+﻿#pragma once
+
+/** CPU pointer and GPU address of memory handed out by RevUploadRing. */
+struct RevUploadAllocation
+{
+    void* m_data = nullptr;
+    D3D12_GPU_VIRTUAL_ADDRESS m_gpuAddress = 0;
+};
+
+/** Persistently mapped upload buffer split into one region per frame in flight, for data rewritten every frame.
+ *  A region is handed out again frameCount frames later, the GPU has to be done with it by then. */
+class RevUploadRing
+{
+public:
+
+    void Initialize(UINT64 frameSize, UINT frameCount);
+    /** Starts handing out the region of frameIndex, everything allocated from it before is overwritten. */
+    void BeginFrame(UINT frameIndex);
+    /** Size bytes of the current frame region, an empty allocation when the region is full. */
+    RevUploadAllocation Allocate(UINT64 size, UINT64 alignment);
+
+    bool IsInitialized() const { return m_buffer.Get() != nullptr; }
+
+private:
+    Microsoft::WRL::ComPtr<ID3D12Resource> m_buffer;
+    UINT8* m_mapped = nullptr;
+    UINT64 m_frameSize = 0;
+    UINT m_frameCount = 0;
+    UINT64 m_frameBegin = 0;
+    UINT64 m_offset = 0;
+};
@@ -6,57 +6,15 @@
 #include <array>
 #include "RevCoreDefines.h"
 #include "RevEngineRetrievalFunctions.h"
+#include "RevStagingUpload.h"
 #include "../DXSampleHelper.h"
 #include "../D3D//RevD3DTypes.h"
 
-struct ID3D12Resource* RevUtils::CreateDefaultBuffer(
-		ID3D12Device5* device, 
-		ID3D12GraphicsCommandList* cmdList, 
-		const void* initData, 
-		UINT64 byteSize, 
-		ID3D12Resource* uploadBuffer)
+ComPtr<ID3D12Resource> RevUtils::CreateDefaultBuffer(
+		const void* initData,
+		UINT64 byteSize)
 {
-	ID3D12Resource* defaultBuffer;
-	// Create the actual default buffer resource.
-	ThrowIfFailed(device->CreateCommittedResource(
-		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
-		D3D12_HEAP_FLAG_NONE,
-		&CD3DX12_RESOURCE_DESC::Buffer(byteSize),
-		D3D12_RESOURCE_STATE_COMMON,
-		nullptr,
-		IID_PPV_ARGS(&defaultBuffer)));
-
-	// In order to copy CPU memory data into our default buffer, we need to create
-	// an intermediate upload heap. 
-	ThrowIfFailed(device->CreateCommittedResource(
-		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
-		D3D12_HEAP_FLAG_NONE,
-		&CD3DX12_RESOURCE_DESC::Buffer(byteSize),
-		D3D12_RESOURCE_STATE_GENERIC_READ,
-		nullptr,
-		IID_PPV_ARGS(&uploadBuffer)));
-
-
-	// Describe the data we want to copy into the default buffer.
-	D3D12_SUBRESOURCE_DATA subResourceData = {};
-	subResourceData.pData = initData;
-	subResourceData.RowPitch = byteSize;
-	subResourceData.SlicePitch = subResourceData.RowPitch;
-
-	// Schedule to copy the data to the default buffer resource.  At a high level, the helper function UpdateSubresources
-	// will copy the CPU memory into the intermediate upload heap.  Then, using ID3D12CommandList::CopySubresourceRegion,
-	// the intermediate upload heap data will be copied to mBuffer.
-	cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(defaultBuffer,
-		D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_COPY_DEST));
-	UpdateSubresources<1>(cmdList, defaultBuffer, uploadBuffer, 0, 0, 1, &subResourceData);
-	cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(defaultBuffer,
-		D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_GENERIC_READ));
-
-	// Note: uploadBuffer has to be kept alive after the above function calls because
-	// the command list has not been executed yet that performs the actual copy.
-	// The caller can Release the uploadBuffer after it knows the copy has been executed.
-
-	return nullptr;
+	return RevStagingUpload::CreateBuffer(initData, byteSize);
 }
 
 std::array<const CD3DX12_STATIC_SAMPLER_DESC, 6> RevGetStaticSamplers()
@@ -154,7 +112,7 @@ void RevUtils::CreatePSO(
 			initializationData.m_shader->m_vertexShader.Get()->GetBufferSize()
 		};
 	}
-	if (initializationData.m_shader->m_pixelShader.Get())
+	if (initializationData.m_usePixelShader && initializationData.m_shader->m_pixelShader.Get())
 	{
 		psoDesc.PS =
 		{
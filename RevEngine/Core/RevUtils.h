@@ -16,6 +16,7 @@ struct RevPSOInitializationData
 
 	bool m_useDepth = true;
 	bool m_useStencil = true;
+	bool m_usePixelShader = true;
 };
 
 class RevUtils
@@ -38,12 +39,10 @@ public:
 		return (byteSize + 255) & ~255;
 	}
 
-	static struct ID3D12Resource* CreateDefaultBuffer(
-		ID3D12Device5* device,
-		ID3D12GraphicsCommandList* cmdList,
+	/** Default heap buffer holding initData, staged through RevStagingUpload so no upload buffer outlives the copy. */
+	static Microsoft::WRL::ComPtr<ID3D12Resource> CreateDefaultBuffer(
 		const void* initData,
-		UINT64 byteSize,
-		ID3D12Resource* uploadBuffer);
+		UINT64 byteSize);
 
 	static void CreateModelRootDescription(
 		CD3DX12_ROOT_PARAMETER* parameter,
@@ -0,0 +1,73 @@
+#include "stdafx.h"
+#include "RevVertexFormat.h"
+#include "RevArchive.h"
+
+// Out of class definitions of the constexpr members, C++14 still needs them once they are odr-used.
+constexpr D3D12_INPUT_ELEMENT_DESC RevVertexTraits<RevVertexPosCol>::s_elements[];
+constexpr D3D12_INPUT_ELEMENT_DESC RevVertexTraits<RevVertexPosTexNormBiTan>::s_elements[];
+constexpr D3D12_INPUT_ELEMENT_DESC RevVertexTraits<RevVertexPosTexNormTanPacked>::s_elements[];
+
+namespace
+{
+    template<typename Vertex>
+    RevVertexLayoutDesc MakeLayoutDesc()
+    {
+        RevVertexLayoutDesc desc;
+        desc.m_stride = sizeof(Vertex);
+        desc.m_positionOffset = RevVertexTraits<Vertex>::s_positionOffset;
+        desc.m_positionFormat = RevVertexTraits<Vertex>::s_positionFormat;
+        desc.m_elements = RevVertexTraits<Vertex>::s_elements;
+        desc.m_numElements = ARRAYSIZE(RevVertexTraits<Vertex>::s_elements);
+        return desc;
+    }
+
+    // Indexed by RevEVertexLayout.
+    const RevVertexLayoutDesc g_layoutDescs[] =
+    {
+        RevVertexLayoutDesc(),
+        MakeLayoutDesc<RevVertexPosCol>(),
+        MakeLayoutDesc<RevVertexPosTexNormBiTan>(),
+        MakeLayoutDesc<RevVertexPosTexNormTanPacked>(),
+    };
+    static_assert(ARRAYSIZE(g_layoutDescs) == static_cast<size_t>(RevEVertexLayout::Count), "Every vertex layout needs a desc");
+    static_assert(RevVertexTraits<RevVertexPosTexNormBiTan>::s_elements[4].AlignedByteOffset == 44, "Full vertexes changed layout");
+    static_assert(RevVertexTraits<RevVertexPosTexNormTanPacked>::s_elements[3].AlignedByteOffset == 16, "Packed vertexes changed layout");
+}
+
+const RevVertexLayoutDesc& RevVertexStream::GetLayoutDesc(RevEVertexLayout layout)
+{
+    assert(layout < RevEVertexLayout::Count);
+    return g_layoutDescs[static_cast<size_t>(layout)];
+}
+
+const DirectX::XMFLOAT3* RevVertexStream::GetFloatPositions() const
+{
+    const RevVertexLayoutDesc& desc = GetLayoutDesc();
+    if (m_bytes.empty() || desc.m_positionFormat != DXGI_FORMAT_R32G32B32_FLOAT)
+    {
+        return nullptr;
+    }
+    return reinterpret_cast<const DirectX::XMFLOAT3*>(m_bytes.data() + desc.m_positionOffset);
+}
+
+void RevVertexStream::Release()
+{
+    RevGeometryVector<UINT8>().swap(m_bytes);
+    m_layout = RevEVertexLayout::None;
+    m_stride = 0;
+}
+
+void RevVertexStream::Serialize(RevArchive& archive)
+{
+    archive << m_layout;
+    archive << m_bytes;
+    if (archive.IsLoading())
+    {
+        // A corrupt layout or a size that is no whole number of vertexes leaves the stream empty.
+        m_stride = m_layout < RevEVertexLayout::Count ? GetLayoutDesc(m_layout).m_stride : 0;
+        if (m_stride == 0 || m_bytes.size() % m_stride != 0)
+        {
+            Release();
+        }
+    }
+}
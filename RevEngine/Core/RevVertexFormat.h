@@ -0,0 +1,156 @@
+﻿#pragma once
+#include <cassert>
+#include <cstddef>
+#include <initializer_list>
+#include "RevLoadStatistics.h"
+#include "RevModelTypes.h"
+
+/** Vertex structs a model can store, one per RevVertexTraits specialization. */
+enum class RevEVertexLayout : UINT8
+{
+    None,
+    PosCol,
+    PosTexNormBiTan,
+    PosTexNormTanPacked,
+    Count
+};
+
+/** DXGI format of a vertex member type. */
+template<typename Member>
+struct RevVertexElementFormat;
+
+template<> struct RevVertexElementFormat<DirectX::XMFLOAT2> { static constexpr DXGI_FORMAT s_format = DXGI_FORMAT_R32G32_FLOAT; };
+template<> struct RevVertexElementFormat<DirectX::XMFLOAT3> { static constexpr DXGI_FORMAT s_format = DXGI_FORMAT_R32G32B32_FLOAT; };
+template<> struct RevVertexElementFormat<DirectX::XMFLOAT4> { static constexpr DXGI_FORMAT s_format = DXGI_FORMAT_R32G32B32A32_FLOAT; };
+template<> struct RevVertexElementFormat<DirectX::PackedVector::XMHALF2> { static constexpr DXGI_FORMAT s_format = DXGI_FORMAT_R16G16_FLOAT; };
+template<> struct RevVertexElementFormat<DirectX::PackedVector::XMSHORTN2> { static constexpr DXGI_FORMAT s_format = DXGI_FORMAT_R16G16_SNORM; };
+template<> struct RevVertexElementFormat<DirectX::PackedVector::XMSHORTN4> { static constexpr DXGI_FORMAT s_format = DXGI_FORMAT_R16G16B16A16_SNORM; };
+
+template<typename Member>
+constexpr D3D12_INPUT_ELEMENT_DESC RevMakeVertexElement(const char* semantic, UINT offset)
+{
+    return { semantic, 0, RevVertexElementFormat<Member>::s_format, 0, offset, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 };
+}
+
+/** Input element of a vertex member, format and offset come from the member itself. */
+#define REV_VERTEX_ELEMENT(Vertex, member, semantic) \
+    RevMakeVertexElement<decltype(Vertex::member)>(semantic, static_cast<UINT>(offsetof(Vertex, member)))
+
+/** Compile time description of a vertex struct: its layout tag, input elements and where the position is,
+ *  the BLAS builder and the CPU side passes read positions through it. */
+template<typename Vertex>
+struct RevVertexTraits;
+
+template<>
+struct RevVertexTraits<RevVertexPosCol>
+{
+    static constexpr RevEVertexLayout s_layout = RevEVertexLayout::PosCol;
+    static constexpr UINT s_positionOffset = offsetof(RevVertexPosCol, position);
+    static constexpr DXGI_FORMAT s_positionFormat = RevVertexElementFormat<decltype(RevVertexPosCol::position)>::s_format;
+    static constexpr D3D12_INPUT_ELEMENT_DESC s_elements[] =
+    {
+        REV_VERTEX_ELEMENT(RevVertexPosCol, position, "POSITION"),
+        REV_VERTEX_ELEMENT(RevVertexPosCol, color, "COLOR"),
+    };
+};
+
+template<>
+struct RevVertexTraits<RevVertexPosTexNormBiTan>
+{
+    static constexpr RevEVertexLayout s_layout = RevEVertexLayout::PosTexNormBiTan;
+    static constexpr UINT s_positionOffset = offsetof(RevVertexPosTexNormBiTan, m_position);
+    static constexpr DXGI_FORMAT s_positionFormat = RevVertexElementFormat<decltype(RevVertexPosTexNormBiTan::m_position)>::s_format;
+    static constexpr D3D12_INPUT_ELEMENT_DESC s_elements[] =
+    {
+        REV_VERTEX_ELEMENT(RevVertexPosTexNormBiTan, m_position, "POSITION"),
+        REV_VERTEX_ELEMENT(RevVertexPosTexNormBiTan, m_tex, "TEXCOORD"),
+        REV_VERTEX_ELEMENT(RevVertexPosTexNormBiTan, m_normal, "NORMAL"),
+        REV_VERTEX_ELEMENT(RevVertexPosTexNormBiTan, m_binormal, "BINORMAL"),
+        REV_VERTEX_ELEMENT(RevVertexPosTexNormBiTan, m_tangent, "TANGENT"),
+    };
+};
+
+template<>
+struct RevVertexTraits<RevVertexPosTexNormTanPacked>
+{
+    static constexpr RevEVertexLayout s_layout = RevEVertexLayout::PosTexNormTanPacked;
+    static constexpr UINT s_positionOffset = offsetof(RevVertexPosTexNormTanPacked, m_position);
+    // Quantized, see RevPositionQuantization.
+    static constexpr DXGI_FORMAT s_positionFormat = RevVertexElementFormat<decltype(RevVertexPosTexNormTanPacked::m_position)>::s_format;
+    static constexpr D3D12_INPUT_ELEMENT_DESC s_elements[] =
+    {
+        REV_VERTEX_ELEMENT(RevVertexPosTexNormTanPacked, m_position, "POSITION"),
+        REV_VERTEX_ELEMENT(RevVertexPosTexNormTanPacked, m_tex, "TEXCOORD"),
+        REV_VERTEX_ELEMENT(RevVertexPosTexNormTanPacked, m_normal, "NORMAL"),
+        REV_VERTEX_ELEMENT(RevVertexPosTexNormTanPacked, m_tangent, "TANGENT"),
+    };
+};
+
+/** Runtime view of RevVertexTraits for code that only knows the layout tag. */
+struct RevVertexLayoutDesc
+{
+    UINT m_stride = 0;
+    UINT m_positionOffset = 0;
+    DXGI_FORMAT m_positionFormat = DXGI_FORMAT_UNKNOWN;
+    const D3D12_INPUT_ELEMENT_DESC* m_elements = nullptr;
+    UINT m_numElements = 0;
+};
+
+/** Vertex storage of a model holding a single vertex struct. Typed access is checked against the stored layout,
+ *  stride and layout queries are plain member reads instead of branches over every vertex type. */
+class RevVertexStream
+{
+public:
+    static const RevVertexLayoutDesc& GetLayoutDesc(RevEVertexLayout layout);
+
+    /** Resizes the stream to count vertexes of Vertex, keeping existing ones, and returns the first. */
+    template<typename Vertex>
+    Vertex* Resize(UINT count)
+    {
+        assert(m_layout == RevEVertexLayout::None || m_layout == RevVertexTraits<Vertex>::s_layout);
+        m_layout = RevVertexTraits<Vertex>::s_layout;
+        m_stride = sizeof(Vertex);
+        m_bytes.resize(static_cast<size_t>(count) * sizeof(Vertex));
+        return Get<Vertex>();
+    }
+
+    template<typename Vertex>
+    void Assign(std::initializer_list<Vertex> vertexes)
+    {
+        Vertex* first = Resize<Vertex>(static_cast<UINT>(vertexes.size()));
+        for (const Vertex& vertex : vertexes)
+        {
+            *first++ = vertex;
+        }
+    }
+
+    /** Whether the stream has vertexes of type Vertex. */
+    template<typename Vertex>
+    bool Holds() const { return m_layout == RevVertexTraits<Vertex>::s_layout && !m_bytes.empty(); }
+
+    /** First vertex, nullptr unless Holds<Vertex>(). */
+    template<typename Vertex>
+    Vertex* Get() { return Holds<Vertex>() ? reinterpret_cast<Vertex*>(m_bytes.data()) : nullptr; }
+    template<typename Vertex>
+    const Vertex* Get() const { return Holds<Vertex>() ? reinterpret_cast<const Vertex*>(m_bytes.data()) : nullptr; }
+
+    RevEVertexLayout GetLayout() const { return m_layout; }
+    const RevVertexLayoutDesc& GetLayoutDesc() const { return GetLayoutDesc(m_layout); }
+    UINT GetCount() const { return m_stride > 0 ? static_cast<UINT>(m_bytes.size() / m_stride) : 0; }
+    UINT GetStride() const { return m_stride; }
+    UINT64 GetSize() const { return m_bytes.size(); }
+    bool IsEmpty() const { return m_bytes.empty(); }
+    const void* GetData() const { return m_bytes.data(); }
+
+    /** First float3 position, the next one is GetStride() bytes further. nullptr when positions are not float3. */
+    const DirectX::XMFLOAT3* GetFloatPositions() const;
+
+    /** Empties the stream and hands its memory back. */
+    void Release();
+    void Serialize(class RevArchive& archive);
+
+private:
+    RevGeometryVector<UINT8> m_bytes;
+    RevEVertexLayout m_layout = RevEVertexLayout::None;
+    UINT m_stride = 0;
+};
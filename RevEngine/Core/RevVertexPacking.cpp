@@ -0,0 +1,97 @@
+#include "stdafx.h"
+#include "RevVertexPacking.h"
+#include "../D3D/RevD3DTypes.h"
+
+using namespace DirectX::PackedVector;
+
+namespace
+{
+    // Keeps flat meshes (all vertexes on a plane) from dividing by zero when quantizing.
+    const float g_minimumExtent = 1e-5f;
+}
+
+void RevVertexPacking::PackStaticVertexes(RevModelData& modelData)
+{
+    const RevVertexPosTexNormBiTan* source = modelData.m_vertexStream.Get<RevVertexPosTexNormBiTan>();
+    const UINT numVertexes = source ? modelData.GetNumVertexes() : 0;
+
+    XMVECTOR boundsMin = g_XMFltMax;
+    XMVECTOR boundsMax = -g_XMFltMax;
+    for (UINT index = 0; index < numVertexes; index++)
+    {
+        XMVECTOR position = XMLoadFloat3(&source[index].m_position);
+        boundsMin = XMVectorMin(boundsMin, position);
+        boundsMax = XMVectorMax(boundsMax, position);
+    }
+    if (numVertexes == 0)
+    {
+        boundsMin = boundsMax = XMVectorZero();
+    }
+
+    XMVECTOR center = (boundsMin + boundsMax) * 0.5f;
+    XMVECTOR extent = XMVectorMax((boundsMax - boundsMin) * 0.5f, XMVectorReplicate(g_minimumExtent));
+    XMVECTOR inverseExtent = XMVectorReciprocal(extent);
+    XMStoreFloat3(&modelData.m_positionQuantization.m_center, center);
+    XMStoreFloat3(&modelData.m_positionQuantization.m_extent, extent);
+
+    RevVertexStream packedStream;
+    RevVertexPosTexNormTanPacked* packedVertexes = packedStream.Resize<RevVertexPosTexNormTanPacked>(numVertexes);
+    for (UINT index = 0; index < numVertexes; index++)
+    {
+        const RevVertexPosTexNormBiTan& vertex = source[index];
+        RevVertexPosTexNormTanPacked& packed = packedVertexes[index];
+
+        XMVECTOR normal = XMVector3Normalize(XMLoadFloat3(&vertex.m_normal));
+        XMVECTOR tangent = XMVector3Normalize(XMLoadFloat3(&vertex.m_tangent));
+        XMVECTOR binormal = XMLoadFloat3(&vertex.m_binormal);
+        float binormalSign = XMVectorGetX(XMVector3Dot(XMVector3Cross(normal, tangent), binormal)) < 0.0f ? -1.0f : 1.0f;
+
+        XMVECTOR position = (XMLoadFloat3(&vertex.m_position) - center) * inverseExtent;
+        position = XMVectorClamp(position, g_XMNegativeOne, g_XMOne);
+        position = XMVectorSetW(position, binormalSign);
+        XMStoreShortN4(&packed.m_position, position);
+
+        packed.m_tex = XMHALF2(vertex.m_tex.x, vertex.m_tex.y);
+
+        XMFLOAT2 encodedNormal = EncodeOctahedral(normal);
+        XMFLOAT2 encodedTangent = EncodeOctahedral(tangent);
+        XMStoreShortN2(&packed.m_normal, XMLoadFloat2(&encodedNormal));
+        XMStoreShortN2(&packed.m_tangent, XMLoadFloat2(&encodedTangent));
+    }
+
+    modelData.m_vertexFormat = RevEVertexFormat::Packed;
+    // Replacing the stream releases the full precision vertexes.
+    modelData.m_vertexStream = std::move(packedStream);
+}
+
+XMFLOAT2 RevVertexPacking::EncodeOctahedral(FXMVECTOR direction)
+{
+    XMFLOAT3 n;
+    XMStoreFloat3(&n, direction);
+    const float length = fabsf(n.x) + fabsf(n.y) + fabsf(n.z);
+    if (length <= 0.0f)
+    {
+        return XMFLOAT2(0.0f, 0.0f);
+    }
+    float x = n.x / length;
+    float y = n.y / length;
+    if (n.z < 0.0f)
+    {
+        const float foldedX = (1.0f - fabsf(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+        const float foldedY = (1.0f - fabsf(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+        x = foldedX;
+        y = foldedY;
+    }
+    return XMFLOAT2(x, y);
+}
+
+XMVECTOR RevVertexPacking::DecodeOctahedral(const XMFLOAT2& encoded)
+{
+    float x = encoded.x;
+    float y = encoded.y;
+    const float z = 1.0f - fabsf(x) - fabsf(y);
+    const float t = z < 0.0f ? -z : 0.0f;
+    x += x >= 0.0f ? -t : t;
+    y += y >= 0.0f ? -t : t;
+    return XMVector3Normalize(XMVectorSet(x, y, z, 0.0f));
+}
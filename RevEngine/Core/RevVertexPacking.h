@@ -0,0 +1,14 @@
+﻿#pragma once
+
+struct RevModelData;
+
+class RevVertexPacking
+{
+public:
+
+    /** Quantizes the full vertexes of m_vertexStream into packed ones and releases the full precision vertexes. */
+    static void PackStaticVertexes(RevModelData& modelData);
+
+    static DirectX::XMFLOAT2 EncodeOctahedral(DirectX::FXMVECTOR direction);
+    static DirectX::XMVECTOR DecodeOctahedral(const DirectX::XMFLOAT2& encoded);
+};
@@ -4,11 +4,18 @@
 #include "../BottomLevelASGenerator.h"
 #include "../DXRHelper.h"
 #include "../DXSampleHelper.h"
+#include "../Core/RevArchive.h"
+#include "../Core/RevDeferredRelease.h"
 #include "../Core/RevEngineRetrievalFunctions.h"
+#include "../Core/RevGpuHeapAllocator.h"
+#include "../Core/RevMemoryTracker.h"
 #include "../Core/RevShaderManager.h"
+#include "../Core/RevStagingUpload.h"
 #include "../Core/RevUtils.h"
 #include "../Microsoft/RevDDSTextureLoader.h"
 
+#include <stdexcept>
+
 void LoadTexture(const std::wstring& path, struct ID3D12Resource** resourceToEndUpAt)
 {
 	std::vector<D3D12_SUBRESOURCE_DATA> subResources;
@@ -19,80 +26,173 @@ void LoadTexture(const std::wstring& path, struct ID3D12Resource** resourceToEnd
         resourceToEndUpAt,
         ddsData,
         subResources));
+	RevMemoryTracker::TrackResource(RevEMemoryTag::Textures, *resourceToEndUpAt);
+	// The subresources point into ddsData, the staging ring copies them before it goes away.
+	RevStagingUpload::UploadTexture(*resourceToEndUpAt, subResources.data(), static_cast<UINT>(subResources.size()),
+		D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE | D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
 }
 
-RevModelD3DData RevModelD3DData::Create(const RevModelData& data)
+void RevModelData::Serialize(RevArchive& archive)
+{
+	archive << m_type;
+	archive << m_vertexFormat;
+	archive << m_positionQuantization;
+	archive << m_bounds;
+	archive << m_geometryHash;
+	m_vertexStream.Serialize(archive);
+	archive << m_indices;
+	archive << m_shortIndices;
+	archive << m_subMeshes;
+	archive << m_lods;
+	archive << m_lodSubMeshes;
+	archive << m_clusters;
+	archive << m_clusterGroups;
+	archive << m_clusterPages;
+	archive << m_meshlets;
+	archive << m_meshletVertexes;
+	archive << m_meshletTriangles;
+
+	UINT numTextures = static_cast<UINT>(m_textures.size());
+	archive << numTextures;
+	if(archive.IsLoading())
+	{
+		// Every texture stores at least its path length, anything larger is a corrupt count.
+		m_textures.resize(archive.HasBytes(static_cast<size_t>(numTextures) * sizeof(UINT)) ? numTextures : 0);
+	}
+	for (RevTexture& texture : m_textures)
+	{
+		archive << texture.m_path;
+		archive << texture.m_type;
+	}
+	m_animation.Serialize(archive);
+}
+
+/** Uploads the vertex, index and position streams of data. */
+void UploadGeometryStreams(const RevModelData& data, RevModelD3DData& returnData)
 {
-    RevModelD3DData returnData = {};
 	ID3D12Device5* device = RevEngineRetrievalFunctions::GetDevice();
 	returnData.m_vertexCount = data.GetNumVertexes();
 	returnData.m_vertexStride = data.GetVertexStride();
+	returnData.m_positionOffset = data.m_vertexStream.GetLayoutDesc().m_positionOffset;
+	returnData.m_positionFormat = data.m_vertexStream.GetLayoutDesc().m_positionFormat;
     if(returnData.m_vertexCount > 0)
     {
-        const UINT vertexBufferSize =  data.GetModelVertexSize();
-        // Note: using upload heaps to transfer static data like vert buffers is not
-        // recommended. Every time the GPU needs it, the upload heap will be
-        // marshalled over. Please read up on Default Heap usage. An upload heap is
-        // used here for code simplicity and because there are very few verts to
-        // actually transfer.
-        ThrowIfFailed(device->CreateCommittedResource(
-            // ReSharper disable once CppMsExtAddressOfClassRValue
-            &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD), D3D12_HEAP_FLAG_NONE,
-            // ReSharper disable once CppMsExtAddressOfClassRValue
-            &CD3DX12_RESOURCE_DESC::Buffer(vertexBufferSize),
-            D3D12_RESOURCE_STATE_GENERIC_READ, nullptr,
-            IID_PPV_ARGS(&returnData.m_vertexBuffer)));
-
-        // Copy the triangle data to the vertex buffer.
-        UINT8* pVertexDataBegin;
-        CD3DX12_RANGE readRange(
-            0, 0); // We do not intend to read from this resource on the CPU.
-        ThrowIfFailed(returnData.m_vertexBuffer->Map(
-            0, &readRange, reinterpret_cast<void**>(&pVertexDataBegin)));
-        memcpy(pVertexDataBegin, data.GetData(), vertexBufferSize);
-        returnData.m_vertexBuffer->Unmap(0, nullptr);
-
-        // Initialize the vertex buffer view.
-        returnData.m_vertexBufferView.BufferLocation = returnData.m_vertexBuffer->GetGPUVirtualAddress();
-        returnData.m_vertexBufferView.StrideInBytes = data.GetVertexStride();
-        returnData.m_vertexBufferView.SizeInBytes = vertexBufferSize;         
+        returnData.m_vertexRange = RevGeometryPool::Allocate(data.GetData(), returnData.m_vertexCount, returnData.m_vertexStride);
     }
-    if(data.m_indices.size() > 0)
+    if(data.GetNumIndices() > 0)
     {
         //----------------------------------------------------------------------------------------------
         // Indices
     	
-    	returnData.m_indexCount = data.m_indices.size();
-        const UINT indexBufferSize = static_cast<UINT>(returnData.m_indexCount) * sizeof(UINT);
-        CD3DX12_HEAP_PROPERTIES heapProperty = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
-        CD3DX12_RESOURCE_DESC bufferResource = CD3DX12_RESOURCE_DESC::Buffer(indexBufferSize);
-        ThrowIfFailed(device->CreateCommittedResource(
-            &heapProperty, D3D12_HEAP_FLAG_NONE, &bufferResource, //
-            D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&returnData.m_indexBuffer)));
-
-        // Copy the triangle data to the index buffer.
-        UINT8* pIndexDataBegin;
-        CD3DX12_RANGE readRange(
-        0, 0); // We do not intend to read from this resource on the CPU.
-        ThrowIfFailed(returnData.m_indexBuffer->Map(0, &readRange, reinterpret_cast<void**>(&pIndexDataBegin)));
-        memcpy(pIndexDataBegin, data.m_indices.data(), indexBufferSize);
-        returnData.m_indexBuffer->Unmap(0, nullptr);
-
-        // Initialize the index buffer view.
-        returnData.m_indexBufferView.BufferLocation = returnData.m_indexBuffer->GetGPUVirtualAddress();
-        returnData.m_indexBufferView.Format = DXGI_FORMAT_R32_UINT;
-        returnData.m_indexBufferView.SizeInBytes = indexBufferSize;
+    	returnData.m_indexCount = data.GetNumIndices();
+    	returnData.m_indexStride = data.GetIndexStride();
+    	returnData.m_indexFormat = data.GetIndexFormat();
+    	returnData.m_subMeshes = data.m_subMeshes;
+    	returnData.m_lods = data.m_lods;
+    	returnData.m_lodSubMeshes = data.m_lodSubMeshes;
+    	returnData.m_clusters = data.m_clusters;
+    	returnData.m_clusterGroups = data.m_clusterGroups;
+        returnData.m_indexRange = RevGeometryPool::Allocate(data.GetIndexData(), returnData.m_indexCount, returnData.m_indexStride);
     }
 
+	if(data.m_positions.size() > 0)
+	{
+		// Tightly packed float3 positions for depth-only passes and acceleration structure builds.
+		returnData.m_positionRange = RevGeometryPool::Allocate(
+			data.m_positions.data(), static_cast<UINT>(data.m_positions.size()), sizeof(XMFLOAT3));
+	}
+}
+
+/** Uploads the geometry of data. Streams a buffer view cannot address fail only this model, it keeps everything
+ *  else but draws and traces nothing. */
+void CreateGeometryBuffers(const RevModelData& data, RevModelD3DData& returnData)
+{
+	try
+	{
+		UploadGeometryStreams(data, returnData);
+	}
+	catch(const std::runtime_error& error)
+	{
+		char message[512];
+		sprintf_s(message, "RevModelD3DData: model loaded without geometry, %s\n", error.what());
+		OutputDebugStringA(message);
+		// Ranges uploaded before the failing one go back to the pool.
+		returnData.m_vertexRange.reset();
+		returnData.m_indexRange.reset();
+		returnData.m_positionRange.reset();
+		returnData.m_vertexCount = 0;
+		returnData.m_indexCount = 0;
+		returnData.m_subMeshes.clear();
+		returnData.m_lods.clear();
+		returnData.m_lodSubMeshes.clear();
+		returnData.m_clusters.clear();
+		returnData.m_clusterGroups.clear();
+	}
+	returnData.m_positionQuantization = data.m_positionQuantization;
+	if(data.m_vertexFormat == RevEVertexFormat::Packed && returnData.m_vertexCount > 0)
+	{
+		// The BLAS builder reads the snorm positions directly and applies the dequantization as its
+		// geometry transform, so both raster and ray tracing see the same positions.
+		const XMFLOAT3& center = data.m_positionQuantization.m_center;
+		const XMFLOAT3& extent = data.m_positionQuantization.m_extent;
+		const float transform[3][4] =
+		{
+			{ extent.x, 0.0f, 0.0f, center.x },
+			{ 0.0f, extent.y, 0.0f, center.y },
+			{ 0.0f, 0.0f, extent.z, center.z },
+		};
+		returnData.m_dequantizeTransform = RevGpuHeapAllocator::CreateSmallBuffer(
+			sizeof(transform), D3D12_HEAP_TYPE_UPLOAD, RevEMemoryTag::Models);
+		memcpy(returnData.m_dequantizeTransform->m_mapped, transform, sizeof(transform));
+	}
+}
+
+/** Points target at the geometry of source, the ranges are reference counted and live as long as either model. */
+void ShareGeometryBuffers(const RevModelD3DData& source, RevModelD3DData& target)
+{
+	target.m_vertexRange = source.m_vertexRange;
+	target.m_positionRange = source.m_positionRange;
+	target.m_indexRange = source.m_indexRange;
+	target.m_positionQuantization = source.m_positionQuantization;
+	target.m_dequantizeTransform = source.m_dequantizeTransform;
+	target.m_positionFormat = source.m_positionFormat;
+	target.m_positionOffset = source.m_positionOffset;
+	target.m_vertexCount = source.m_vertexCount;
+	target.m_indexCount = source.m_indexCount;
+	target.m_vertexStride = source.m_vertexStride;
+	target.m_indexStride = source.m_indexStride;
+	target.m_indexFormat = source.m_indexFormat;
+	target.m_subMeshes = source.m_subMeshes;
+	target.m_lods = source.m_lods;
+	target.m_lodSubMeshes = source.m_lodSubMeshes;
+	target.m_clusters = source.m_clusters;
+	target.m_clusterGroups = source.m_clusterGroups;
+}
+
+RevModelD3DData RevModelD3DData::Create(const RevModelData& data, const RevModelD3DData* sharedGeometry)
+{
+    RevModelD3DData returnData = {};
+	ID3D12Device5* device = RevEngineRetrievalFunctions::GetDevice();
+	if(sharedGeometry)
+	{
+		ShareGeometryBuffers(*sharedGeometry, returnData);
+	}
+	else
+	{
+		CreateGeometryBuffers(data, returnData);
+	}
+
 	//will be implemented later
-	CD3DX12_ROOT_PARAMETER slotRootParameter[1];
+	CD3DX12_ROOT_PARAMETER slotRootParameter[2];
     slotRootParameter[0].InitAsConstantBufferView(0);
+    slotRootParameter[1].InitAsConstants(sizeof(RevPositionQuantization) / sizeof(UINT), 1);
     RevUtils::CreateModelRootDescription(&slotRootParameter[0], ARRAYSIZE(slotRootParameter), returnData);
     {
     	RevPSOInitializationData initializationData = {};
     	initializationData.m_shader = RevEngineRetrievalFunctions::GetShaderManager()->GetShaderRasterizer(data.m_shaderPath);
-    	initializationData.m_inputLayoutData = data.m_inputLayout.data();
-    	initializationData.m_nInputLayout = data.m_inputLayout.size();
+    	const RevVertexLayoutDesc& layoutDesc = data.m_vertexStream.GetLayoutDesc();
+    	initializationData.m_inputLayoutData = layoutDesc.m_elements;
+    	initializationData.m_nInputLayout = layoutDesc.m_numElements;
     	initializationData.m_rootSignature = returnData.m_rootSignature.Get();
     	initializationData.m_pso= &returnData.m_pso;
     	initializationData.m_numRenderTargets = 4;
@@ -104,6 +204,22 @@ RevModelD3DData RevModelD3DData::Create(const RevModelData& data)
     	initializationData.m_rtvFormats = &formats[0];
     	RevUtils::CreatePSO(initializationData);	    
     }
+    if(returnData.m_positionRange)
+    {
+    	D3D12_INPUT_ELEMENT_DESC positionLayout[] =
+    	{
+    		RevMakeVertexElement<XMFLOAT3>("POSITION", 0),
+    	};
+    	RevPSOInitializationData initializationData = {};
+    	initializationData.m_shader = RevEngineRetrievalFunctions::GetShaderManager()->GetShaderRasterizer(L"Data//Shaders//DepthOnly.hlsl");
+    	initializationData.m_inputLayoutData = &positionLayout[0];
+    	initializationData.m_nInputLayout = ARRAYSIZE(positionLayout);
+    	initializationData.m_rootSignature = returnData.m_rootSignature.Get();
+    	initializationData.m_pso = &returnData.m_depthOnlyPso;
+    	initializationData.m_numRenderTargets = 0;
+    	initializationData.m_usePixelShader = false;
+    	RevUtils::CreatePSO(initializationData);
+    }
 
 	if(data.m_textures.size() > 0)
 	{
@@ -112,17 +228,11 @@ RevModelD3DData RevModelD3DData::Create(const RevModelData& data)
 		std::vector<ID3D12Resource*> resoures;
 		for (auto& texture : returnData.m_textures)
 		{
-			LoadTexture(texture.m_path, &texture.m_resource);
-			resoures.push_back(texture.m_resource);
+			LoadTexture(texture.m_path, texture.m_resource.ReleaseAndGetAddressOf());
+			resoures.push_back(texture.m_resource.Get());
 		}
 
-		D3D12_DESCRIPTOR_HEAP_DESC srvHeapDesc = {};
-		srvHeapDesc.NumDescriptors = resoures.size();
-		srvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
-		srvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
-		ThrowIfFailed(device->CreateDescriptorHeap(&srvHeapDesc, IID_PPV_ARGS(&returnData.m_descriptorHeap)));
-	
-		CD3DX12_CPU_DESCRIPTOR_HANDLE hDescriptor(returnData.m_descriptorHeap->GetCPUDescriptorHandleForHeapStart());
+		returnData.m_textureDescriptors = RevDescriptorHeap::AllocatePersistent(static_cast<UINT>(resoures.size()));
 		for (UINT i = 0; i < resoures.size(); i++)
 		{
 			ID3D12Resource* resource = resoures[i];
@@ -133,69 +243,166 @@ RevModelD3DData RevModelD3DData::Create(const RevModelData& data)
 			srvDesc.Texture2D.MostDetailedMip = 0;
 			srvDesc.Texture2D.MipLevels = resource->GetDesc().MipLevels;
 			srvDesc.Texture2D.ResourceMinLODClamp = 0.0f;
-			device->CreateShaderResourceView(resource, &srvDesc, hDescriptor);
-			hDescriptor.Offset(1, device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV));
+			device->CreateShaderResourceView(resource, &srvDesc, returnData.m_textureDescriptors->GetCpuHandle(i));
 		}
 	}
 
 	
     return returnData;
 }
-AccelerationStructureBuffers RevModelD3DData::CreateAccelerationStructure(const RevModelD3DData& inData)
+namespace
+{
+	/** One triangle range of a bottom level AS, at most REV_BLAS_MAX_TRIANGLES big. */
+	struct RevBlasGeometry
+	{
+		UINT64 m_vertexOffset = 0;
+		UINT m_vertexCount = 0;
+		UINT64 m_indexOffset = 0;
+		UINT m_indexCount = 0;
+	};
+}
+
+void RevModelD3DData::CreateAccelerationStructures(const RevModelD3DData& inData, UINT lod, std::vector<AccelerationStructureBuffers>& outBuffers)
 {
 	ID3D12Device5* device = RevEngineRetrievalFunctions::GetDevice();
 	ID3D12GraphicsCommandList4* list = RevEngineRetrievalFunctions::GetCommandList();
-    nv_helpers_dx12::BottomLevelASGenerator bottomLevelAS;
-	// Adding all vertex buffers and not transforming their position.
-	if(inData.m_vertexBuffer.Get() != nullptr)
+	// Adding all vertex buffers, preferring the position-only stream when the model has one.
+	const RevGeometryRange* positionRange = inData.m_vertexRange.get();
+	UINT positionOffset = inData.m_positionOffset;
+	UINT positionStride = inData.m_vertexStride;
+	DXGI_FORMAT positionFormat = inData.m_positionFormat;
+	ID3D12Resource* positionTransform = inData.m_dequantizeTransform ? inData.m_dequantizeTransform->m_buffer : nullptr;
+	UINT64 positionTransformOffset = inData.m_dequantizeTransform ? inData.m_dequantizeTransform->m_offset : 0;
+	if(inData.m_positionRange)
 	{
-		if(inData.m_indexBuffer.Get() != nullptr)
+		positionRange = inData.m_positionRange.get();
+		positionOffset = 0;
+		positionStride = sizeof(XMFLOAT3);
+		positionFormat = DXGI_FORMAT_R32G32B32_FLOAT;
+		positionTransform = nullptr;
+		positionTransformOffset = 0;
+	}
+	if(positionRange == nullptr)
+	{
+		return;
+	}
+	// Both ranges sit inside shared pool buffers, every offset below starts at the range.
+	ID3D12Resource* positionBuffer = positionRange->m_buffer;
+	const UINT64 vertexBase = positionRange->GetByteOffset() + positionOffset;
+
+	// Ranges larger than one BLAS get cut on triangle boundaries.
+	const UINT maxChunkIndices = REV_BLAS_MAX_TRIANGLES * 3;
+	std::vector<RevBlasGeometry> geometries;
+	const bool indexed = inData.m_indexRange != nullptr;
+	ID3D12Resource* indexBuffer = indexed ? inData.m_indexRange->m_buffer : nullptr;
+	const UINT64 indexBase = indexed ? inData.m_indexRange->GetByteOffset() : 0;
+	if(indexed && inData.m_subMeshes.size() > 0)
+	{
+		// One geometry per submesh, the submesh indices are relative to its base vertex.
+		const RevSubMesh* subMeshes = inData.GetLodSubMeshes(lod);
+		for (size_t subMeshIndex = 0; subMeshIndex < inData.m_subMeshes.size(); subMeshIndex++)
 		{
-			int numVertex = inData.m_vertexCount;
-			int numIndicies = inData.m_indexCount;
-			bottomLevelAS.AddVertexBuffer(inData.m_vertexBuffer.Get(), 0,
-                               numVertex, inData.m_vertexStride,
-                               inData.m_indexBuffer.Get(), 0,
-                               numIndicies, nullptr, 0, true);	
+			const RevSubMesh& subMesh = subMeshes[subMeshIndex];
+			for (UINT first = 0; first < subMesh.m_indexCount; first += maxChunkIndices)
+			{
+				RevBlasGeometry geometry;
+				geometry.m_vertexOffset = vertexBase + static_cast<UINT64>(subMesh.m_baseVertex) * positionStride;
+				geometry.m_vertexCount = subMesh.m_vertexCount;
+				geometry.m_indexOffset = indexBase + static_cast<UINT64>(subMesh.m_indexOffset + first) * inData.m_indexStride;
+				geometry.m_indexCount = min(maxChunkIndices, subMesh.m_indexCount - first);
+				geometries.push_back(geometry);
+			}
 		}
-		else
+	}
+	else
+	{
+		const UINT count = indexed ? inData.m_indexCount : inData.m_vertexCount;
+		for (UINT first = 0; first < count; first += maxChunkIndices)
 		{
-			int numVertex = inData.m_vertexCount;
-			bottomLevelAS.AddVertexBuffer(inData.m_vertexBuffer.Get(), 0,
-                                          numVertex, inData.m_vertexStride, 0,
-                                          0);
+			RevBlasGeometry geometry;
+			if(indexed)
+			{
+				geometry.m_vertexOffset = vertexBase;
+				geometry.m_vertexCount = inData.m_vertexCount;
+				geometry.m_indexOffset = indexBase + static_cast<UINT64>(first) * inData.m_indexStride;
+				geometry.m_indexCount = min(maxChunkIndices, count - first);
+			}
+			else
+			{
+				geometry.m_vertexOffset = vertexBase + static_cast<UINT64>(first) * positionStride;
+				geometry.m_vertexCount = min(maxChunkIndices, count - first);
+			}
+			geometries.push_back(geometry);
 		}
 	}
 
-	// The AS build requires some scratch space to store temporary information.
-	// The amount of scratch memory is dependent on the scene complexity.
-	UINT64 scratchSizeInBytes = 0;
-	// The final AS also needs to be stored in addition to the existing vertex
-	// buffers. It size is also dependent on the scene complexity.
-	UINT64 resultSizeInBytes = 0;
-
-	bottomLevelAS.ComputeASBufferSizes(device, false, &scratchSizeInBytes,
-	                                   &resultSizeInBytes);
-
-	// Once the sizes are obtained, the application is responsible for allocating
-	// the necessary buffers. Since the entire generation will be done on the GPU,
-	// we can directly allocate those on the default heap
-	AccelerationStructureBuffers buffers;
-	buffers.pScratch = nv_helpers_dx12::CreateBuffer(
-		device, scratchSizeInBytes,
-		D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COMMON,
-		nv_helpers_dx12::kDefaultHeapProps);
-	buffers.pResult = nv_helpers_dx12::CreateBuffer(
-		device, resultSizeInBytes,
-		D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS,
-		D3D12_RESOURCE_STATE_RAYTRACING_ACCELERATION_STRUCTURE,
-		nv_helpers_dx12::kDefaultHeapProps);
-
-	// Build the acceleration structure. Note that this call integrates a barrier
-	// on the generated AS, so that it can be used to compute a top-level AS right
-	// after this method.
-	bottomLevelAS.Generate(list, buffers.pScratch.Get(),
-	                       buffers.pResult.Get(), false, nullptr);
-
-	return buffers;
+	// Consecutive geometries share a BLAS until it holds REV_BLAS_MAX_TRIANGLES.
+	for (size_t first = 0; first < geometries.size();)
+	{
+		nv_helpers_dx12::BottomLevelASGenerator bottomLevelAS;
+		UINT triangles = 0;
+		size_t next = first;
+		for (; next < geometries.size(); next++)
+		{
+			const RevBlasGeometry& geometry = geometries[next];
+			const UINT geometryTriangles = (indexed ? geometry.m_indexCount : geometry.m_vertexCount) / 3;
+			if(next > first && triangles + geometryTriangles > REV_BLAS_MAX_TRIANGLES)
+			{
+				break;
+			}
+			triangles += geometryTriangles;
+			if(indexed)
+			{
+				bottomLevelAS.AddVertexBuffer(positionBuffer, geometry.m_vertexOffset,
+                               geometry.m_vertexCount, positionStride,
+                               indexBuffer, geometry.m_indexOffset,
+                               geometry.m_indexCount, positionTransform, positionTransformOffset, true,
+                               positionFormat, inData.m_indexFormat);
+			}
+			else
+			{
+				bottomLevelAS.AddVertexBuffer(positionBuffer, geometry.m_vertexOffset,
+                                          geometry.m_vertexCount, positionStride,
+                                          positionTransform, positionTransformOffset, true,
+                                          positionFormat);
+			}
+		}
+		first = next;
+
+		// The AS build requires some scratch space to store temporary information.
+		// The amount of scratch memory is dependent on the scene complexity.
+		UINT64 scratchSizeInBytes = 0;
+		// The final AS also needs to be stored in addition to the existing vertex
+		// buffers. It size is also dependent on the scene complexity.
+		UINT64 resultSizeInBytes = 0;
+
+		bottomLevelAS.ComputeASBufferSizes(device, false, &scratchSizeInBytes,
+		                                   &resultSizeInBytes);
+
+		// Once the sizes are obtained, the application is responsible for allocating
+		// the necessary buffers. Since the entire generation will be done on the GPU,
+		// we can directly allocate those on the default heap
+		AccelerationStructureBuffers buffers;
+		buffers.pScratch = RevGpuHeapAllocator::CreateBuffer(
+			scratchSizeInBytes,
+			D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COMMON,
+			D3D12_HEAP_TYPE_DEFAULT);
+		buffers.pResult = RevGpuHeapAllocator::CreateBuffer(
+			resultSizeInBytes,
+			D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS,
+			D3D12_RESOURCE_STATE_RAYTRACING_ACCELERATION_STRUCTURE,
+			D3D12_HEAP_TYPE_DEFAULT);
+		RevMemoryTracker::TrackResource(RevEMemoryTag::AccelerationStructures, buffers.pScratch.Get());
+		RevMemoryTracker::TrackResource(RevEMemoryTag::AccelerationStructures, buffers.pResult.Get());
+
+		// Build the acceleration structure. Note that this call integrates a barrier
+		// on the generated AS, so that it can be used to compute a top-level AS right
+		// after this method.
+		bottomLevelAS.Generate(list, buffers.pScratch.Get(),
+		                       buffers.pResult.Get(), false, nullptr);
+		// Nothing refits the BLAS, the scratch memory goes back once the build ran.
+		RevDeferredRelease::Release(buffers.pScratch);
+		buffers.pScratch.Reset();
+		outBuffers.push_back(buffers);
+	}
 }
@@ -1,7 +1,13 @@
 ﻿#pragma once
 
+#include "../Core/RevAnimationTypes.h"
 #include "../Core/RevCoreDefines.h"
+#include "../Core/RevDescriptorHeap.h"
+#include "../Core/RevGeometryPool.h"
+#include "../Core/RevGpuHeapAllocator.h"
+#include "../Core/RevLoadStatistics.h"
 #include "../Core/RevModelTypes.h"
+#include "../Core/RevVertexFormat.h"
 
 using Microsoft::WRL::ComPtr;
 
@@ -31,90 +37,114 @@ struct RevTexture
         m_type = type;
     }
     std::wstring m_path;
-    ID3D12Resource* m_resource = nullptr;
+    ComPtr<ID3D12Resource> m_resource;
     RevTextureType m_type;
 };
 
+/** CPU side model, move only so the geometry is never copied on its way from the loader to the GPU upload. */
 struct RevModelData
 {
-    std::vector<RevVertexPosCol> m_vertexes;
-    std::vector<RevVertexPosTexNormBiTan> m_staticVertexes;
-    std::vector<UINT> m_indices;
+    RevModelData() = default;
+    RevModelData(const RevModelData&) = delete;
+    RevModelData& operator=(const RevModelData&) = delete;
+    RevModelData(RevModelData&&) = default;
+    RevModelData& operator=(RevModelData&&) = default;
+
+    RevVertexStream m_vertexStream;
+    RevGeometryVector<DirectX::XMFLOAT3> m_positions;
+    RevGeometryVector<UINT> m_indices;
+    RevGeometryVector<UINT16> m_shortIndices;
+    std::vector<RevSubMesh> m_subMeshes;
+    std::vector<RevModelLod> m_lods;
+    std::vector<RevSubMesh> m_lodSubMeshes;
+    std::vector<RevCluster> m_clusters;
+    std::vector<RevClusterGroup> m_clusterGroups;
+    std::vector<RevClusterPage> m_clusterPages;
+    std::vector<RevMeshlet> m_meshlets;
+    std::vector<UINT> m_meshletVertexes;
+    std::vector<UINT8> m_meshletTriangles;
     std::vector<RevTexture> m_textures;
     std::wstring m_shaderPath;
-    std::vector<D3D12_INPUT_ELEMENT_DESC> m_inputLayout;
+    // Skeleton, clips and skin weights of ModelAnimated models.
+    RevAnimationData m_animation;
     RevEModelType m_type = RevEModelType::Invalid;
-    
-    int GetModelIndexSize() const { return m_indices.size() * sizeof(UINT); }
-    
-    int GetModelVertexSize() const
-    {
-        return GetNumVertexes() * GetVertexStride();
-    }
-    int GetNumVertexes() const
-    {
-        if(m_vertexes.size() > 0)
-        {
-            return m_vertexes.size();   
-        }
-        else
-        {
-           return m_staticVertexes.size();   
-        }
-    }
-    int GetVertexStride() const
-    {
-        if(m_vertexes.size() > 0)
-        {
-           return sizeof(RevVertexPosCol);   
-        }
-        else
-        {
-           return sizeof(RevVertexPosTexNormBiTan);   
-        }
-    }
+    RevEVertexFormat m_vertexFormat = RevEVertexFormat::Full;
+    RevPositionQuantization m_positionQuantization = {};
+    RevBounds m_bounds;
+    // Hash of the imported vertex and index bytes, 0 when not computed. Models with equal hashes and identical
+    // geometry share GPU buffers and BLAS, see RevModelManager::FindGeometrySourceInternal.
+    UINT64 m_geometryHash = 0;
 
-    void* GetData()
-    {
-        if(m_vertexes.size() > 0)
-        {
-            return m_vertexes.data();   
-        }
-        else
-        {
-            return m_staticVertexes.data();   
-        }
-    }
+    /** Saves or loads the cooked data, the position stream and shader path are rebuilt after loading.
+     *  The input layout always comes from m_vertexStream. */
+    void Serialize(class RevArchive& archive);
     
-    const void* GetData() const
+    // Sizes are 64 bit, count * stride of a large mesh does not fit 32 bits.
+    UINT64 GetModelIndexSize() const { return static_cast<UINT64>(GetNumIndices()) * GetIndexStride(); }
+    UINT GetNumIndices() const { return static_cast<UINT>(m_shortIndices.size() > 0 ? m_shortIndices.size() : m_indices.size()); }
+    UINT GetIndexStride() const { return m_shortIndices.size() > 0 ? sizeof(UINT16) : sizeof(UINT); }
+    DXGI_FORMAT GetIndexFormat() const { return m_shortIndices.size() > 0 ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT; }
+    const void* GetIndexData() const
     {
-        if(m_vertexes.size() > 0)
-        {
-            return m_vertexes.data();   
-        }
-        else
+        if(m_shortIndices.size() > 0)
         {
-            return m_staticVertexes.data();   
+            return m_shortIndices.data();
         }
+        return m_indices.data();
     }
+    
+    UINT64 GetModelVertexSize() const { return m_vertexStream.GetSize(); }
+    UINT GetNumVertexes() const { return m_vertexStream.GetCount(); }
+    UINT GetVertexStride() const { return m_vertexStream.GetStride(); }
+    const void* GetData() const { return m_vertexStream.GetData(); }
 };
 
 struct RevModelD3DData
 {
-    ComPtr<ID3D12Resource> m_vertexBuffer;
-    D3D12_VERTEX_BUFFER_VIEW m_vertexBufferView;
-    ComPtr<ID3D12Resource> m_indexBuffer;
-    D3D12_INDEX_BUFFER_VIEW m_indexBufferView;
+    // Ranges of the shared RevGeometryPool buffers, their m_first is the base vertex or start index of every draw.
+    std::shared_ptr<const RevGeometryRange> m_vertexRange;
+    std::shared_ptr<const RevGeometryRange> m_positionRange;
+    std::shared_ptr<const RevGeometryRange> m_indexRange;
     ComPtr<ID3D12RootSignature> m_rootSignature;
     std::vector<RevTexture> m_textures;
-    ComPtr<ID3D12DescriptorHeap> m_descriptorHeap;
+    // Texture SRVs in the shared RevDescriptorHeap, in m_textures order.
+    std::shared_ptr<const RevDescriptorRange> m_textureDescriptors;
     ID3D12PipelineState* m_pso;
+    ID3D12PipelineState* m_depthOnlyPso = nullptr;
+
+    // Packed models decode positions with these, the BLAS gets the same mapping as a 3x4 transform.
+    RevPositionQuantization m_positionQuantization = {};
+    std::shared_ptr<const RevGpuBufferRange> m_dequantizeTransform;
+    DXGI_FORMAT m_positionFormat = DXGI_FORMAT_R32G32B32_FLOAT;
+    // Position offset inside a vertex of m_vertexRange.
+    UINT m_positionOffset = 0;
     
     
-    int m_vertexCount = REV_INDEX_NONE;
-    int m_indexCount = REV_INDEX_NONE;
-    int m_vertexStride = REV_INDEX_NONE;
+    UINT m_vertexCount = 0;
+    UINT m_indexCount = 0;
+    UINT m_vertexStride = 0;
+    UINT m_indexStride = 0;
+    DXGI_FORMAT m_indexFormat = DXGI_FORMAT_R32_UINT;
+    std::vector<RevSubMesh> m_subMeshes;
+    std::vector<RevModelLod> m_lods;
+    std::vector<RevSubMesh> m_lodSubMeshes;
+    std::vector<RevCluster> m_clusters;
+    std::vector<RevClusterGroup> m_clusterGroups;
+
+    UINT GetNumLods() const { return m_lods.size() > 0 ? static_cast<UINT>(m_lods.size()) : 1; }
+    /** m_subMeshes.size() ranges to draw for the level. */
+    const RevSubMesh* GetLodSubMeshes(UINT lod) const
+    {
+        if(lod == 0 || lod >= m_lods.size())
+        {
+            return m_subMeshes.data();
+        }
+        return &m_lodSubMeshes[m_lods[lod].m_subMeshOffset];
+    }
 
-    static RevModelD3DData Create(const RevModelData& data);
-    static AccelerationStructureBuffers CreateAccelerationStructure(const RevModelD3DData& inData); 
+    /** Uploads data, or takes the vertex, index and position ranges of sharedGeometry when given so only the
+     *  material side (pso, textures) is created. */
+    static RevModelD3DData Create(const RevModelData& data, const RevModelD3DData* sharedGeometry = nullptr);
+    /** Appends the bottom level AS of the lod, one per REV_BLAS_MAX_TRIANGLES so large meshes build in bounded chunks. */
+    static void CreateAccelerationStructures(const RevModelD3DData& inData, UINT lod, std::vector<AccelerationStructureBuffers>& outBuffers);
 };
\ No newline at end of file
@@ -59,5 +59,12 @@ struct RevEngineInitializationData
 
 struct RevDrawData
 {
-     ComPtr<ID3D12Resource> m_cameraCB;
+     D3D12_GPU_VIRTUAL_ADDRESS m_cameraCB = 0;
+     // LOD selection, m_lodScale is the pixels covered by one unit at distance one (0 always draws full detail).
+     DirectX::XMFLOAT3 m_viewPosition = { 0.0f, 0.0f, 0.0f };
+     float m_lodScale = 0.0f;
+     float m_lodPixelError = 1.0f;
+     // World space planes facing into the view frustum, instances outside are skipped when m_frustumCulling is set.
+     DirectX::XMFLOAT4 m_frustumPlanes[6] = {};
+     bool m_frustumCulling = false;
 };
\ No newline at end of file
@@ -17,11 +17,19 @@
 #include "RaytracingPipelineGenerator.h"
 #include "RootSignatureGenerator.h"
 #include "Windowsx.h"
+#include "Core/RevFrameArena.h"
+#include "Core/RevDeferredRelease.h"
+#include "Core/RevDescriptorHeap.h"
+#include "Core/RevGeometryPool.h"
+#include "Core/RevGpuHeapAllocator.h"
 #include "Core/RevInstanceManager.h"
+#include "Core/RevJobSystem.h"
+#include "Core/RevMemoryTracker.h"
 #include "Core/RevModelManager.h"
 #include "Core/RevModelTypes.h"
 #include "Core/RevScene.h"
 #include "Core/RevShaderManager.h"
+#include "Core/RevStagingUpload.h"
 
 RevEngineMain* RevEngineMain::s_instance = nullptr;
 
@@ -63,7 +71,11 @@ RevEngineMain* RevEngineMain::Get()
 
 void RevEngineMain::OnInit()
 {	
+	// Going past the arena means frame scratch spills to the heap.
+	RevMemoryTracker::SetBudget(RevEMemoryTag::Frame, REV_FRAME_ARENA_SIZE * FrameCount, 0);
+	RevFrameArena::Initialize(REV_FRAME_ARENA_SIZE, FrameCount);
 	LoadPipeline();
+	RevDescriptorHeap::Initialize(REV_DESCRIPTOR_HEAP_PERSISTENT_COUNT, REV_DESCRIPTOR_HEAP_TRANSIENT_COUNT, FrameCount);
 	LoadAssets();
 	CheckRaytracingSupport();
 	
@@ -77,6 +89,7 @@ void RevEngineMain::OnInit()
 	CreateShaderBindingTable();
 	m_camera.Update(0.0f, m_input);
 	UpdateCameraBuffer();
+	RevMemoryTracker::DumpSnapshot(REV_MEMORY_SNAPSHOT_PATH, "Loaded");
 }
 
 // Load the rendering pipeline dependencies.
@@ -279,8 +292,26 @@ void RevEngineMain::LoadAssets()
 // Update frame-based values.
 void RevEngineMain::OnUpdate(float delta)
 {
+	// The previous frame finished on the GPU in OnRender, its scratch memory is free again.
+	RevFrameArena::BeginFrame(m_frameIndex);
+	RevDescriptorHeap::BeginFrame(m_frameIndex);
+	RevMemoryTracker::BeginFrame();
+#if defined(_DEBUG)
+	// Frame scratch overflowing the arena means REV_FRAME_ARENA_SIZE is too small for the scene. Only arena requests
+	// are checked, other heap allocations of the frame go unnoticed.
+	assert(RevFrameArena::GetLastFrameStatistics().m_overflowAllocations == 0);
+#endif
 	UpdateInput(delta);
 	UpdateCameraBuffer();
+	if (m_scene)
+	{
+		// Animation LOD uses the same view as drawing, so culled instances are not skinned either.
+		RevDrawData viewData = {};
+		XMStoreFloat3(&viewData.m_viewPosition, m_camera.m_worldLoc);
+		viewData.m_lodScale = m_camera.GetLodScale(GetHeight());
+		viewData.m_frustumCulling = m_camera.GetFrustumPlanes(viewData.m_frustumPlanes);
+		m_scene->Update(delta, viewData);
+	}
 }
 
 // Render the scene.
@@ -289,12 +320,17 @@ void RevEngineMain::OnRender()
 	// Record all the commands we need to render the scene into the command list.
 	PopulateCommandList();
 
+	// Geometry loaded since the last frame is copied first, on the same queue, so the frame sees it.
+	RevStagingUpload::Submit();
+
 	// Execute the command list.
 	ID3D12CommandList* ppCommandLists[] = {m_commandList.Get()};
 	m_commandQueue->ExecuteCommandLists(_countof(ppCommandLists), ppCommandLists);
 
 	// Present the frame.
 	ThrowIfFailed(m_swapChain->Present(1, 0));
+	// Objects released until now are freed once the GPU finished this frame.
+	RevDeferredRelease::Update();
 
 	WaitForPreviousFrame();
 }
@@ -305,7 +341,15 @@ void RevEngineMain::OnDestroy()
 	// cleaned up by the destructor.
 	WaitForPreviousFrame();
 
+	RevMemoryTracker::DumpSnapshot(REV_MEMORY_SNAPSHOT_PATH, "Shutdown");
 	CloseHandle(m_fenceEvent);
+	RevJobSystem::Shutdown();
+	RevStagingUpload::Shutdown();
+	RevDeferredRelease::Shutdown();
+	RevGeometryPool::Shutdown();
+	RevGpuHeapAllocator::Shutdown();
+	RevDescriptorHeap::Shutdown();
+	RevFrameArena::Shutdown();
 }
 
 void RevEngineMain::PopulateCommandList() const
@@ -321,7 +365,8 @@ void RevEngineMain::PopulateCommandList() const
 	ThrowIfFailed(
 		m_commandList->Reset(m_commandAllocator.Get(), m_pipelineState.Get()));
 
-	// Set necessary state.
+	// Set necessary state. Every draw and dispatch uses the one shader visible heap, it is never switched.
+	RevDescriptorHeap::Bind(m_commandList.Get());
 	m_commandList->SetGraphicsRootSignature(m_rootSignature.Get());
 	m_commandList->RSSetViewports(1, &m_viewport);
 	m_commandList->RSSetScissorRects(1, &m_scissorRect);
@@ -345,29 +390,23 @@ void RevEngineMain::PopulateCommandList() const
 	{
 		// #DXR Extra: Depth Buffering
 		m_commandList->ClearDepthStencilView(dsvHandle, D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0, 0, nullptr);
-		std::vector< ID3D12DescriptorHeap* > heaps = { m_constHeap.Get() };
-		m_commandList->SetDescriptorHeaps(static_cast<UINT>(heaps.size()), heaps.data());
-		// set the root descriptor table 0 to the constant buffer descriptor heap
+		// set the root descriptor table 0 to the camera constant buffer descriptor
 		m_commandList->SetGraphicsRootDescriptorTable(
-          0, m_constHeap->GetGPUDescriptorHandleForHeapStart());
+          0, m_cameraDescriptor->GetGpuHandle());
 
 		
 		const float clearColor[] = {0.0f, 0.2f, 0.4f, 1.0f};
 		m_commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 		m_commandList->ClearRenderTargetView(rtvHandle, clearColor, 0, nullptr);
 		RevDrawData drawData = {};
-		drawData.m_cameraCB = m_cameraBuffer.Get();
+		drawData.m_cameraCB = m_cameraBuffer->GetGpuAddress();
+		XMStoreFloat3(&drawData.m_viewPosition, m_camera.m_worldLoc);
+		drawData.m_lodScale = m_camera.GetLodScale(GetHeight());
+		drawData.m_frustumCulling = m_camera.GetFrustumPlanes(drawData.m_frustumPlanes);
 		m_scene->DrawScene(drawData);
 	}
 	else
 	{
-		// #DXR
-		// Bind the descriptor heap giving access to the top-level acceleration
-		// structure, as well as the raytracing output
-		std::vector<ID3D12DescriptorHeap*> heaps = {m_srvUavHeap.Get()};
-		m_commandList->SetDescriptorHeaps(static_cast<UINT>(heaps.size()),
-		                                  heaps.data());
-
 		// On the last frame, the raytracing output was used as a copy source, to
 		// copy its contents into the render target. Now we need to transition it to
 		// a UAV so that the shaders can write in it.
@@ -426,14 +465,17 @@ void RevEngineMain::PopulateCommandList() const
 		// UAV to a copy source, and the render target buffer to a copy destination.
 		// We can then do the actual copy, before transitioning the render target
 		// buffer into a render target, that will be then used to display the image
-		transition = CD3DX12_RESOURCE_BARRIER::Transition(
-			m_outputResource.Get(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
-			D3D12_RESOURCE_STATE_COPY_SOURCE);
-		m_commandList->ResourceBarrier(1, &transition);
-		transition = CD3DX12_RESOURCE_BARRIER::Transition(
-			m_renderTargets[m_frameIndex].Get(), D3D12_RESOURCE_STATE_RENDER_TARGET,
-			D3D12_RESOURCE_STATE_COPY_DEST);
-		m_commandList->ResourceBarrier(1, &transition);
+		// Both transitions go in one batch so the GPU only synchronizes once.
+		const CD3DX12_RESOURCE_BARRIER copyTransitions[] =
+		{
+			CD3DX12_RESOURCE_BARRIER::Transition(
+				m_outputResource.Get(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
+				D3D12_RESOURCE_STATE_COPY_SOURCE),
+			CD3DX12_RESOURCE_BARRIER::Transition(
+				m_renderTargets[m_frameIndex].Get(), D3D12_RESOURCE_STATE_RENDER_TARGET,
+				D3D12_RESOURCE_STATE_COPY_DEST)
+		};
+		m_commandList->ResourceBarrier(_countof(copyTransitions), copyTransitions);
 
 		m_commandList->CopyResource(m_renderTargets[m_frameIndex].Get(),
 		                            m_outputResource.Get());
@@ -553,7 +595,11 @@ void RevEngineMain::UpdateInput(float delta)
 void RevEngineMain::CreateTopLevelAS()
 {
 	// Gather all the instances into the builder helper
-	m_scene->m_instanceManager->AddAllInstancesToSBT(&m_topLevelASGenerator);
+	// Instances reference the BLAS of the LOD they would be drawn with from the current camera.
+	RevDrawData lodData = {};
+	XMStoreFloat3(&lodData.m_viewPosition, m_camera.m_worldLoc);
+	lodData.m_lodScale = m_camera.GetLodScale(GetHeight());
+	m_scene->m_instanceManager->AddAllInstancesToSBT(&m_topLevelASGenerator, lodData);
 
 	// As for the bottom-level AS, the building the AS requires some scratch space
 	// to store temporary data in addition to the actual AS. In the case of the
@@ -568,21 +614,24 @@ void RevEngineMain::CreateTopLevelAS()
 
 	// Create the scratch and result buffers. Since the build is all done on GPU,
 	// those can be allocated on the default heap
-	m_topLevelASBuffers.pScratch = nv_helpers_dx12::CreateBuffer(
-		m_device.Get(), scratchSize, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS,
+	m_topLevelASBuffers.pScratch = RevGpuHeapAllocator::CreateBuffer(
+		scratchSize, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS,
 		D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
-		nv_helpers_dx12::kDefaultHeapProps);
-	m_topLevelASBuffers.pResult = nv_helpers_dx12::CreateBuffer(
-		m_device.Get(), resultSize, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS,
+		D3D12_HEAP_TYPE_DEFAULT);
+	m_topLevelASBuffers.pResult = RevGpuHeapAllocator::CreateBuffer(
+		resultSize, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS,
 		D3D12_RESOURCE_STATE_RAYTRACING_ACCELERATION_STRUCTURE,
-		nv_helpers_dx12::kDefaultHeapProps);
+		D3D12_HEAP_TYPE_DEFAULT);
+	RevMemoryTracker::TrackResource(RevEMemoryTag::AccelerationStructures, m_topLevelASBuffers.pScratch.Get());
+	RevMemoryTracker::TrackResource(RevEMemoryTag::AccelerationStructures, m_topLevelASBuffers.pResult.Get());
 
 	// The buffer describing the instances: ID, shader binding information,
 	// matrices ... Those will be copied into the buffer by the helper through
 	// mapping, so the buffer has to be allocated on the upload heap.
-	m_topLevelASBuffers.pInstanceDesc = nv_helpers_dx12::CreateBuffer(
-		m_device.Get(), instanceDescSize, D3D12_RESOURCE_FLAG_NONE,
-		D3D12_RESOURCE_STATE_GENERIC_READ, nv_helpers_dx12::kUploadHeapProps);
+	m_topLevelASBuffers.pInstanceDesc = RevGpuHeapAllocator::CreateBuffer(
+		instanceDescSize, D3D12_RESOURCE_FLAG_NONE,
+		D3D12_RESOURCE_STATE_GENERIC_READ, D3D12_HEAP_TYPE_UPLOAD);
+	RevMemoryTracker::TrackResource(RevEMemoryTag::AccelerationStructures, m_topLevelASBuffers.pInstanceDesc.Get());
 
 	// After all the buffers are allocated, or if only an update is required, we
 	// can build the acceleration structure. Note that in the case of the update
@@ -592,6 +641,9 @@ void RevEngineMain::CreateTopLevelAS()
 	                               m_topLevelASBuffers.pScratch.Get(),
 	                               m_topLevelASBuffers.pResult.Get(),
 	                               m_topLevelASBuffers.pInstanceDesc.Get());
+	// The TLAS is built once, its scratch memory goes back once the build ran.
+	RevDeferredRelease::Release(m_topLevelASBuffers.pScratch);
+	m_topLevelASBuffers.pScratch.Reset();
 }
 
 void RevEngineMain::CreateAccelerationStructures()
@@ -599,11 +651,12 @@ void RevEngineMain::CreateAccelerationStructures()
 	m_scene = new RevScene();
 	m_scene->Initialize();
 	
-	RevModelManager::GenerateAccelerationBuffersAllModels();
-	
-	// Build the bottom AS from the Triangle vertex buffer
+	// The bottom AS of every LOD an instance traces is built while the top AS gathers its instances.
 	CreateTopLevelAS();
 
+	// The BLAS builds read the geometry the scene just loaded.
+	RevStagingUpload::Submit();
+
 	// Flush the command list and wait for it to finish
 	m_commandList->Close();
 	ID3D12CommandList* ppCommandLists[] = {m_commandList.Get()};
@@ -717,6 +770,7 @@ void RevEngineMain::CreateRaytracingOutputBuffer()
 		&nv_helpers_dx12::kDefaultHeapProps, D3D12_HEAP_FLAG_NONE, &resDesc,
 		D3D12_RESOURCE_STATE_COPY_SOURCE, nullptr,
 		IID_PPV_ARGS(&m_outputResource)));
+	RevMemoryTracker::TrackResource(RevEMemoryTag::Frame, m_outputResource.Get());
 }
 
 //-----------------------------------------------------------------------------
@@ -726,13 +780,11 @@ void RevEngineMain::CreateRaytracingOutputBuffer()
 //
 void RevEngineMain::CreateShaderResourceHeap()
 {
-	m_srvUavHeap = nv_helpers_dx12::CreateDescriptorHeap(
-		m_device.Get(), 3, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, true);
+	m_rayTracingDescriptors = RevDescriptorHeap::AllocatePersistent(3);
 
 	// Get a handle to the heap memory on the CPU side, to be able to write the
 	// descriptors directly
-	D3D12_CPU_DESCRIPTOR_HANDLE srvHandle =
-		m_srvUavHeap->GetCPUDescriptorHandleForHeapStart();
+	D3D12_CPU_DESCRIPTOR_HANDLE srvHandle = m_rayTracingDescriptors->GetCpuHandle();
 
 	// Create the UAV. Based on the root signature we created it is the first
 	// entry. The Create*View methods write the view information directly into
@@ -761,7 +813,7 @@ void RevEngineMain::CreateShaderResourceHeap()
 
 	// Describe and create a constant buffer view for the camera
 	D3D12_CONSTANT_BUFFER_VIEW_DESC cbvDesc = {};
-	cbvDesc.BufferLocation = m_cameraBuffer->GetGPUVirtualAddress();
+	cbvDesc.BufferLocation = m_cameraBuffer->GetGpuAddress();
 	cbvDesc.SizeInBytes = m_cameraBufferSize;
 	m_device->CreateConstantBufferView(&cbvDesc, srvHandle);
 	
@@ -785,7 +837,7 @@ void RevEngineMain::CreateShaderBindingTable()
 	// The pointer to the beginning of the heap is the only parameter required by
 	// shaders without root parameters
 	const D3D12_GPU_DESCRIPTOR_HANDLE srvUavHeapHandle =
-		m_srvUavHeap->GetGPUDescriptorHandleForHeapStart();
+		m_rayTracingDescriptors->GetGpuHandle();
 
 	// The helper treats both root parameter pointers and heap pointers as void*,
 	// while DX12 uses the
@@ -812,7 +864,7 @@ void RevEngineMain::CreateShaderBindingTable()
 	{
 		m_sbtHelper.AddHitGroup(
             L"HitGroup",
-            {reinterpret_cast<void*>(m_perInstanceConstantBuffers[i]->GetGPUVirtualAddress())
+            {reinterpret_cast<void*>(m_perInstanceConstantBuffers[i]->GetGpuAddress())
             });
 	}
 
@@ -832,13 +884,14 @@ void RevEngineMain::CreateShaderBindingTable()
 	// Create the SBT on the upload heap. This is required as the helper will use
 	// mapping to write the SBT contents. After the SBT compilation it could be
 	// copied to the default heap for performance.
-	m_sbtStorage = nv_helpers_dx12::CreateBuffer(
-		m_device.Get(), sbtSize, D3D12_RESOURCE_FLAG_NONE,
-		D3D12_RESOURCE_STATE_GENERIC_READ, nv_helpers_dx12::kUploadHeapProps);
+	m_sbtStorage = RevGpuHeapAllocator::CreateBuffer(
+		sbtSize, D3D12_RESOURCE_FLAG_NONE,
+		D3D12_RESOURCE_STATE_GENERIC_READ, D3D12_HEAP_TYPE_UPLOAD);
 	if (!m_sbtStorage)
 	{
 		throw std::logic_error("Could not allocate the shader binding table");
 	}
+	RevMemoryTracker::TrackResource(RevEMemoryTag::Shaders, m_sbtStorage.Get());
 	// Compile the SBT from the shader and parameters info
 	m_sbtHelper.Generate(m_sbtStorage.Get(), m_rtStateObjectProps.Get());
 }
@@ -857,23 +910,21 @@ void RevEngineMain::CreateCameraBuffer() {
 	m_cameraBufferSize = nbMatrix * sizeof(XMMATRIX);
 
 	// Create the constant buffer for all matrices
-	m_cameraBuffer = nv_helpers_dx12::CreateBuffer(
-        m_device.Get(), m_cameraBufferSize, D3D12_RESOURCE_FLAG_NONE,
-        D3D12_RESOURCE_STATE_GENERIC_READ, nv_helpers_dx12::kUploadHeapProps);
+	m_cameraBuffer = RevGpuHeapAllocator::CreateSmallBuffer(
+        m_cameraBufferSize, D3D12_HEAP_TYPE_UPLOAD, RevEMemoryTag::Scene);
 
-	// Create a descriptor heap that will be used by the rasterization shaders
-	m_constHeap = nv_helpers_dx12::CreateDescriptorHeap(
-        m_device.Get(), 1, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, true);
+	// Create a descriptor that will be used by the rasterization shaders
+	m_cameraDescriptor = RevDescriptorHeap::AllocatePersistent(1);
 
 	// Describe and create the constant buffer view.
 	D3D12_CONSTANT_BUFFER_VIEW_DESC cbvDesc = {};
-	cbvDesc.BufferLocation = m_cameraBuffer->GetGPUVirtualAddress();
+	cbvDesc.BufferLocation = m_cameraBuffer->GetGpuAddress();
 	cbvDesc.SizeInBytes = m_cameraBufferSize;
 
 	// Get a handle to the heap memory on the CPU side, to be able to write the
 	// descriptors directly
 	const D3D12_CPU_DESCRIPTOR_HANDLE srvHandle =
-        m_constHeap->GetCPUDescriptorHandleForHeapStart();
+        m_cameraDescriptor->GetCpuHandle();
 	m_device->CreateConstantBufferView(&cbvDesc, srvHandle);
 }
 
@@ -884,10 +935,7 @@ void RevEngineMain::CreateCameraBuffer() {
 void RevEngineMain::UpdateCameraBuffer()
 {
 	// Copy the matrix contents
-	uint8_t *pData;
-	ThrowIfFailed(m_cameraBuffer->Map(0, nullptr, (void **)&pData));
-	memcpy(pData, m_camera.m_matrices.data(), m_cameraBufferSize);
-	m_cameraBuffer->Unmap(0, nullptr);
+	memcpy(m_cameraBuffer->m_mapped, m_camera.m_matrices.data(), m_cameraBufferSize);
 	
 }
 
@@ -920,13 +968,8 @@ void RevEngineMain::CreatePerInstanceConstantBuffers()
 	for (auto& cb : m_perInstanceConstantBuffers)
 	{
 		const uint32_t bufferSize = sizeof(XMVECTOR) * 3;
-		cb = nv_helpers_dx12::CreateBuffer(m_device.Get(), bufferSize, D3D12_RESOURCE_FLAG_NONE,
-                                           D3D12_RESOURCE_STATE_GENERIC_READ,
-                                           nv_helpers_dx12::kUploadHeapProps);
-		uint8_t* pData;
-		ThrowIfFailed(cb->Map(0, nullptr, (void**)&pData));
-		memcpy(pData, &bufferData[i * 3], bufferSize);
-		cb->Unmap(0, nullptr);
+		cb = RevGpuHeapAllocator::CreateSmallBuffer(bufferSize, D3D12_HEAP_TYPE_UPLOAD, RevEMemoryTag::Scene);
+		memcpy(cb->m_mapped, &bufferData[i * 3], bufferSize);
 		++i;
 	}
 }
@@ -952,6 +995,7 @@ void RevEngineMain::CreateDepthBuffer()
 	ThrowIfFailed(m_device->CreateCommittedResource(
       &depthHeapProperties, D3D12_HEAP_FLAG_NONE, &depthResourceDesc,
       D3D12_RESOURCE_STATE_DEPTH_WRITE, &depthOptimizedClearValue, IID_PPV_ARGS(&m_depthStencil)));
+	RevMemoryTracker::TrackResource(RevEMemoryTag::Frame, m_depthStencil.Get());
 
 	// Write the depth buffer view into the depth buffer heap
 	D3D12_DEPTH_STENCIL_VIEW_DESC dsvDesc = {};
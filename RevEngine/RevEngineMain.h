@@ -15,7 +15,9 @@
 #include "TopLevelASGenerator.h"
 #include "ShaderBindingTableGenerator.h"
 #include "Core/RevCamera.h"
+#include "Core/RevDescriptorHeap.h"
 #include "Core/RevEngineManager.h"
+#include "Core/RevGpuHeapAllocator.h"
 #include "Core/RevModel.h"
 #include "Core/RevModelManager.h"
 #include "Core/RevShaderManager.h"
@@ -135,19 +137,20 @@ public:
 
     // #DXR Extra: Per-Instance Data
     ComPtr<id3d12resource> m_outputResource;
-    ComPtr<id3d12descriptorheap> m_srvUavHeap;
+    // Ray tracing output UAV, TLAS SRV and camera CBV, the table the ray generation shader reads.
+    std::shared_ptr<const RevDescriptorRange> m_rayTracingDescriptors;
 
     nv_helpers_dx12::ShaderBindingTableGenerator m_sbtHelper;
     ComPtr<id3d12resource> m_sbtStorage;
 
-    ComPtr< ID3D12Resource > m_cameraBuffer;
-    ComPtr< ID3D12DescriptorHeap > m_constHeap;
+    std::shared_ptr<const RevGpuBufferRange> m_cameraBuffer;
+    std::shared_ptr<const RevDescriptorRange> m_cameraDescriptor;
     uint32_t m_cameraBufferSize = 0;
 
     RevInputState m_input = {};
     RevCamera m_camera = {};
 
-    std::vector<ComPtr<id3d12resource>> m_perInstanceConstantBuffers;
+    std::vector<std::shared_ptr<const RevGpuBufferRange>> m_perInstanceConstantBuffers;
 
     ComPtr< ID3D12DescriptorHeap > m_dsvHeap;
     ComPtr< ID3D12Resource > m_depthStencil;
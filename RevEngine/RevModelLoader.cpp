@@ -10,14 +10,25 @@
 #include "d3dcompiler.h"
 #include <memory>
 #include <fstream>
+#include <unordered_map>
+#include <unordered_set>
 
 #define USE_ASSIMP 1
 //path file exist
 #include <codecvt>
 #include <locale>
 
+#include "Core/RevAnimationCompression.h"
+#include "Core/RevAnimationTypes.h"
+#include "Core/RevArchive.h"
 #include "Core/RevEngineExecutionFunctions.h"
 #include "Core/RevEngineRetrievalFunctions.h"
+#include "Core/RevClusterDagBuilder.h"
+#include "Core/RevMeshletBuilder.h"
+#include "Core/RevMeshSimplifier.h"
+#include "Core/RevModelConstructionFunctions.h"
+#include "Core/RevTangentGenerator.h"
+#include "Core/RevVertexPacking.h"
 #include "Shlwapi.h"
 #include "DXSampleHelper.h"
 #include "Microsoft/RevDDSTextureLoader.h"
@@ -55,18 +66,25 @@ void CreateBaseVertex(
         outVertex->m_tex.y = 1 - (float)mesh->mTextureCoords[0][vertIndex].y;
     }
 
-    aiVector3D normal = mesh->mNormals[vertIndex];
-    outVertex->m_normal = XMFLOAT3(normal.x, normal.y, normal.z);
+    if (mesh->HasNormals())
+    {
+        aiVector3D normal = mesh->mNormals[vertIndex];
+        outVertex->m_normal = XMFLOAT3(normal.x, normal.y, normal.z);
+    }
 
-    aiVector3D biNormal = mesh->mBitangents[vertIndex];
-    outVertex->m_binormal = XMFLOAT3(biNormal.x, biNormal.y, biNormal.z);
+    // The import runs without aiProcess_CalcTangentSpace, meshes without authored tangents get them from RevTangentGenerator.
+    if (mesh->HasTangentsAndBitangents())
+    {
+        aiVector3D biNormal = mesh->mBitangents[vertIndex];
+        outVertex->m_binormal = XMFLOAT3(biNormal.x, biNormal.y, biNormal.z);
 
-    aiVector3D tangent = mesh->mTangents[vertIndex];
-    outVertex->m_tangent = XMFLOAT3(tangent.x, tangent.y, tangent.z);
+        aiVector3D tangent = mesh->mTangents[vertIndex];
+        outVertex->m_tangent = XMFLOAT3(tangent.x, tangent.y, tangent.z);
+    }
 }
 
 
-void LoadIndecies(const aiMesh* mesh, std::vector<UINT>& indices)
+void LoadIndecies(const aiMesh* mesh, RevGeometryVector<UINT>& indices)
 {
     for (UINT vertIndex = 0; vertIndex < mesh->mNumFaces; vertIndex++)
     {
@@ -142,224 +160,245 @@ void LoadIndecies(const aiMesh* mesh, UINT** indices, UINT& outNumIndicies)
         }
     }
 }
-/*
-void LoadAnimatedModel(const struct aiScene* scene, RevModel* newModel, const char* path)
+void DecomposeTransform(const aiMatrix4x4& transform, XMFLOAT3& outTranslation, XMFLOAT4& outRotation, XMFLOAT3& outScale)
 {
-  RevAnimatedNodelInitializationData initializationData;
+    aiVector3D scale;
+    aiQuaternion rotation;
+    aiVector3D translation;
+    transform.Decompose(scale, rotation, translation);
+    outTranslation = XMFLOAT3(translation.x, translation.y, translation.z);
+    outRotation = XMFLOAT4(rotation.x, rotation.y, rotation.z, rotation.w);
+    outScale = XMFLOAT3(scale.x, scale.y, scale.z);
+}
 
-  for (UINT meshIndex = 0; meshIndex < scene->mNumMeshes; meshIndex++)
-  {
-    const aiMesh* mesh = scene->mMeshes[meshIndex];
-    if (mesh)
+/** Fills RevSkeleton::m_jointRadii from the bind pose vertexes each joint moves. A parent radius covers the radius
+ *  of every child around the child joint, so culling a joint by its radius always culls its subtree as well. */
+void ComputeJointRadii(RevModelData& modelData)
+{
+    RevSkeleton& skeleton = modelData.m_animation.m_skeleton;
+    const UINT numJoints = skeleton.GetNumJoints();
+    std::vector<XMVECTOR> jointPositions(numJoints);
+    for (UINT joint = 0; joint < numJoints; joint++)
     {
-      initializationData.m_nVertexes = mesh->mNumVertices;
-      initializationData.vertices = new RevAnimatedVertex[initializationData.m_nVertexes];
-      for (UINT vertIndex = 0; vertIndex < mesh->mNumVertices; vertIndex++)
-      {
-        RevAnimatedVertex vertexToUse = {};
-        CreateBaseVertex(mesh, vertIndex, &vertexToUse);
-        initializationData.vertices[vertIndex] = vertexToUse;
-      }
-
-      LoadIndecies(mesh, &initializationData.indices, initializationData.m_nIndices);
-      LoadTexturePaths(mesh, scene, initializationData.m_textureInitialization, path);
-
-      initializationData.m_nBones = mesh->mNumBones;
-      initializationData.bones = new RevBone[initializationData.m_nBones];
-      for (UINT boneIndex = 0; boneIndex < mesh->mNumBones; boneIndex++)
-      {
-        aiBone* bone = mesh->mBones[boneIndex];
-        RevBone boneData = {};
-
-        strcpy(boneData.m_name , bone->mName.C_Str());
-        aiMatrix4x4 boneM = bone->mOffsetMatrix.Transpose();
-        boneData.m_offsetMatrix.Load(&boneM.a1);
-        for (UINT influenceIndex = 0; influenceIndex < bone->mNumWeights; influenceIndex++)
-        {
-          aiVertexWeight weight = bone->mWeights[influenceIndex];
-          RevAnimatedVertex* animatedVertex = (RevAnimatedVertex*)&initializationData.vertices[weight.mVertexId];
-          UINT indexToUse = UINT8_MAX;
-          for (UINT boneInfluenceIndex = 0; boneInfluenceIndex < REV_MAX_INFLUENCES_PER_BONE; boneInfluenceIndex++)
-          {
-            if (animatedVertex->m_boneInfluences[boneInfluenceIndex] == UINT_MAX)
-            {
-              indexToUse = boneInfluenceIndex;
-              break;
-            }
-          }
-
-          float weightScale = weight.mWeight;
+        XMVECTOR determinant;
+        jointPositions[joint] = XMMatrixInverse(&determinant, XMLoadFloat4x4(&skeleton.m_inverseBindPose[joint])).r[3];
+    }
 
-          if (indexToUse == UINT8_MAX)
-          {
-            float minimumWeightFound = weightScale;
-            for (UINT boneInfluenceIndex = 0; boneInfluenceIndex < REV_MAX_INFLUENCES_PER_BONE; boneInfluenceIndex++)
+    skeleton.m_jointRadii.assign(numJoints, 0.0f);
+    const XMFLOAT3* positions = modelData.m_vertexStream.GetFloatPositions();
+    const UINT stride = modelData.GetVertexStride();
+    for (UINT vertex = 0; positions && vertex < modelData.GetNumVertexes(); vertex++)
+    {
+        const XMFLOAT3* position = reinterpret_cast<const XMFLOAT3*>(reinterpret_cast<const UINT8*>(positions) + static_cast<size_t>(vertex) * stride);
+        const RevSkinWeights& skin = modelData.m_animation.m_skinWeights[vertex];
+        for (UINT slot = 0; slot < REV_MAX_JOINT_INFLUENCES; slot++)
+        {
+            if (skin.m_weights[slot] > 0.0f)
             {
-              const float& weightToCheck = animatedVertex->m_boneWeights[boneInfluenceIndex];
-              if (weightToCheck < minimumWeightFound)
-              {
-                minimumWeightFound = weightToCheck;
-                indexToUse = boneInfluenceIndex;
-              }
+                const UINT joint = skin.m_joints[slot];
+                const float distance = XMVectorGetX(XMVector3Length(XMLoadFloat3(position) - jointPositions[joint]));
+                skeleton.m_jointRadii[joint] = max(skeleton.m_jointRadii[joint], distance);
             }
-          }
-
-          if (indexToUse != UINT8_MAX)
-          {
-            animatedVertex->m_boneWeights[indexToUse] = weightScale;
-            animatedVertex->m_boneInfluences[indexToUse] = boneIndex;
-          }
         }
+    }
+    // Children come after their parents, walking backwards finishes every subtree before its root.
+    for (UINT joint = numJoints; joint-- > 0;)
+    {
+        const INT parent = skeleton.m_parents[joint];
+        if (parent != REV_INDEX_NONE)
+        {
+            const float distance = XMVectorGetX(XMVector3Length(jointPositions[joint] - jointPositions[parent]));
+            skeleton.m_jointRadii[parent] = max(skeleton.m_jointRadii[parent], skeleton.m_jointRadii[joint] + distance);
+        }
+    }
+}
 
-        initializationData.bones[boneIndex] = boneData;
-      }
-
-      for (UINT boneIndex = 0; boneIndex < initializationData.m_nBones; boneIndex++)
-      {
-        RevBone& bone = initializationData.bones[boneIndex];
-
-        aiNode* node = FindNodeRecursive(scene->mRootNode, bone.m_name);
-
-        UINT parentIndex = UINT8_MAX;
-        if (node && node->mParent)
+/** Adds the skeleton, skin weights and clips of scene. Joints are the bone nodes and every node above them,
+ *  taken breadth first so the skeleton is ordered by depth. Call after LoadNormalModel. */
+void LoadSkeletalAnimation(const struct aiScene* scene, RevModelData& outModelData)
+{
+#if USE_ASSIMP
+    RevAnimationData& animation = outModelData.m_animation;
+    std::unordered_map<std::string, aiMatrix4x4> boneOffsets;
+    std::unordered_set<const aiNode*> usedNodes;
+    for (UINT meshIndex = 0; meshIndex < scene->mNumMeshes; meshIndex++)
+    {
+        const aiMesh* mesh = scene->mMeshes[meshIndex];
+        for (UINT boneIndex = 0; mesh && boneIndex < mesh->mNumBones; boneIndex++)
         {
-          for (UINT parentSearchIndex = 0; parentSearchIndex < initializationData.m_nBones; parentSearchIndex++)
-          {
-            RevBone& parentBone = initializationData.bones[parentSearchIndex];
-            if (strcmp(parentBone.m_name, node->mParent->mName.C_Str()) == 0)
+            const aiBone* bone = mesh->mBones[boneIndex];
+            boneOffsets[bone->mName.C_Str()] = bone->mOffsetMatrix;
+            for (const aiNode* node = FindNodeRecursive(scene->mRootNode, bone->mName.C_Str());
+                node && usedNodes.insert(node).second;
+                node = node->mParent)
             {
-              parentIndex = parentSearchIndex;
-              break;
             }
-          }
         }
-        bone.m_parentIndex = parentIndex;
-      }
     }
-  }
-
-  for (UINT animationIndex = 0; animationIndex < scene->mNumAnimations; animationIndex++)
-  {
-    const aiAnimation* animation = scene->mAnimations[animationIndex];
-    RevAnimationInstanceData animationModelInstanceData = {};
-    animationModelInstanceData.m_name = animation->mName.C_Str();
-
-    animationModelInstanceData.m_duration = (float)animation->mDuration;
-    assert(animation->mNumChannels != 0);
-    for (UINT channelIndex = 0; channelIndex < animation->mNumChannels; channelIndex++)
+    if (usedNodes.empty())
     {
-      aiNodeAnim* channel = animation->mChannels[channelIndex];
-      assert(channel);
-
-      RevAnimationChannel animationChannel = {};
-      animationChannel.m_nodeName = channel->mNodeName.C_Str();
-
-      assert(channel->mNumPositionKeys == channel->mNumRotationKeys
-        && channel->mNumPositionKeys == channel->mNumScalingKeys);
-      animationChannel.m_keyFrames = std::vector<RevKeyFrame>(channel->mNumPositionKeys);
+        return;
+    }
 
-      animationChannel.m_boneIndex = UINT8_MAX;
-      for (UINT boneIndex = 0; boneIndex < initializationData.m_nBones; boneIndex++)
-      {
-        const RevBone& bone = initializationData.bones[boneIndex];
-        if (strcmp(bone.m_name, animationChannel.m_nodeName.c_str()) == 0)
+    RevSkeleton& skeleton = animation.m_skeleton;
+    std::vector<const aiNode*> joints;
+    std::unordered_map<const aiNode*, UINT> jointIndexes;
+    std::vector<const aiNode*> level = { scene->mRootNode };
+    std::vector<const aiNode*> nextLevel;
+    while (!level.empty())
+    {
+        skeleton.m_levelOffsets.push_back(static_cast<UINT>(joints.size()));
+        nextLevel.clear();
+        for (const aiNode* node : level)
         {
-          animationChannel.m_boneIndex = boneIndex;
-          break;
+            jointIndexes[node] = static_cast<UINT>(joints.size());
+            joints.push_back(node);
+            for (UINT childIndex = 0; childIndex < node->mNumChildren; childIndex++)
+            {
+                if (usedNodes.count(node->mChildren[childIndex]) > 0)
+                {
+                    nextLevel.push_back(node->mChildren[childIndex]);
+                }
+            }
         }
-      }
-
-      for (UINT keyFrameIndex = 0; keyFrameIndex < channel->mNumPositionKeys; keyFrameIndex++)
-      {
-        RevKeyFrame newKeyFrame = {};
-        aiVectorKey locationKey = channel->mPositionKeys[keyFrameIndex];
-        aiQuatKey rotationKey = channel->mRotationKeys[keyFrameIndex];
-        aiVectorKey scaleKey = channel->mScalingKeys[keyFrameIndex];
-
-        assert(locationKey.mTime == rotationKey.mTime
-          && locationKey.mTime == scaleKey.mTime);
-
-        newKeyFrame.m_time = (float)locationKey.mTime;
-        newKeyFrame.m_rotation = RevQuat(rotationKey.mValue.x, rotationKey.mValue.y, rotationKey.mValue.z, rotationKey.mValue.w);
-        newKeyFrame.m_location = RevVector3(locationKey.mValue.x, locationKey.mValue.y, locationKey.mValue.z);
-        newKeyFrame.m_scale = RevVector3(scaleKey.mValue.x, scaleKey.mValue.y, scaleKey.mValue.z);
-
-        animationChannel.m_keyFrames[keyFrameIndex] = newKeyFrame;
-      }
-
-      animationModelInstanceData.m_channels.push_back(animationChannel);
+        level.swap(nextLevel);
     }
+    skeleton.m_levelOffsets.push_back(static_cast<UINT>(joints.size()));
 
-    initializationData.instanceData.push_back(animationModelInstanceData);
-  }
-
-  for (UINT boneIndex = 0; boneIndex < initializationData.m_nBones; boneIndex++)
-  {
-    RevBone& bone = initializationData.bones[boneIndex];
+    const UINT numJoints = static_cast<UINT>(joints.size());
+    assert(numJoints <= UINT16_MAX);
+    skeleton.m_parents.resize(numJoints);
+    skeleton.m_inverseBindPose.resize(numJoints);
+    for (UINT joint = 0; joint < numJoints; joint++)
+    {
+        auto parent = jointIndexes.find(joints[joint]->mParent);
+        skeleton.m_parents[joint] = parent != jointIndexes.end() ? static_cast<INT>(parent->second) : REV_INDEX_NONE;
+        auto offset = boneOffsets.find(joints[joint]->mName.C_Str());
+        // Assimp matrices transform column vectors, DirectXMath uses row vectors.
+        aiMatrix4x4 inverseBindPose = offset != boneOffsets.end() ? offset->second : aiMatrix4x4();
+        inverseBindPose.Transpose();
+        skeleton.m_inverseBindPose[joint] = XMFLOAT4X4(&inverseBindPose.a1);
+    }
 
-    bone.m_channelIndex = UINT_MAX;
-    for (UINT instanceIndex = 0; instanceIndex< initializationData.instanceData.size(); instanceIndex++)
+    // Keeps the strongest REV_MAX_JOINT_INFLUENCES weights of every vertex.
+    animation.m_skinWeights.resize(outModelData.GetNumVertexes());
+    UINT subMeshIndex = 0;
+    for (UINT meshIndex = 0; meshIndex < scene->mNumMeshes; meshIndex++)
     {
-      RevAnimationInstanceData& instance = initializationData.instanceData[instanceIndex];
-      for (UINT channelIndex = 0; channelIndex < instance.m_channels.size(); channelIndex++)
-      {
-        RevAnimationChannel& channel = instance.m_channels[channelIndex];
-        if (channel.m_boneIndex == boneIndex)
+        const aiMesh* mesh = scene->mMeshes[meshIndex];
+        if (!mesh)
         {
-          bone.m_channelIndex = channelIndex;
-          break;
+            continue;
+        }
+        const RevSubMesh& subMesh = outModelData.m_subMeshes[subMeshIndex++];
+        for (UINT boneIndex = 0; boneIndex < mesh->mNumBones; boneIndex++)
+        {
+            const aiBone* bone = mesh->mBones[boneIndex];
+            const UINT16 joint = static_cast<UINT16>(jointIndexes[FindNodeRecursive(scene->mRootNode, bone->mName.C_Str())]);
+            for (UINT weightIndex = 0; weightIndex < bone->mNumWeights; weightIndex++)
+            {
+                const aiVertexWeight& weight = bone->mWeights[weightIndex];
+                RevSkinWeights& skin = animation.m_skinWeights[subMesh.m_baseVertex + weight.mVertexId];
+                UINT weakest = 0;
+                for (UINT slot = 1; slot < REV_MAX_JOINT_INFLUENCES; slot++)
+                {
+                    weakest = skin.m_weights[slot] < skin.m_weights[weakest] ? slot : weakest;
+                }
+                if (weight.mWeight > skin.m_weights[weakest])
+                {
+                    skin.m_joints[weakest] = joint;
+                    skin.m_weights[weakest] = weight.mWeight;
+                }
+            }
         }
-      }
     }
-  }
-  //readjust vertex weights to be normalized
-  for (UINT32 index = 0; index < initializationData.m_nVertexes; index++)
-  {
-    RevAnimatedVertex& v = initializationData.vertices[index];
-    float sum = 0.0f;
-    for (UINT i = 0; i < ARRAYSIZE(v.m_boneInfluences); i++)
+    for (RevSkinWeights& skin : animation.m_skinWeights)
     {
-      if (v.m_boneInfluences[i] == UINT8_MAX)
-      {
-        v.m_boneInfluences[i] = 0;
-        v.m_boneWeights[i] = 0.0f;
-      }
-
-      sum += v.m_boneWeights[i];
+        float sum = 0.0f;
+        for (float weight : skin.m_weights)
+        {
+            sum += weight;
+        }
+        if (sum <= 0.0f)
+        {
+            // Unweighted vertexes follow the root.
+            skin.m_weights[0] = 1.0f;
+            continue;
+        }
+        for (float& weight : skin.m_weights)
+        {
+            weight /= sum;
+        }
     }
+    ComputeJointRadii(outModelData);
 
-    if (sum != 0.0f && sum != 1.0f)
+    for (UINT animationIndex = 0; animationIndex < scene->mNumAnimations; animationIndex++)
     {
-      for (UINT i = 0; i < ARRAYSIZE(v.m_boneInfluences); i++)
-      {
-        v.m_boneWeights[i] /= sum;
-      }
-    }
-  }
-
-  RevEngineFunctions::CreateAnimatedModelGeometry(
-    initializationData,
-    newModel->m_modelData);
+        const aiAnimation* sourceAnimation = scene->mAnimations[animationIndex];
+        std::vector<const aiNodeAnim*> channels(numJoints, nullptr);
+        for (UINT channelIndex = 0; channelIndex < sourceAnimation->mNumChannels; channelIndex++)
+        {
+            const aiNodeAnim* channel = sourceAnimation->mChannels[channelIndex];
+            auto joint = jointIndexes.find(FindNodeRecursive(scene->mRootNode, channel->mNodeName.C_Str()));
+            if (joint != jointIndexes.end())
+            {
+                channels[joint->second] = channel;
+            }
+        }
 
-  {
-    RevArchiveSaver saver;
-    std::string modelPath(path);
-    modelPath = modelPath.substr(0, modelPath.find_last_of('.'));
-    modelPath.append("_MODEL.rrev");
-    std::fstream fstream;
-    fstream.open(modelPath.c_str(), std::ios_base::out | std::ios_base::binary);
-    {
-      saver << (UINT8)RevModelType::Animated;
-      initializationData.Serialize(saver);
-      fstream << saver.Tell();
-      fstream.write((const char*)saver.m_byteArray, saver.Tell());
-      fstream.close();
+        RevRawAnimationClip clip;
+        std::wstring_convert<std::codecvt_utf8_utf16<wchar_t>> converter;
+        clip.m_name = converter.from_bytes(sourceAnimation->mName.C_Str());
+        // Key times are in ticks, files without a tick rate use the assimp default.
+        const double secondsPerTick = 1.0 / (sourceAnimation->mTicksPerSecond > 0.0 ? sourceAnimation->mTicksPerSecond : 25.0);
+        clip.m_duration = static_cast<float>(sourceAnimation->mDuration * secondsPerTick);
+        clip.m_tracks.resize(numJoints);
+        for (UINT joint = 0; joint < numJoints; joint++)
+        {
+            RevRawJointTrack& track = clip.m_tracks[joint];
+            const aiNodeAnim* channel = channels[joint];
+            if (!channel || channel->mNumPositionKeys == 0 || channel->mNumRotationKeys == 0 || channel->mNumScalingKeys == 0)
+            {
+                RevVectorKey translation;
+                RevRotationKey rotation;
+                RevVectorKey scale;
+                DecomposeTransform(joints[joint]->mTransformation, translation.m_value, rotation.m_value, scale.m_value);
+                track.m_translations.push_back(translation);
+                track.m_rotations.push_back(rotation);
+                track.m_scales.push_back(scale);
+                continue;
+            }
+            for (UINT key = 0; key < channel->mNumPositionKeys; key++)
+            {
+                const aiVectorKey& source = channel->mPositionKeys[key];
+                RevVectorKey translation;
+                translation.m_time = static_cast<float>(source.mTime * secondsPerTick);
+                translation.m_value = XMFLOAT3(source.mValue.x, source.mValue.y, source.mValue.z);
+                track.m_translations.push_back(translation);
+            }
+            for (UINT key = 0; key < channel->mNumRotationKeys; key++)
+            {
+                const aiQuatKey& source = channel->mRotationKeys[key];
+                RevRotationKey rotation;
+                rotation.m_time = static_cast<float>(source.mTime * secondsPerTick);
+                rotation.m_value = XMFLOAT4(source.mValue.x, source.mValue.y, source.mValue.z, source.mValue.w);
+                track.m_rotations.push_back(rotation);
+            }
+            for (UINT key = 0; key < channel->mNumScalingKeys; key++)
+            {
+                const aiVectorKey& source = channel->mScalingKeys[key];
+                RevVectorKey scale;
+                scale.m_time = static_cast<float>(source.mTime * secondsPerTick);
+                scale.m_value = XMFLOAT3(source.mValue.x, source.mValue.y, source.mValue.z);
+                track.m_scales.push_back(scale);
+            }
+        }
+        RevAnimationClip compressedClip;
+        RevAnimationCompression::CompressClip(clip, compressedClip);
+        animation.m_clips.push_back(std::move(compressedClip));
     }
-  }
-
-
+#endif
 }
-*/
 void LoadNormalModel(const struct aiScene* scene, RevModelData& outModelData, const std::wstring& path)
 {
 #if USE_ASSIMP
@@ -369,86 +408,164 @@ void LoadNormalModel(const struct aiScene* scene, RevModelData& outModelData, co
         const aiMesh* mesh = scene->mMeshes[meshIndex];
         if (mesh)
         {
-            outModelData.m_staticVertexes.reserve(mesh->mNumVertices);
+            // Indices stay local to the mesh, the submesh base vertex places them in the shared buffer.
+            RevSubMesh subMesh = {};
+            const UINT baseVertex = outModelData.GetNumVertexes();
+            subMesh.m_baseVertex = static_cast<INT>(baseVertex);
+            subMesh.m_vertexCount = mesh->mNumVertices;
+            subMesh.m_indexOffset = static_cast<UINT>(outModelData.m_indices.size());
+
+            RevVertexPosTexNormBiTan* vertexes = outModelData.m_vertexStream.Resize<RevVertexPosTexNormBiTan>(baseVertex + mesh->mNumVertices) + baseVertex;
             for (UINT vertIndex = 0; vertIndex < mesh->mNumVertices; vertIndex++)
             {
-                RevVertexPosTexNormBiTan staticVert = {};
-                CreateBaseVertex(mesh, vertIndex, &staticVert);
-                outModelData.m_staticVertexes.push_back(staticVert);
+                CreateBaseVertex(mesh, vertIndex, &vertexes[vertIndex]);
             }
 
             LoadIndecies(mesh, outModelData.m_indices);
+            subMesh.m_indexCount = static_cast<UINT>(outModelData.m_indices.size()) - subMesh.m_indexOffset;
+            outModelData.m_subMeshes.push_back(subMesh);
+            if (!mesh->HasNormals())
+            {
+                // Zero normals would give zero tangents too, and the surface would shade black.
+                RevTangentGenerator::GenerateNormals(outModelData, subMesh);
+            }
+            if (!mesh->HasTangentsAndBitangents())
+            {
+                RevTangentGenerator::GenerateTangents(outModelData, subMesh);
+            }
             LoadTexturePaths(mesh, scene, outModelData.m_textures, path);
         }
     }
-
-    /*{
-      RevArchiveSaver saver;
-
-      std::string modelPath(path);
-      modelPath = modelPath.substr(0, modelPath.find_last_of('.'));
-      modelPath.append("_MODEL.rrev");
-      std::fstream fstream;
-      fstream.open(modelPath.c_str(), std::ios_base::out | std::ios_base::binary);
-      {
-        saver << (UINT8)RevModelType::Normal;
-        initializationData.Serialize(saver);
-        fstream << saver.Tell();
-        fstream.write((const char*)saver.m_byteArray, saver.Tell());
-        fstream.close();
-      }
-    }*/
 #endif
 }
 
 
 
-RevModelData RevModelLoader::CreateModelDataFromFile(const std::wstring& path)
+namespace
 {
-    RevModelData modelData = {};
+    // "RREV" read as a little endian UINT32.
+    const UINT32 g_cookedModelMagic = 0x56455252;
+}
 
-    RevEModelType type = RevEModelType::ModelStatic;
-    bool loadedBinary = false;
-    std::wstring modelPath(path);
-    modelPath = modelPath.substr(0, modelPath.find_last_of('.'));
-    modelPath.append(L"_MODEL.rrev");
+struct RevCookedModelHeader
+{
+    UINT32 m_magic = g_cookedModelMagic;
+    UINT32 m_version = REV_COOKED_MODEL_VERSION;
+    UINT64 m_sourceWriteTime = 0;
+    UINT64 m_size = 0;
+};
 
-#if DO_LOAING_BINARY
-    if (PathFileExists(modelPath.c_str()))
+std::wstring GetCookedModelPath(const RevModelInitializationData& inData)
+{
+    std::wstring modelPath = inData.m_path.substr(0, inData.m_path.find_last_of('.'));
+    if (inData.m_clusterDag)
     {
-        std::fstream fstream;
-        fstream.open(modelPath.c_str(), std::ios_base::in | std::ios_base::binary);
-        if (fstream.is_open())
-        {
-            UINT size = 0;
-            fstream >> size;
+        modelPath.append(L"_CLUSTERS");
+    }
+    if (inData.m_meshlets)
+    {
+        modelPath.append(L"_MESHLETS");
+    }
+    modelPath.append(inData.m_vertexFormat == RevEVertexFormat::Packed ? L"_PACKED_MODEL.rrev" : L"_MODEL.rrev");
+    return modelPath;
+}
 
-            RevArchiveLoader loader(size);
-            fstream.read((char*)loader.m_byteArray, size);
-            loader << type;
-            if (type == RevModelType::Animated)
-            {
-                RevAnimatedNodelInitializationData initData = {};
-                initData.Serialize(loader);
-                RevEngineFunctions::CreateAnimatedModelGeometry(
-                    initData,
-                    newModel->m_modelData);
-            }
-            else
-            {
-                RevNormalModelInitializationData initData = {};
-                initData.Serialize(loader);
-                RevEngineFunctions::CreateNormalModelGeometry(
-                    initData,
-                    newModel->m_modelData);
-            }
+UINT64 GetFileWriteTime(const std::wstring& path)
+{
+    WIN32_FILE_ATTRIBUTE_DATA attributes = {};
+    if (!GetFileAttributesExW(path.c_str(), GetFileExInfoStandard, &attributes))
+    {
+        return 0;
+    }
+    return (static_cast<UINT64>(attributes.ftLastWriteTime.dwHighDateTime) << 32) | attributes.ftLastWriteTime.dwLowDateTime;
+}
 
-            fstream.close();
-            loader.Delete();
-        }
+/** Loads the cooked model unless it is missing, from another version or older than its source file.
+ *  A cooked model without its source next to it is always used. */
+bool LoadCookedModel(const std::wstring& cookedPath, const std::wstring& sourcePath, RevModelData& outModelData)
+{
+    if (!PathFileExists(cookedPath.c_str()))
+    {
+        return false;
     }
-    else
-#endif
+
+    std::fstream fstream;
+    fstream.open(cookedPath.c_str(), std::ios_base::in | std::ios_base::binary);
+    if (!fstream.is_open())
+    {
+        return false;
+    }
+
+    RevCookedModelHeader header = {};
+    fstream.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!fstream)
+    {
+        return false;
+    }
+    // A corrupt size must not turn into a huge allocation, it has to match what is left of the file.
+    const std::streamoff dataStart = fstream.tellg();
+    fstream.seekg(0, std::ios_base::end);
+    const UINT64 dataSize = static_cast<UINT64>(fstream.tellg() - dataStart);
+    fstream.seekg(dataStart);
+    const UINT64 sourceWriteTime = GetFileWriteTime(sourcePath);
+    if (!fstream
+        || header.m_magic != g_cookedModelMagic
+        || header.m_version != REV_COOKED_MODEL_VERSION
+        || (sourceWriteTime != 0 && header.m_sourceWriteTime != sourceWriteTime)
+        || header.m_size != dataSize)
+    {
+        return false;
+    }
+
+    // Vectors read straight from the file into their storage.
+    RevArchiveLoader loader(fstream, header.m_size);
+    RevModelData modelData = {};
+    modelData.Serialize(loader);
+    if (!loader.IsValid() || loader.Tell() != header.m_size)
+    {
+        return false;
+    }
+    outModelData = std::move(modelData);
+    return true;
+}
+
+void SaveCookedModel(const std::wstring& cookedPath, const std::wstring& sourcePath, RevModelData& modelData)
+{
+    std::fstream fstream;
+    fstream.open(cookedPath.c_str(), std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+    if (!fstream.is_open())
+    {
+        // Read-only data folders just import the source every run.
+        return;
+    }
+
+    // The data streams straight into the file, the header is written again once its size is known.
+    RevCookedModelHeader header = {};
+    header.m_sourceWriteTime = GetFileWriteTime(sourcePath);
+    fstream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    RevArchiveSaver saver(fstream);
+    modelData.Serialize(saver);
+    header.m_size = saver.Tell();
+    fstream.seekp(0);
+    fstream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    fstream.close();
+}
+
+/** The input layout comes from the vertex stream, only the shader depends on the vertex format. */
+void SetupShader(RevModelData& modelData)
+{
+    modelData.m_shaderPath = modelData.m_vertexFormat == RevEVertexFormat::Packed
+        ? L"Data//Shaders//StaticModelPacked.hlsl"
+        : L"Data//Shaders//StaticModel.hlsl";
+}
+
+RevModelData RevModelLoader::CreateModelDataFromFile(const RevModelInitializationData& inData)
+{
+    RevModelData modelData = {};
+
+    const std::wstring& path = inData.m_path;
+    const std::wstring cookedPath = GetCookedModelPath(inData);
+    if (!LoadCookedModel(cookedPath, path, modelData))
     {
 #if USE_ASSIMP
         char output[256];
@@ -457,29 +574,44 @@ RevModelData RevModelLoader::CreateModelDataFromFile(const std::wstring& path)
         const struct aiScene* scene = aiImportFile(output, 0);
         assert(scene);
         modelData.m_type = scene->HasAnimations() ? RevEModelType::ModelAnimated : RevEModelType::ModelStatic;
-        if (modelData.m_type == RevEModelType::ModelStatic)
+        LoadNormalModel(scene, modelData, path);
+        if (modelData.m_type == RevEModelType::ModelAnimated)
         {
-            LoadNormalModel(scene, modelData, path);
+            LoadSkeletalAnimation(scene, modelData);
         }
-        else
+
+        // Cook steps, everything below ends up in the cooked model.
+        RevModelConstructionFunctions::ComputeBounds(modelData);
+        if (modelData.m_type == RevEModelType::ModelStatic)
         {
-            //  LoadAnimatedModel(scene, newModel, path);
+            // Hashes, clusters and LODs describe rigid geometry, skinned vertexes move every frame and
+            // stay full precision for CPU skinning.
+            modelData.m_geometryHash = RevModelConstructionFunctions::ComputeGeometryHash(modelData);
+            if (inData.m_meshlets)
+            {
+                RevMeshletBuilder::BuildMeshlets(modelData);
+            }
+            RevMeshSimplifier::BuildLodChain(modelData);
+            if (inData.m_clusterDag)
+            {
+                RevClusterDagBuilder::BuildClusterDag(modelData);
+            }
         }
-
-        modelData.m_shaderPath = L"Data//Shaders//StaticModel.hlsl";
-        modelData.m_inputLayout =
+        RevModelConstructionFunctions::CompactIndices(modelData);
+        if (inData.m_vertexFormat == RevEVertexFormat::Packed && modelData.m_type == RevEModelType::ModelStatic)
         {
-          { "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-    { "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-    { "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 20, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-    { "BINORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 32, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-    { "TANGENT", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 44, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }
-        };
-
+            RevVertexPacking::PackStaticVertexes(modelData);
+        }
+        SaveCookedModel(cookedPath, path, modelData);
 #else
         assert(0 && "Not using assimp and dont have proepr context");
 #endif
     }
+
+    SetupShader(modelData);
+    if (inData.m_positionStream)
+    {
+        RevModelConstructionFunctions::ExtractPositionStream(modelData);
+    }
     return modelData;
 }
-
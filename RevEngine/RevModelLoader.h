@@ -1,7 +1,10 @@
 #pragma once
 
+struct RevModelInitializationData;
+
 class RevModelLoader
 {
 public:
-	static class RevModelData CreateModelDataFromFile(const std::wstring& path);
-};
\ No newline at end of file
+	/** Loads the cooked model for inData, cooking it from inData.m_path first when it is missing or stale. */
+	static struct RevModelData CreateModelDataFromFile(const RevModelInitializationData& inData);
+};
@@ -0,0 +1,167 @@
+#include "stdafx.h"
+#include "RevTest.h"
+#include <cmath>
+#include "Core/RevTangentGenerator.h"
+#include "D3D/RevD3DTypes.h"
+
+using namespace DirectX;
+
+namespace
+{
+    const float g_tolerance = 1e-4f;
+
+    struct RevTestCorner
+    {
+        XMFLOAT3 m_position;
+        XMFLOAT2 m_tex;
+    };
+
+    /** Unwelded triangle list, every corner is a vertex of its own like the importer hands them over. */
+    RevSubMesh CreateTriangles(RevModelData& modelData, const RevTestCorner* corners, UINT numCorners, const XMFLOAT3& normal)
+    {
+        RevVertexPosTexNormBiTan* vertexes = modelData.m_vertexStream.Resize<RevVertexPosTexNormBiTan>(numCorners);
+        for (UINT corner = 0; corner < numCorners; corner++)
+        {
+            vertexes[corner] = {};
+            vertexes[corner].m_position = corners[corner].m_position;
+            vertexes[corner].m_tex = corners[corner].m_tex;
+            vertexes[corner].m_normal = normal;
+            modelData.m_indices.push_back(corner);
+        }
+        RevSubMesh subMesh = {};
+        subMesh.m_indexCount = numCorners;
+        subMesh.m_vertexCount = numCorners;
+        modelData.m_subMeshes.push_back(subMesh);
+        return subMesh;
+    }
+
+    bool IsNear(const XMFLOAT3& value, float x, float y, float z)
+    {
+        return fabsf(value.x - x) < g_tolerance && fabsf(value.y - y) < g_tolerance && fabsf(value.z - z) < g_tolerance;
+    }
+
+    const RevVertexPosTexNormBiTan& GetVertex(RevModelData& modelData, UINT vertex)
+    {
+        return modelData.m_vertexStream.Get<RevVertexPosTexNormBiTan>()[vertex];
+    }
+}
+
+REV_TEST(TangentsMatchMikkTSpaceOnWeldedCorners)
+{
+    // Unit quad in the XY plane split along its diagonal, the UVs shear the second triangle so both faces disagree.
+    // MikkTSpace welds the diagonal corners and sums both faces weighted by their 45 degree corner angles.
+    const RevTestCorner corners[] =
+    {
+        { XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT2(0.0f, 0.0f) },
+        { XMFLOAT3(1.0f, 0.0f, 0.0f), XMFLOAT2(1.0f, 0.0f) },
+        { XMFLOAT3(1.0f, 1.0f, 0.0f), XMFLOAT2(1.0f, 1.0f) },
+        { XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT2(0.0f, 0.0f) },
+        { XMFLOAT3(1.0f, 1.0f, 0.0f), XMFLOAT2(1.0f, 1.0f) },
+        { XMFLOAT3(0.0f, 1.0f, 0.0f), XMFLOAT2(0.0f, 2.0f) },
+    };
+    RevModelData modelData;
+    const RevSubMesh subMesh = CreateTriangles(modelData, corners, 6, XMFLOAT3(0.0f, 0.0f, 1.0f));
+    RevTangentGenerator::GenerateTangents(modelData, subMesh);
+
+    // Tangents and bitangent signs MikkTSpace generates for this mesh.
+    const XMFLOAT3 expected[] =
+    {
+        XMFLOAT3(0.9732490f, 0.2297529f, 0.0f),
+        XMFLOAT3(1.0f, 0.0f, 0.0f),
+        XMFLOAT3(0.9732490f, 0.2297529f, 0.0f),
+        XMFLOAT3(0.9732490f, 0.2297529f, 0.0f),
+        XMFLOAT3(0.9732490f, 0.2297529f, 0.0f),
+        XMFLOAT3(0.8944272f, 0.4472136f, 0.0f),
+    };
+    for (UINT vertex = 0; vertex < 6; vertex++)
+    {
+        const RevVertexPosTexNormBiTan& result = GetVertex(modelData, vertex);
+        REV_CHECK(IsNear(result.m_tangent, expected[vertex].x, expected[vertex].y, expected[vertex].z));
+        // Sign +1, the binormal is cross(normal, tangent).
+        REV_CHECK(IsNear(result.m_binormal, -expected[vertex].y, expected[vertex].x, 0.0f));
+    }
+}
+
+REV_TEST(TangentsMatchMikkTSpaceOnMirroredUvs)
+{
+    // Two unit quads side by side, the right one maps its UVs mirrored around the shared edge at x = 1.
+    const RevTestCorner corners[] =
+    {
+        { XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT2(0.0f, 0.0f) },
+        { XMFLOAT3(1.0f, 0.0f, 0.0f), XMFLOAT2(1.0f, 0.0f) },
+        { XMFLOAT3(1.0f, 1.0f, 0.0f), XMFLOAT2(1.0f, 1.0f) },
+        { XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT2(0.0f, 0.0f) },
+        { XMFLOAT3(1.0f, 1.0f, 0.0f), XMFLOAT2(1.0f, 1.0f) },
+        { XMFLOAT3(0.0f, 1.0f, 0.0f), XMFLOAT2(0.0f, 1.0f) },
+        { XMFLOAT3(1.0f, 0.0f, 0.0f), XMFLOAT2(1.0f, 0.0f) },
+        { XMFLOAT3(2.0f, 0.0f, 0.0f), XMFLOAT2(0.0f, 0.0f) },
+        { XMFLOAT3(2.0f, 1.0f, 0.0f), XMFLOAT2(0.0f, 1.0f) },
+        { XMFLOAT3(1.0f, 0.0f, 0.0f), XMFLOAT2(1.0f, 0.0f) },
+        { XMFLOAT3(2.0f, 1.0f, 0.0f), XMFLOAT2(0.0f, 1.0f) },
+        { XMFLOAT3(1.0f, 1.0f, 0.0f), XMFLOAT2(1.0f, 1.0f) },
+    };
+    RevModelData modelData;
+    const RevSubMesh subMesh = CreateTriangles(modelData, corners, 12, XMFLOAT3(0.0f, 0.0f, 1.0f));
+    RevTangentGenerator::GenerateTangents(modelData, subMesh);
+
+    // MikkTSpace keeps the halves apart: +X with sign +1 on the left, -X with sign -1 on the right. Both give a +Y
+    // binormal.
+    for (UINT vertex : { 0u, 3u, 5u })
+    {
+        REV_CHECK(IsNear(GetVertex(modelData, vertex).m_tangent, 1.0f, 0.0f, 0.0f));
+        REV_CHECK(IsNear(GetVertex(modelData, vertex).m_binormal, 0.0f, 1.0f, 0.0f));
+    }
+    for (UINT vertex : { 7u, 8u, 10u })
+    {
+        REV_CHECK(IsNear(GetVertex(modelData, vertex).m_tangent, -1.0f, 0.0f, 0.0f));
+        REV_CHECK(IsNear(GetVertex(modelData, vertex).m_binormal, 0.0f, 1.0f, 0.0f));
+    }
+    // MikkTSpace gives the seam one frame per side. A vertex holds one, every seam position takes the side most of its
+    // corners are on: the right side at the bottom, the left side at the top.
+    for (UINT vertex : { 1u, 6u, 9u })
+    {
+        REV_CHECK(IsNear(GetVertex(modelData, vertex).m_tangent, -1.0f, 0.0f, 0.0f));
+        REV_CHECK(IsNear(GetVertex(modelData, vertex).m_binormal, 0.0f, 1.0f, 0.0f));
+    }
+    for (UINT vertex : { 2u, 4u, 11u })
+    {
+        REV_CHECK(IsNear(GetVertex(modelData, vertex).m_tangent, 1.0f, 0.0f, 0.0f));
+        REV_CHECK(IsNear(GetVertex(modelData, vertex).m_binormal, 0.0f, 1.0f, 0.0f));
+    }
+}
+
+REV_TEST(NormalsGeneratedForMeshesWithoutNormals)
+{
+    // Two triangles folded 90 degrees along the x axis, one facing +Z and one facing +Y.
+    const RevTestCorner corners[] =
+    {
+        { XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT2(0.0f, 0.0f) },
+        { XMFLOAT3(1.0f, 0.0f, 0.0f), XMFLOAT2(1.0f, 0.0f) },
+        { XMFLOAT3(0.0f, 1.0f, 0.0f), XMFLOAT2(0.0f, 1.0f) },
+        { XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT2(0.0f, 0.0f) },
+        { XMFLOAT3(0.0f, 0.0f, 1.0f), XMFLOAT2(0.0f, 1.0f) },
+        { XMFLOAT3(1.0f, 0.0f, 0.0f), XMFLOAT2(1.0f, 0.0f) },
+    };
+    RevModelData modelData;
+    const RevSubMesh subMesh = CreateTriangles(modelData, corners, 6, XMFLOAT3(0.0f, 0.0f, 0.0f));
+    RevTangentGenerator::GenerateNormals(modelData, subMesh);
+    RevTangentGenerator::GenerateTangents(modelData, subMesh);
+
+    // Both faces meet the fold vertexes at equal angles, so those point halfway between them.
+    const float half = 0.7071068f;
+    REV_CHECK(IsNear(GetVertex(modelData, 2).m_normal, 0.0f, 0.0f, 1.0f));
+    REV_CHECK(IsNear(GetVertex(modelData, 4).m_normal, 0.0f, 1.0f, 0.0f));
+    for (UINT vertex : { 0u, 1u, 3u, 5u })
+    {
+        REV_CHECK(IsNear(GetVertex(modelData, vertex).m_normal, 0.0f, half, half));
+    }
+    for (UINT vertex = 0; vertex < 6; vertex++)
+    {
+        // Every vertex ends up with a full orthonormal frame instead of zero vectors.
+        const RevVertexPosTexNormBiTan& result = GetVertex(modelData, vertex);
+        XMVECTOR normal = XMLoadFloat3(&result.m_normal);
+        XMVECTOR tangent = XMLoadFloat3(&result.m_tangent);
+        REV_CHECK(fabsf(XMVectorGetX(XMVector3Length(tangent)) - 1.0f) < g_tolerance);
+        REV_CHECK(fabsf(XMVectorGetX(XMVector3Dot(normal, tangent))) < g_tolerance);
+    }
+}
@@ -0,0 +1,53 @@
+#include "stdafx.h"
+#include "RevTest.h"
+#include <cstdio>
+#include <vector>
+
+namespace
+{
+    struct RevRegisteredTest
+    {
+        const char* m_name;
+        RevTest::Function m_function;
+    };
+
+    // Function local, registrations run during static initialization of other translation units.
+    std::vector<RevRegisteredTest>& GetTests()
+    {
+        static std::vector<RevRegisteredTest> tests;
+        return tests;
+    }
+
+    int g_failures = 0;
+}
+
+RevTest::RevTest(const char* name, Function function)
+{
+    GetTests().push_back({ name, function });
+}
+
+void RevTest::Check(bool passed, const char* expression, const char* file, int line)
+{
+    if (!passed)
+    {
+        g_failures++;
+        printf("%s(%d): check failed: %s\n", file, line, expression);
+    }
+}
+
+int RevTest::RunAll()
+{
+    for (const RevRegisteredTest& test : GetTests())
+    {
+        const int failuresBefore = g_failures;
+        test.m_function();
+        printf("%s %s\n", g_failures == failuresBefore ? "[passed]" : "[FAILED]", test.m_name);
+    }
+    printf("%d check(s) failed\n", g_failures);
+    return g_failures;
+}
+
+int main()
+{
+    return RevTest::RunAll();
+}
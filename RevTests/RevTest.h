@@ -0,0 +1,21 @@
+#pragma once
+
+/** Minimal test runner of RevTests. REV_TEST registers a function run by main, REV_CHECK records a failure without
+ *  stopping the test. The process returns the number of failed checks, so a build step can gate on it. */
+class RevTest
+{
+public:
+    typedef void (*Function)();
+
+    RevTest(const char* name, Function function);
+
+    static void Check(bool passed, const char* expression, const char* file, int line);
+    static int RunAll();
+};
+
+#define REV_TEST(name) \
+    static void name(); \
+    static const RevTest name##Registration(#name, name); \
+    static void name()
+
+#define REV_CHECK(expression) RevTest::Check(!!(expression), #expression, __FILE__, __LINE__)
@@ -0,0 +1,124 @@
+#include "stdafx.h"
+#include "RevTest.h"
+#include <vector>
+#include "Core/RevTlsfAllocator.h"
+
+namespace
+{
+    const UINT64 g_granularity = RevTlsfAllocator::s_granularity;
+}
+
+REV_TEST(TlsfAllocateAndFree)
+{
+    RevTlsfAllocator allocator;
+    allocator.Initialize(1024 * g_granularity);
+    const RevTlsfAllocation first = allocator.Allocate(3 * g_granularity, g_granularity);
+    const RevTlsfAllocation second = allocator.Allocate(100, g_granularity);
+    REV_CHECK(first.IsValid() && second.IsValid());
+    REV_CHECK(first.m_offset + 3 * g_granularity <= second.m_offset || second.m_offset + g_granularity <= first.m_offset);
+    // Sizes round up to whole granules.
+    REV_CHECK(allocator.GetUsedSize() == 4 * g_granularity);
+    REV_CHECK(allocator.Validate());
+
+    allocator.Free(first);
+    allocator.Free(second);
+    REV_CHECK(allocator.IsEmpty());
+    REV_CHECK(allocator.Validate());
+}
+
+REV_TEST(TlsfFreeCoalescesNeighbours)
+{
+    RevTlsfAllocator allocator;
+    allocator.Initialize(64 * g_granularity);
+    std::vector<RevTlsfAllocation> allocations;
+    for (UINT index = 0; index < 4; index++)
+    {
+        allocations.push_back(allocator.Allocate(16 * g_granularity, g_granularity));
+        REV_CHECK(allocations.back().IsValid());
+    }
+    REV_CHECK(!allocator.Allocate(g_granularity, g_granularity).IsValid());
+
+    // Freed out of order, the middle blocks merge with both sides until the whole range is one block again.
+    allocator.Free(allocations[1]);
+    allocator.Free(allocations[3]);
+    allocator.Free(allocations[2]);
+    REV_CHECK(allocator.Validate());
+    const RevTlsfAllocation merged = allocator.Allocate(48 * g_granularity, g_granularity);
+    REV_CHECK(merged.IsValid() && merged.m_offset == 16 * g_granularity);
+    allocator.Free(merged);
+    allocator.Free(allocations[0]);
+    REV_CHECK(allocator.IsEmpty());
+    REV_CHECK(allocator.Allocate(64 * g_granularity, g_granularity).IsValid());
+    REV_CHECK(allocator.Validate());
+}
+
+REV_TEST(TlsfAlignment)
+{
+    RevTlsfAllocator allocator;
+    allocator.Initialize(64ull * 1024 * 1024);
+    const RevTlsfAllocation unaligned = allocator.Allocate(g_granularity, g_granularity);
+    REV_CHECK(unaligned.IsValid());
+    const UINT64 alignments[] = { 512, 4096, 64 * 1024, 4 * 1024 * 1024 };
+    for (UINT64 alignment : alignments)
+    {
+        const RevTlsfAllocation aligned = allocator.Allocate(1000, alignment);
+        REV_CHECK(aligned.IsValid());
+        REV_CHECK(aligned.m_offset % alignment == 0);
+    }
+    // Alignments below the granularity still land on a granule.
+    const RevTlsfAllocation small = allocator.Allocate(10, 16);
+    REV_CHECK(small.IsValid() && small.m_offset % g_granularity == 0);
+    REV_CHECK(allocator.Validate());
+}
+
+REV_TEST(TlsfExhaustion)
+{
+    RevTlsfAllocator allocator;
+    allocator.Initialize(1024 * g_granularity);
+    REV_CHECK(!allocator.Allocate(1025 * g_granularity, g_granularity).IsValid());
+
+    std::vector<RevTlsfAllocation> allocations;
+    for (;;)
+    {
+        const RevTlsfAllocation allocation = allocator.Allocate(7 * g_granularity, g_granularity);
+        if (!allocation.IsValid())
+        {
+            break;
+        }
+        allocations.push_back(allocation);
+    }
+    REV_CHECK(allocations.size() == 1024 / 7);
+    REV_CHECK(allocator.GetUsedSize() == allocations.size() * 7 * g_granularity);
+    // The granules left over still serve a request that fits them.
+    const RevTlsfAllocation rest = allocator.Allocate((1024 % 7) * g_granularity, g_granularity);
+    REV_CHECK(rest.IsValid());
+    REV_CHECK(allocator.GetUsedSize() == allocator.GetSize());
+    REV_CHECK(allocator.Validate());
+
+    for (const RevTlsfAllocation& allocation : allocations)
+    {
+        allocator.Free(allocation);
+    }
+    allocator.Free(rest);
+    REV_CHECK(allocator.IsEmpty());
+    REV_CHECK(allocator.Validate());
+}
+
+REV_TEST(TlsfExactWholeBlockFit)
+{
+    // Dedicated geometry and small buffer pages are sized exactly to their stream, most sizes sit between classes.
+    const UINT64 sizes[] = { 300000000, 67109120, 64ull * 1024 * 1024, 100ull * 1024 * 1024, 3 * 4096 + 256, 17 * 256 };
+    for (UINT64 size : sizes)
+    {
+        const UINT64 pageSize = (size + g_granularity - 1) & ~(g_granularity - 1);
+        RevTlsfAllocator allocator;
+        allocator.Initialize(pageSize);
+        const RevTlsfAllocation allocation = allocator.Allocate(size, g_granularity);
+        REV_CHECK(allocation.IsValid());
+        REV_CHECK(allocation.m_offset == 0 && allocator.GetUsedSize() == pageSize);
+        REV_CHECK(!allocator.Allocate(g_granularity, g_granularity).IsValid());
+        REV_CHECK(allocator.Validate());
+        allocator.Free(allocation);
+        REV_CHECK(allocator.IsEmpty());
+    }
+}